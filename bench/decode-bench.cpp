@@ -0,0 +1,278 @@
+// Lump decoding benchmark
+//
+// Compares the old way of reading lumps (copying the bytes into native
+// structs and following patch offsets unchecked) with the little-endian,
+// bounds-checked decoders used by the WAD reader (LumpView and LumpReader).
+// Level records are also read as native structs in place, without the copy,
+// which is the cost of the plain loads alone. Every path checksums the same
+// fields, so the checksums must match.
+//
+// Build and run with: make decode-bench
+
+#include "../src/lump-reader.hpp"
+#include "../src/mapped-file.hpp"
+#include "../src/wad.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Lump {
+  const uint8_t *data;
+  std::size_t    size;
+  LumpName       name;
+};
+
+// Old path: copy the lump into a vector of native structs
+template <typename T>
+std::vector<T> copyRecords(const Lump &lump) {
+  std::vector<T> records(lump.size / sizeof(T));
+  std::memcpy(records.data(), lump.data, records.size() * sizeof(T));
+  return records;
+}
+
+uint64_t copiedLevel(const std::vector<Lump> &lumps) {
+  uint64_t sum = 0;
+  for (const Lump &lump : lumps) {
+    if (lump.name == "VERTEXES") {
+      for (const WAD::Vertex &v : copyRecords<WAD::Vertex>(lump)) {
+        sum += static_cast<uint16_t>(v.x) + static_cast<uint16_t>(v.y);
+      }
+    } else if (lump.name == "LINEDEFS") {
+      for (const WAD::Linedef &l : copyRecords<WAD::Linedef>(lump)) {
+        sum += l.start_vertex + l.end_vertex + l.right_sidedef +
+               l.left_sidedef;
+      }
+    } else if (lump.name == "SIDEDEFS") {
+      for (const WAD::Sidedef &s : copyRecords<WAD::Sidedef>(lump)) {
+        sum += static_cast<uint16_t>(s.x_offset) + s.sector +
+               static_cast<uint8_t>(s.middle_texture[0]);
+      }
+    } else if (lump.name == "SECTORS") {
+      for (const WAD::Sector &s : copyRecords<WAD::Sector>(lump)) {
+        sum += static_cast<uint16_t>(s.floor_height) +
+               static_cast<uint16_t>(s.ceiling_height);
+      }
+    }
+  }
+  return sum;
+}
+
+// Native structs read in place, one record at a time
+template <typename T>
+T nativeRecord(const Lump &lump, std::size_t index) {
+  T record;
+  std::memcpy(&record, lump.data + index * sizeof(T), sizeof(T));
+  return record;
+}
+
+uint64_t nativeLevel(const std::vector<Lump> &lumps) {
+  uint64_t sum = 0;
+  for (const Lump &lump : lumps) {
+    if (lump.name == "VERTEXES") {
+      for (std::size_t i = 0; i < lump.size / sizeof(WAD::Vertex); i++) {
+        WAD::Vertex v = nativeRecord<WAD::Vertex>(lump, i);
+        sum += static_cast<uint16_t>(v.x) + static_cast<uint16_t>(v.y);
+      }
+    } else if (lump.name == "LINEDEFS") {
+      for (std::size_t i = 0; i < lump.size / sizeof(WAD::Linedef); i++) {
+        WAD::Linedef l = nativeRecord<WAD::Linedef>(lump, i);
+        sum += l.start_vertex + l.end_vertex + l.right_sidedef +
+               l.left_sidedef;
+      }
+    } else if (lump.name == "SIDEDEFS") {
+      for (std::size_t i = 0; i < lump.size / sizeof(WAD::Sidedef); i++) {
+        WAD::Sidedef s = nativeRecord<WAD::Sidedef>(lump, i);
+        sum += static_cast<uint16_t>(s.x_offset) + s.sector +
+               static_cast<uint8_t>(s.middle_texture[0]);
+      }
+    } else if (lump.name == "SECTORS") {
+      for (std::size_t i = 0; i < lump.size / sizeof(WAD::Sector); i++) {
+        WAD::Sector s = nativeRecord<WAD::Sector>(lump, i);
+        sum += static_cast<uint16_t>(s.floor_height) +
+               static_cast<uint16_t>(s.ceiling_height);
+      }
+    }
+  }
+  return sum;
+}
+
+// New path: decode records in place through LumpView
+uint64_t viewLevel(const std::vector<Lump> &lumps) {
+  uint64_t sum = 0;
+  for (const Lump &lump : lumps) {
+    if (lump.name == "VERTEXES") {
+      LumpView<WAD::Vertex> view(lump.data, lump.size);
+      for (std::size_t i = 0; i < view.size(); i++) {
+        WAD::Vertex v = view[i];
+        sum += static_cast<uint16_t>(v.x) + static_cast<uint16_t>(v.y);
+      }
+    } else if (lump.name == "LINEDEFS") {
+      LumpView<WAD::Linedef> view(lump.data, lump.size);
+      for (std::size_t i = 0; i < view.size(); i++) {
+        WAD::Linedef l = view[i];
+        sum += l.start_vertex + l.end_vertex + l.right_sidedef +
+               l.left_sidedef;
+      }
+    } else if (lump.name == "SIDEDEFS") {
+      LumpView<WAD::Sidedef> view(lump.data, lump.size);
+      for (std::size_t i = 0; i < view.size(); i++) {
+        WAD::Sidedef s = view[i];
+        sum += static_cast<uint16_t>(s.x_offset) + s.sector +
+               static_cast<uint8_t>(s.middle_texture[0]);
+      }
+    } else if (lump.name == "SECTORS") {
+      LumpView<WAD::Sector> view(lump.data, lump.size);
+      for (std::size_t i = 0; i < view.size(); i++) {
+        WAD::Sector s = view[i];
+        sum += static_cast<uint16_t>(s.floor_height) +
+               static_cast<uint16_t>(s.ceiling_height);
+      }
+    }
+  }
+  return sum;
+}
+
+// Old path: walk the patch posts following the offsets unchecked
+uint64_t nativePatches(const std::vector<Lump> &patches) {
+  uint64_t sum = 0;
+  for (const Lump &lump : patches) {
+    int16_t width;
+    std::memcpy(&width, lump.data, 2);
+    for (int x = 0; x < width; x++) {
+      uint32_t offset;
+      std::memcpy(&offset, lump.data + 8 + x * 4, 4);
+      const uint8_t *post = lump.data + offset;
+      while (post[0] != 0xFF) {
+        const uint8_t *pixels = post + 3;
+        for (int i = 0; i < post[1]; i++) {
+          sum += pixels[i];
+        }
+        post += post[1] + 4;
+      }
+    }
+  }
+  return sum;
+}
+
+// New path: the same walk through LumpReader, as readPatch does it
+uint64_t readerPatches(const std::vector<Lump> &patches) {
+  uint64_t sum = 0;
+  for (const Lump &lump : patches) {
+    LumpReader     reader(lump.data, lump.size, lump.name);
+    int16_t        width   = reader.s16(0);
+    const uint8_t *columns = reader.bytes(8, static_cast<uint64_t>(width) * 4);
+    for (int x = 0; x < width; x++) {
+      uint64_t offset = LittleEndian::loadU32(columns + x * 4);
+      while (reader.u8(offset) != 0xFF) {
+        uint8_t        length = reader.u8(offset + 1);
+        const uint8_t *pixels = reader.bytes(offset + 3, length);
+        for (int i = 0; i < length; i++) {
+          sum += pixels[i];
+        }
+        offset += length + 4;
+      }
+    }
+  }
+  return sum;
+}
+
+// Best time of each path over several runs, in nanoseconds per item. The
+// paths take turns, so a change of clock speed affects them alike
+struct Timing {
+  std::function<uint64_t()> run;
+  double                    bestNanos = 0;
+  uint64_t                  checksum  = 0;
+};
+
+void timeRuns(std::vector<Timing> &timings, std::size_t items) {
+  const int repeats = 400;
+  for (int r = 0; r < repeats; r++) {
+    for (Timing &timing : timings) {
+      auto start      = std::chrono::steady_clock::now();
+      timing.checksum = timing.run();
+      auto   end      = std::chrono::steady_clock::now();
+      double nanos =
+          std::chrono::duration<double, std::nano>(end - start).count() /
+          static_cast<double>(items);
+      if (r == 0 || nanos < timing.bestNanos) {
+        timing.bestNanos = nanos;
+      }
+    }
+  }
+}
+
+void report(const std::string &name, const std::string &baseline,
+            double oldNanos, uint64_t oldSum, double newNanos,
+            uint64_t newSum) {
+  std::cout << name << ": " << baseline << " " << oldNanos << " ns, decoded "
+            << newNanos << " ns (" << (newNanos / oldNanos) * 100.0
+            << "%), checksums " << (oldSum == newSum ? "match" : "DIFFER")
+            << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::string filepath = argc > 1 ? argv[1] : "wads/doom1.wad";
+
+  MappedFile file(filepath);
+  auto       header = WAD::Header::decode(file.range(0, 12));
+
+  std::vector<Lump> levelLumps;
+  std::vector<Lump> patches;
+  std::size_t       records = 0;
+  bool              inPatches = false;
+
+  for (uint32_t i = 0; i < header.numlumps; i++) {
+    auto entry = WAD::Directory::decode(
+        file.range(header.infotableofs + i * 16ULL, 16));
+    Lump     lump{file.range(entry.filepos, entry.size), entry.size,
+              LumpName(entry.name)};
+
+    if (lump.name == "P_START" || lump.name == "P1_START") {
+      inPatches = true;
+    } else if (lump.name == "P_END" || lump.name == "P1_END") {
+      inPatches = false;
+    } else if (inPatches && lump.size > 8) {
+      patches.push_back(lump);
+    } else if (lump.name == "VERTEXES" || lump.name == "LINEDEFS" ||
+               lump.name == "SIDEDEFS" || lump.name == "SECTORS") {
+      levelLumps.push_back(lump);
+      records += lump.name == "VERTEXES"   ? lump.size / 4
+                 : lump.name == "LINEDEFS" ? lump.size / 14
+                 : lump.name == "SIDEDEFS" ? lump.size / 30
+                                           : lump.size / 26;
+    }
+  }
+
+  std::cout << "Decoding " << records << " level records and "
+            << patches.size() << " patches from " << filepath << "\n";
+
+  std::vector<Timing> level(3);
+  level[0].run = [&] { return copiedLevel(levelLumps); };
+  level[1].run = [&] { return nativeLevel(levelLumps); };
+  level[2].run = [&] { return viewLevel(levelLumps); };
+  timeRuns(level, records);
+  report("Level records (per record)", "copied", level[0].bestNanos,
+         level[0].checksum, level[2].bestNanos, level[2].checksum);
+  report("Level records (per record)", "in place", level[1].bestNanos,
+         level[1].checksum, level[2].bestNanos, level[2].checksum);
+
+  std::vector<Timing> patch(2);
+  patch[0].run = [&] { return nativePatches(patches); };
+  patch[1].run = [&] { return readerPatches(patches); };
+  timeRuns(patch, patches.size());
+  report("Patches (per patch)", "unchecked", patch[0].bestNanos,
+         patch[0].checksum, patch[1].bestNanos, patch[1].checksum);
+
+  bool match = level[0].checksum == level[2].checksum &&
+               level[1].checksum == level[2].checksum &&
+               patch[0].checksum == patch[1].checksum;
+  return match ? 0 : 1;
+}
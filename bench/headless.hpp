@@ -0,0 +1,86 @@
+#ifndef WAD_VIEWER_BENCH_HEADLESS_HPP
+#define WAD_VIEWER_BENCH_HEADLESS_HPP
+
+// Stand-ins for the engine used by the benchmarks, so they run without a
+// window or GL context
+
+#include "../src/level-mesh.hpp"
+#include "../src/log.hpp"
+#include "../src/wad-converter.hpp"
+#include "../src/wad.hpp"
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Silences what the reader and the converter log while it exists
+class QuietOutput {
+public:
+  QuietOutput() : saved_(Log::level()) { Log::setLevel(Log::Level::Off); }
+  ~QuietOutput() { Log::setLevel(saved_); }
+
+  QuietOutput(const QuietOutput &)            = delete;
+  QuietOutput &operator=(const QuietOutput &) = delete;
+
+private:
+  Log::Level saved_;
+};
+
+/**
+ * @brief Stand-in for the engine texture handler: composites textures and
+ * flats the way WADConverter does before uploading them, and keeps the
+ * pixels. Names it already holds are skipped, like the handler does.
+ */
+class TextureSink {
+public:
+  void clear() { textures_.clear(); }
+
+  void addTexture(const WAD::TextureDef             &texDef,
+                  const std::vector<WAD::PatchData> &patches,
+                  const std::vector<WAD::Color>     &palette) {
+    std::string name = LumpName(texDef.name).str();
+    if (textures_.count(name) == 0) {
+      WADConverter::compositeTexture(texDef, patches, palette,
+                                     textures_[name]);
+    }
+  }
+
+  void addFlat(const WAD::FlatData           &flat,
+               const std::vector<WAD::Color> &palette) {
+    std::string name = LumpName(flat.name).str();
+    if (textures_.count(name) == 0) {
+      WADConverter::convertFlat(name, flat, palette, textures_[name]);
+    }
+  }
+
+  // Textures of a level, as WADConverter::createLevelItems loads them: every
+  // flat, then the wall textures the mesh uses
+  void addLevel(const WAD::Level &level, const LevelMesh &mesh) {
+    for (std::size_t f = 0; f < level.flats.size(); f++) {
+      addFlat(level.flats[f], level.palette);
+    }
+
+    std::vector<LumpName> used = mesh.usedTextures();
+
+    for (std::size_t t = 0; t < level.texture_defs.size(); t++) {
+      const WAD::TextureDef &texDef = level.texture_defs[t];
+      if (std::binary_search(used.begin(), used.end(),
+                             LumpName(texDef.name))) {
+        addTexture(texDef, level.patches, level.palette);
+      }
+    }
+  }
+
+  std::size_t bytes() const {
+    std::size_t total = 0;
+    for (const auto &texture : textures_) {
+      total += texture.second.size();
+    }
+    return total;
+  }
+
+private:
+  std::unordered_map<std::string, std::vector<unsigned char>> textures_;
+};
+
+#endif  // WAD_VIEWER_BENCH_HEADLESS_HPP
@@ -0,0 +1,387 @@
+// End-to-end level load benchmark
+//
+// Times what the viewer does to show a level, with the engine left out:
+// opening the WAD stack, decoding the level, building its mesh and
+// compositing its textures (TextureSink, see headless.hpp).
+//
+// A cold load starts from a new WADStack and an empty texture cache, like
+// starting the viewer. A warm load reuses both, like switching levels in a
+// running viewer. Every level of the IWAD is timed, then every level of a
+// synthetic megawad: a PWAD that repeats the IWAD levels as MAP01-MAPnn and
+// is layered over it. Any other PWAD given with --pwad is timed the same
+// way.
+//
+// Times are the best of several runs. --out saves them as JSON; --baseline
+// compares them with a saved file and exits with 1 if the loads of a suite
+// got slower than the baseline by more than the threshold. Times only
+// compare on the machine that measured them, so the baseline is a local
+// file that is not committed.
+//
+// Save a baseline on this machine with: make load-bench-baseline
+// Build, run and compare with it with: make load-bench
+
+#include "../src/wad-converter.hpp"
+#include "../src/wad-stack.hpp"
+#include "../src/wad-writer.hpp"
+#include "../src/wad.hpp"
+#include "./headless.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Regressions smaller than this are noise, whatever the threshold
+const double MIN_REGRESSION_MS = 0.2;
+
+// Time spent in each phase of a level load, in milliseconds
+struct LoadTimes {
+  double open    = 0.0;  // Opening the WADs and building every level
+  double decode  = 0.0;  // Copying the level out of the stack
+  double convert = 0.0;  // buildLevelMesh
+  double texture = 0.0;  // Compositing the textures the level uses
+
+  double total() const { return open + decode + convert + texture; }
+};
+
+// Levels read from a list of WADs, the last one on top
+struct Suite {
+  std::string              name;
+  std::vector<std::string> files;
+  std::vector<std::string> levels;  // The levels of the topmost WAD
+};
+
+double millisecondsSince(Clock::time_point &start) {
+  Clock::time_point now = Clock::now();
+  double milliseconds =
+      std::chrono::duration<double, std::milli>(now - start).count();
+  start = now;
+  return milliseconds;
+}
+
+void openStack(WADStack &stack, const std::vector<std::string> &files) {
+  for (std::size_t f = 0; f < files.size(); f++) {
+    stack.addWAD(files[f]);
+  }
+  stack.processStack();
+}
+
+// Decode, convert and texture one level of an open stack
+void loadLevel(const WADStack &stack, const std::string &name,
+               TextureSink &textures, LoadTimes &times,
+               Clock::time_point &start) {
+  WAD::Level level = stack.getLevel(name);
+  times.decode     = millisecondsSince(start);
+  LevelMesh mesh   = WADConverter::buildLevelMesh(level);
+  times.convert    = millisecondsSince(start);
+  textures.addLevel(level, mesh);
+  times.texture = millisecondsSince(start);
+}
+
+LoadTimes coldLoad(const Suite &suite, const std::string &name) {
+  QuietOutput       quiet;
+  LoadTimes         times;
+  Clock::time_point start = Clock::now();
+  WADStack          stack;
+  openStack(stack, suite.files);
+  times.open = millisecondsSince(start);
+
+  TextureSink textures;
+  loadLevel(stack, name, textures, times, start);
+  return times;
+}
+
+LoadTimes warmLoad(const WADStack &stack, const std::string &name,
+                   TextureSink &textures) {
+  QuietOutput       quiet;
+  LoadTimes         times;
+  Clock::time_point start = Clock::now();
+  loadLevel(stack, name, textures, times, start);
+  return times;
+}
+
+// Run with the lowest total, the least disturbed by the rest of the system
+LoadTimes fastest(const std::vector<LoadTimes> &runs) {
+  std::size_t best = 0;
+  for (std::size_t r = 1; r < runs.size(); r++) {
+    if (runs[r].total() < runs[best].total()) {
+      best = r;
+    }
+  }
+  return runs[best];
+}
+
+nlohmann::json toJSON(const LoadTimes &times) {
+  return {{"open_ms", times.open},       {"decode_ms", times.decode},
+          {"convert_ms", times.convert}, {"texture_ms", times.texture},
+          {"total_ms", times.total()}};
+}
+
+// Names of the levels of a WAD, in directory order
+std::vector<std::string> levelNames(const std::string &path) {
+  QuietOutput                        quiet;
+  WAD                                wad(path);
+  const std::vector<WAD::Directory> &directory = wad.getDirectory();
+  std::vector<std::string>           names;
+  for (std::size_t i = 0; i < directory.size(); i++) {
+    LumpName name(directory[i].name);
+    if (wad.isLevelMarker(name)) {
+      names.push_back(name.str());
+    }
+  }
+  return names;
+}
+
+/**
+ * @brief Write a PWAD repeating the levels of an IWAD as MAP01, MAP02...
+ * @param iwadPath The IWAD, which must have at least one level
+ * @param levelCount Number of levels to write, at most 99
+ * @param path Path of the PWAD to write
+ * @throws std::runtime_error if a file cannot be read or written
+ */
+void writeMegawad(const std::string &iwadPath, int levelCount,
+                  const std::string &path) {
+  static const LumpName LEVEL_LUMPS[] = {
+      "THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SEGS",
+      "SSECTORS", "NODES", "SECTORS", "REJECT", "BLOCKMAP"};
+
+  QuietOutput                        quiet;
+  WAD                                iwad(iwadPath);
+  const std::vector<WAD::Directory> &directory = iwad.getDirectory();
+
+  std::vector<std::size_t> markers;
+  for (std::size_t i = 0; i < directory.size(); i++) {
+    if (iwad.isLevelMarker(LumpName(directory[i].name))) {
+      markers.push_back(i);
+    }
+  }
+  if (markers.empty()) {
+    throw std::runtime_error("No levels to repeat in " + iwadPath);
+  }
+
+  WADWriter megawad("PWAD");
+  for (int l = 0; l < levelCount; l++) {
+    std::string number = std::to_string(l + 1);
+    megawad.addMarker(LumpName("MAP" + std::string(l < 9 ? "0" : "") + number));
+
+    // The level lumps follow their marker
+    std::size_t source = markers[l % markers.size()];
+    for (std::size_t i = source + 1; i < directory.size(); i++) {
+      LumpName name(directory[i].name);
+      if (std::find(std::begin(LEVEL_LUMPS), std::end(LEVEL_LUMPS), name) ==
+          std::end(LEVEL_LUMPS)) {
+        break;
+      }
+      megawad.addLump(name, iwad.readLump(i));
+    }
+  }
+  megawad.write(path);
+}
+
+/**
+ * @brief Time the cold and warm loads of every level of a suite
+ * @param suite WADs and levels to load
+ * @param runs Loads per level and kind, the fastest is kept
+ * @return The suite as JSON, with the times of each level
+ */
+nlohmann::json runSuite(const Suite &suite, int runs) {
+  nlohmann::json levels = nlohmann::json::array();
+
+  // Warm loads share one stack and texture cache, filled by a first pass
+  WADStack    stack;
+  TextureSink textures;
+  {
+    QuietOutput quiet;
+    openStack(stack, suite.files);
+  }
+  for (std::size_t l = 0; l < suite.levels.size(); l++) {
+    warmLoad(stack, suite.levels[l], textures);
+  }
+
+  for (std::size_t l = 0; l < suite.levels.size(); l++) {
+    const std::string     &name = suite.levels[l];
+    std::vector<LoadTimes> cold;
+    std::vector<LoadTimes> warm;
+    for (int r = 0; r < runs; r++) {
+      cold.push_back(coldLoad(suite, name));
+      warm.push_back(warmLoad(stack, name, textures));
+    }
+
+    LoadTimes coldTimes = fastest(cold);
+    LoadTimes warmTimes = fastest(warm);
+    std::cout << std::left << std::setw(10) << suite.name << " " << std::setw(8)
+              << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(12) << coldTimes.total() << std::setw(12)
+              << warmTimes.total() << "\n";
+
+    levels.push_back({{"name", name},
+                      {"cold", toJSON(coldTimes)},
+                      {"warm", toJSON(warmTimes)}});
+  }
+
+  return {{"name", suite.name}, {"files", suite.files}, {"levels", levels}};
+}
+
+// Slowdown in percent, or 0 if it is within the noise
+double slowdown(double before, double now) {
+  if (before <= 0.0 || now - before <= MIN_REGRESSION_MS) {
+    return 0.0;
+  }
+  return (now / before - 1.0) * 100.0;
+}
+
+/**
+ * @brief List the loads that got slower than in the baseline
+ * @param results Times of this run
+ * @param baseline Saved times, levels missing from either side are skipped
+ * @param threshold Allowed slowdown, in percent of the baseline time
+ * @return Number of regressions: suites whose cold or warm loads of all the
+ * levels together got slower than the threshold. Single levels over it are
+ * listed too, but they are too short to gate on.
+ */
+int compare(const nlohmann::json &results, const nlohmann::json &baseline,
+            double threshold) {
+  int regressions = 0;
+  for (const nlohmann::json &suite : results["suites"]) {
+    for (const nlohmann::json &base : baseline["suites"]) {
+      if (base["name"] != suite["name"]) {
+        continue;
+      }
+
+      const std::string suiteName = suite["name"];
+      for (const char *kind : {"cold", "warm"}) {
+        double suiteBefore = 0.0;
+        double suiteNow    = 0.0;
+        for (const nlohmann::json &level : suite["levels"]) {
+          for (const nlohmann::json &baseLevel : base["levels"]) {
+            if (baseLevel["name"] != level["name"]) {
+              continue;
+            }
+
+            double before = baseLevel[kind]["total_ms"];
+            double now    = level[kind]["total_ms"];
+            double change = slowdown(before, now);
+            if (change > threshold) {
+              std::cout << "slower " << suiteName << " "
+                        << level["name"].get<std::string>() << " " << kind
+                        << ": " << before << " ms -> " << now << " ms (+"
+                        << change << "%)\n";
+            }
+            suiteBefore += before;
+            suiteNow    += now;
+          }
+        }
+
+        double change = slowdown(suiteBefore, suiteNow);
+        if (change > threshold) {
+          std::cout << "REGRESSION " << suiteName << " " << kind << ": "
+                    << suiteBefore << " ms -> " << suiteNow << " ms (+"
+                    << change << "%)\n";
+          regressions++;
+        }
+      }
+    }
+  }
+  return regressions;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::string              iwad        = "wads/doom1.wad";
+  std::string              megawadFile = "load-bench-megawad.wad";
+  int                      megawadSize = 32;
+  int                      runs        = 5;
+  double                   threshold   = 10.0;
+  std::vector<std::string> pwads;
+  std::string              outFile;
+  std::string              baselineFile;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--iwad" && i + 1 < argc) {
+      iwad = argv[++i];
+    } else if (arg == "--pwad" && i + 1 < argc) {
+      pwads.push_back(argv[++i]);
+    } else if (arg == "--megawad" && i + 1 < argc) {
+      megawadSize = std::max(0, std::min(99, std::atoi(argv[++i])));
+    } else if (arg == "--runs" && i + 1 < argc) {
+      runs = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--out" && i + 1 < argc) {
+      outFile = argv[++i];
+    } else if (arg == "--baseline" && i + 1 < argc) {
+      baselineFile = argv[++i];
+    } else if (arg == "--threshold" && i + 1 < argc) {
+      threshold = std::atof(argv[++i]);
+    } else {
+      // clang-format off
+      std::cerr << "Usage: load-bench [--iwad file] [--pwad file]... [--megawad levels] [--runs n]\n"
+                << "                  [--out results.json] [--baseline baseline.json] [--threshold percent]\n";
+      // clang-format on
+      return 2;
+    }
+  }
+
+  try {
+    std::vector<Suite> suites;
+    suites.push_back(Suite{"iwad", {iwad}, levelNames(iwad)});
+    if (megawadSize > 0) {
+      writeMegawad(iwad, megawadSize, megawadFile);
+      suites.push_back(
+          Suite{"megawad", {iwad, megawadFile}, levelNames(megawadFile)});
+    }
+    for (std::size_t p = 0; p < pwads.size(); p++) {
+      suites.push_back(Suite{pwads[p], {iwad, pwads[p]}, levelNames(pwads[p])});
+    }
+
+    std::cout << std::left << std::setw(18) << "Level" << std::right
+              << std::setw(12) << "cold ms" << std::setw(12) << "warm ms"
+              << "\n";
+
+    nlohmann::json results = {{"runs", runs},
+                              {"suites", nlohmann::json::array()}};
+    for (std::size_t s = 0; s < suites.size(); s++) {
+      results["suites"].push_back(runSuite(suites[s], runs));
+    }
+    if (megawadSize > 0) {
+      std::remove(megawadFile.c_str());
+    }
+
+    if (!outFile.empty()) {
+      std::ofstream file(outFile.c_str());
+      file << results.dump(2) << "\n";
+      if (!file) {
+        throw std::runtime_error("Could not write " + outFile);
+      }
+      std::cout << "Results written to " << outFile << "\n";
+    }
+
+    if (!baselineFile.empty()) {
+      std::ifstream file(baselineFile.c_str());
+      if (!file) {
+        throw std::runtime_error("Could not read " + baselineFile +
+                                 ", save one with make load-bench-baseline");
+      }
+      nlohmann::json baseline    = nlohmann::json::parse(file);
+      int            regressions = compare(results, baseline, threshold);
+      std::cout << regressions << " regressions over " << threshold
+                << "% against " << baselineFile << "\n";
+      return regressions > 0 ? 1 : 0;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 2;
+  }
+
+  return 0;
+}
@@ -0,0 +1,469 @@
+// Reader and converter microbenchmarks
+//
+// Times the lump readers, texture compositing, level conversion and the
+// text exports on a WAD (wads/doom1.wad by default) and on synthetic
+// patches, textures and flats. Each benchmark reports the time per
+// operation, the bytes it reads or writes per second and the heap
+// allocations per operation, counted by the operator new below.
+//
+// Textures are not uploaded: TextureSink (headless.hpp) composites them
+// like the texture creation of WADConverter and keeps the pixels, so no
+// window or GL context is needed.
+//
+// Build and run with: make bench
+// Run the benchmarks whose name contains a word with:
+//   ./micro-bench wads/doom1.wad composite
+// Time buildLevelMesh on the first level of a PWAD layered over the WAD,
+// serially and on pools of 1, 2, 4 and 8 threads, with:
+//   ./wad-generator big.wad --sectors 8000 --nodes
+//   ./micro-bench wads/doom1.wad scaling big.wad
+
+#include "../src/thread-pool.hpp"
+#include "../src/wad-converter.hpp"
+#include "../src/wad-stack.hpp"
+#include "../src/wad.hpp"
+#include "./headless.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> allocationCount(0);
+
+// Keeps the results of the timed code alive
+volatile uint64_t sink = 0;
+
+struct Result {
+  std::string name;
+  double      nanosPerOp;
+  double      bytesPerSecond;  // 0 when the benchmark moves no data
+  double      allocationsPerOp;
+};
+
+/**
+ * @brief Time a benchmark, in batches long enough for the clock
+ * @param name Name shown in the report
+ * @param ops Operations done by one call of run
+ * @param bytes Bytes read or written by one call of run
+ * @param run The code to time
+ * @return Best of five batches, per operation
+ */
+template <typename Run>
+Result measure(const std::string &name, std::size_t ops, std::size_t bytes,
+               Run run) {
+  typedef std::chrono::steady_clock Clock;
+
+  QuietOutput quiet;
+  auto        batch = [&](std::size_t calls) {
+    auto start = Clock::now();
+    for (std::size_t c = 0; c < calls; c++) {
+      sink = sink + run();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start)
+        .count();
+  };
+
+  // Warm the caches, then grow the batch until it runs for 20 ms
+  batch(1);
+  std::size_t calls = 1;
+  while (batch(calls) < 20e6 && calls < (1u << 20)) {
+    calls *= 2;
+  }
+
+  double   bestNanos   = 0;
+  uint64_t allocations = 0;
+  for (int b = 0; b < 5; b++) {
+    uint64_t before = allocationCount.load(std::memory_order_relaxed);
+    double   nanos  = batch(calls);
+    uint64_t after  = allocationCount.load(std::memory_order_relaxed);
+    allocations     = after - before;
+    if (b == 0 || nanos < bestNanos) {
+      bestNanos = nanos;
+    }
+  }
+
+  double totalOps = static_cast<double>(calls) * std::max<std::size_t>(ops, 1);
+  Result result;
+  result.name             = name;
+  result.nanosPerOp       = bestNanos / totalOps;
+  result.bytesPerSecond   = bytes * (calls * 1e9 / bestNanos);
+  result.allocationsPerOp = allocations / totalOps;
+  return result;
+}
+
+void report(const Result &result) {
+  std::cout << std::left << std::setw(34) << result.name << std::right
+            << std::fixed << std::setprecision(1) << std::setw(14)
+            << result.nanosPerOp << std::setw(12);
+  if (result.bytesPerSecond > 0) {
+    std::cout << result.bytesPerSecond / (1024.0 * 1024.0);
+  } else {
+    std::cout << "-";
+  }
+  std::cout << std::setw(12) << std::setprecision(2) << result.allocationsPerOp
+            << "\n";
+}
+
+// Directory indices of the lumps between the markers of a namespace, such as
+// P_START/P_END, including the numbered sub-namespaces (P1_START...)
+std::vector<std::size_t> lumpsBetween(const std::vector<WAD::Directory> &dir,
+                                      char                               ns) {
+  std::vector<std::size_t> lumps;
+  bool                     inside = false;
+  for (std::size_t i = 0; i < dir.size(); i++) {
+    std::string name = LumpName(dir[i].name).str();
+    if (name.size() > 6 && name[0] == ns &&
+        name.compare(name.size() - 6, 6, "_START") == 0) {
+      inside = true;
+    } else if (name.size() > 4 && name[0] == ns &&
+               name.compare(name.size() - 4, 4, "_END") == 0) {
+      inside = false;
+    } else if (inside && dir[i].size > 0) {
+      lumps.push_back(i);
+    }
+  }
+  return lumps;
+}
+
+// Patches in the same shape as decoded ones, with a transparent hole in
+// every fourth column like the grates of DOOM textures
+std::vector<WAD::PatchData> syntheticPatches(int count, int width,
+                                             int height) {
+  std::vector<WAD::PatchData> patches(count);
+  for (int p = 0; p < count; p++) {
+    WAD::PatchData &patch = patches[p];
+    LumpName("SYNTH" + std::to_string(p)).copyTo(patch.name);
+    patch.width  = width;
+    patch.height = height;
+    patch.pixels.resize(static_cast<std::size_t>(width) * height);
+    patch.opaque.resize(patch.pixels.size());
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        std::size_t i   = static_cast<std::size_t>(y) * width + x;
+        patch.pixels[i] = static_cast<uint8_t>(x * 7 + y * 13 + p);
+        patch.opaque[i] = (x % 4 != 3 || y < height / 2) ? 1 : 0;
+      }
+    }
+  }
+  return patches;
+}
+
+std::vector<WAD::Color> grayPalette() {
+  std::vector<WAD::Color> palette(256);
+  for (int c = 0; c < 256; c++) {
+    uint8_t value = static_cast<uint8_t>(c);
+    palette[c]    = WAD::Color{value, value, value};
+  }
+  return palette;
+}
+
+// What createLevelGeometry does, with the engine items left out
+uint64_t convertLevel(const WAD::Level &level, TextureSink &textures) {
+  LevelMesh mesh = WADConverter::buildLevelMesh(level);
+  textures.clear();
+  textures.addLevel(level, mesh);
+  return mesh.groups.size() + textures.bytes();
+}
+
+}  // namespace
+
+// Count every heap allocation of the program
+void *operator new(std::size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (void *pointer = std::malloc(size ? size : 1)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+int main(int argc, char *argv[]) {
+  std::string filepath = argc > 1 ? argv[1] : "wads/doom1.wad";
+  std::string filter   = argc > 2 ? argv[2] : "";
+  std::string pwad     = argc > 3 ? argv[3] : "";
+
+  std::vector<Result> results;
+
+  auto add = [&](const std::string &name, std::size_t ops, std::size_t bytes,
+                 const std::function<uint64_t()> &run) {
+    if (filter.empty() || name.find(filter) != std::string::npos) {
+      results.push_back(measure(name, ops, bytes, run));
+      report(results.back());
+    }
+  };
+
+  WAD      wad(filepath);
+  WADStack wads;
+  {
+    QuietOutput quiet;
+    wad.processWAD();
+    wads.addWAD(filepath);
+    wads.processStack();
+  }
+  const std::vector<WAD::Directory> &directory = wad.getDirectory();
+
+  std::size_t lumpBytes = 0;
+  for (std::size_t i = 0; i < directory.size(); i++) {
+    lumpBytes += directory[i].size;
+  }
+
+  std::vector<std::size_t> patchLumps = lumpsBetween(directory, 'P');
+  std::size_t              patchBytes = 0;
+  for (std::size_t p = 0; p < patchLumps.size(); p++) {
+    patchBytes += directory[patchLumps[p]].size;
+  }
+
+  std::vector<std::size_t> textureLumps;
+  std::size_t              textureLumpBytes = 0;
+  for (std::size_t i = 0; i < directory.size(); i++) {
+    LumpName name(directory[i].name);
+    if (name == "TEXTURE1" || name == "TEXTURE2") {
+      textureLumps.push_back(i);
+      textureLumpBytes += directory[i].size;
+    }
+  }
+
+  std::vector<WAD::Level> levels;
+  {
+    QuietOutput quiet;
+    for (std::size_t i = 0; i < wads.getLevelCount(); i++) {
+      levels.push_back(wads.getLevel(wads.getLevelNameByIndex(i)));
+    }
+  }
+  if (levels.empty()) {
+    std::cerr << "No levels in " << filepath << "\n";
+    return 1;
+  }
+  const WAD::Level &first = levels[0];
+
+  std::size_t textureBytes = 0;
+  for (std::size_t t = 0; t < first.texture_defs.size(); t++) {
+    textureBytes += first.texture_defs[t].width *
+                    static_cast<std::size_t>(first.texture_defs[t].height) * 4;
+  }
+
+  std::cout << filepath << ": " << directory.size() << " lumps, "
+            << patchLumps.size() << " patches, " << first.texture_defs.size()
+            << " textures, " << levels.size() << " levels\n\n";
+  std::cout << std::left << std::setw(34) << "Benchmark" << std::right
+            << std::setw(14) << "ns/op" << std::setw(12) << "MiB/s"
+            << std::setw(12) << "allocs/op" << "\n";
+
+  // Reader
+  add("readLump (every lump)", directory.size(), lumpBytes, [&] {
+    uint64_t total = 0;
+    for (std::size_t i = 0; i < directory.size(); i++) {
+      total += wad.readLump(i).size();
+    }
+    return total;
+  });
+
+  add("findLump (stack index)", directory.size(), 0, [&] {
+    uint64_t          total = 0;
+    WADStack::LumpRef ref;
+    for (std::size_t i = 0; i < directory.size(); i++) {
+      total += wads.findLump(LumpName(directory[i].name), ref) ? 1 : 0;
+    }
+    return total;
+  });
+
+  // WAD::findLump is private, readLevelGeometry looks up eight lumps with
+  // it per level
+  std::vector<std::size_t> markers;
+  {
+    QuietOutput quiet;
+    for (std::size_t i = 0; i < directory.size(); i++) {
+      if (wad.isLevelMarker(LumpName(directory[i].name))) {
+        markers.push_back(i);
+      }
+    }
+  }
+  add("findLump (readLevelGeometry)", markers.size() * 8, 0, [&] {
+    uint64_t total = 0;
+    for (std::size_t m = 0; m < markers.size(); m++) {
+      WAD::Level level;
+      wad.readLevelGeometry(markers[m], level);
+      total += level.linedefs.size();
+    }
+    return total;
+  });
+
+  add("readPatch", patchLumps.size(), patchBytes, [&] {
+    uint64_t total = 0;
+    for (std::size_t p = 0; p < patchLumps.size(); p++) {
+      const WAD::Directory &entry = directory[patchLumps[p]];
+      total += wad.readPatch(entry.filepos, entry.size,
+                             LumpName(entry.name).str())
+                   .pixels.size();
+    }
+    return total;
+  });
+
+  add("readTextureDefs", textureLumps.size(), textureLumpBytes, [&] {
+    uint64_t total = 0;
+    for (std::size_t t = 0; t < textureLumps.size(); t++) {
+      const WAD::Directory &entry = directory[textureLumps[t]];
+      total += wad.readTextureDefs(entry.filepos, entry.size).size();
+    }
+    return total;
+  });
+
+  // Converter: compositePatch is private, compositeTexture runs it for every
+  // patch of the definition
+  std::vector<unsigned char> rgba;
+  add("compositePatch (WAD textures)", first.texture_defs.size(), textureBytes,
+      [&] {
+        uint64_t total = 0;
+        for (std::size_t t = 0; t < first.texture_defs.size(); t++) {
+          WADConverter::compositeTexture(first.texture_defs[t], first.patches,
+                                         first.palette, rgba);
+          total += rgba.size();
+        }
+        return total;
+      });
+
+  // 256x128 wall of four 64x128 patches, plus one overhanging the top edge
+  std::vector<WAD::PatchData> patches = syntheticPatches(5, 64, 128);
+  std::vector<WAD::Color>     palette = grayPalette();
+  WAD::TextureDef             wall    = {};
+  LumpName("SYNWALL").copyTo(wall.name);
+  wall.width  = 256;
+  wall.height = 128;
+  for (int p = 0; p < 5; p++) {
+    WAD::PatchInTexture patch = {};
+    patch.origin_x            = static_cast<int16_t>(p < 4 ? p * 64 : 96);
+    patch.origin_y            = static_cast<int16_t>(p < 4 ? 0 : -32);
+    patch.patch_num           = static_cast<uint16_t>(p);
+    wall.patches.push_back(patch);
+  }
+  wall.patch_count = static_cast<uint16_t>(wall.patches.size());
+  add("compositePatch (synthetic 256x128)", wall.patches.size(),
+      256 * 128 * 4, [&] {
+        WADConverter::compositeTexture(wall, patches, palette, rgba);
+        return static_cast<uint64_t>(rgba.size());
+      });
+
+  TextureSink textures;
+  add("createFlatTexture (WAD flats)", first.flats.size(),
+      first.flats.size() * 64 * 64 * 4, [&] {
+        textures.clear();
+        for (std::size_t f = 0; f < first.flats.size(); f++) {
+          textures.addFlat(first.flats[f], first.palette);
+        }
+        return static_cast<uint64_t>(textures.bytes());
+      });
+
+  WAD::FlatData flat = {};
+  LumpName("SYNFLAT").copyTo(flat.name);
+  flat.data.resize(64 * 64);
+  for (std::size_t i = 0; i < flat.data.size(); i++) {
+    flat.data[i] = static_cast<uint8_t>(i * 31);
+  }
+  add("createFlatTexture (synthetic)", 1, 64 * 64 * 4, [&] {
+    textures.clear();
+    textures.addFlat(flat, palette);
+    return static_cast<uint64_t>(textures.bytes());
+  });
+
+  // Level loading, one operation per level
+  add("processStack", levels.size(), 0, [&] {
+    QuietOutput quiet;
+    wads.processStack();
+    return static_cast<uint64_t>(wads.getLevelCount());
+  });
+
+  // Geometry alone, then with the textures of the level
+  for (std::size_t l = 0; l < levels.size(); l++) {
+    add("buildLevelMesh " + LumpName(levels[l].name).str(), 1, 0, [&] {
+      return static_cast<uint64_t>(
+          WADConverter::buildLevelMesh(levels[l]).groups.size());
+    });
+  }
+  for (std::size_t l = 0; l < levels.size(); l++) {
+    add("createLevelGeometry " + LumpName(levels[l].name).str(), 1, 0,
+        [&] { return convertLevel(levels[l], textures); });
+  }
+
+  // Chunked conversion of a big level on pools of growing size, the speedup
+  // is against the pool of one thread
+  if (!pwad.empty()) {
+    WADStack layered;
+    {
+      QuietOutput quiet;
+      layered.addWAD(filepath);
+      layered.addWAD(pwad);
+      layered.processStack();
+    }
+    WAD        top(pwad);
+    WAD::Level big;
+    for (std::size_t i = 0; i < top.getDirectory().size(); i++) {
+      LumpName name(top.getDirectory()[i].name);
+      if (top.isLevelMarker(name)) {
+        big = layered.getLevel(name.str());
+        break;
+      }
+    }
+    std::string levelName = LumpName(big.name).str();
+    std::cout << "\nbuildLevelMesh scaling on " << levelName << " of " << pwad
+              << ", " << big.linedefs.size() << " linedefs, "
+              << std::thread::hardware_concurrency() << " hardware threads\n";
+
+    add("scaling " + levelName + ", serial", 1, 0, [&] {
+      return static_cast<uint64_t>(
+          WADConverter::buildLevelMesh(big).groups.size());
+    });
+
+    double      oneThread      = 0;
+    std::size_t threadCounts[] = {1, 2, 4, 8};
+    for (std::size_t t = 0; t < 4; t++) {
+      ThreadPool  pool(threadCounts[t]);
+      std::size_t before = results.size();
+      add("scaling " + levelName + ", " + std::to_string(threadCounts[t]) +
+              " threads",
+          1, 0, [&] {
+            return static_cast<uint64_t>(
+                WADConverter::buildLevelMesh(big, &pool).groups.size());
+          });
+      if (results.size() > before) {
+        if (threadCounts[t] == 1) {
+          oneThread = results.back().nanosPerOp;
+        } else if (oneThread > 0) {
+          std::cout << "  speedup " << std::setprecision(2)
+                    << oneThread / results.back().nanosPerOp << "x\n";
+        }
+      }
+    }
+  }
+
+  // Exports of every level of the WAD
+  std::size_t jsonBytes = wad.toJSON().size();
+  std::size_t dslBytes  = wad.toDSL().size();
+  add("toJSON", 1, jsonBytes,
+      [&] { return static_cast<uint64_t>(wad.toJSON().size()); });
+  add("toDSL", 1, dslBytes,
+      [&] { return static_cast<uint64_t>(wad.toDSL().size()); });
+
+  return results.empty() ? 1 : 0;
+}
@@ -0,0 +1,292 @@
+#include "allocation-tracker.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> allocationCount(0);
+std::atomic<uint64_t> allocatedBytes(0);
+std::atomic<uint64_t> freeCount(0);
+
+struct PhaseCounts {
+  const char               *name;
+  AllocationTracker::Counts counts;
+};
+
+// Fixed storage, so counting a phase does not allocate
+const std::size_t MAX_PHASES = 64;
+
+std::mutex  phasesMutex;
+PhaseCounts phases[MAX_PHASES];
+std::size_t phaseCount = 0;
+
+std::mutex                    framesMutex;
+AllocationTracker::Counts     frameStart;
+AllocationTracker::FrameStats frameStats;
+
+}  // namespace
+
+#ifdef WAD_VIEWER_ALLOC_TRACKING
+
+// Replacements of the global allocation functions. The plain and the
+// over-aligned forms count, every other form of new and delete ends up in
+// one of them
+
+void *operator new(std::size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  if (void *pointer = std::malloc(size ? size : 1)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return operator new(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return operator new(size, std::nothrow);
+}
+
+void operator delete(void *pointer) noexcept {
+  if (pointer) {
+    freeCount.fetch_add(1, std::memory_order_relaxed);
+    std::free(pointer);
+  }
+}
+
+void operator delete[](void *pointer) noexcept { operator delete(pointer); }
+
+void operator delete(void *pointer, std::size_t) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+  operator delete(pointer);
+}
+
+// Over-aligned types, for alignments above __STDCPP_DEFAULT_NEW_ALIGNMENT__
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+  // aligned_alloc() wants a size that is a multiple of the alignment
+  std::size_t align   = static_cast<std::size_t>(alignment);
+  std::size_t rounded =
+      (std::max<std::size_t>(size, 1) + align - 1) & ~(align - 1);
+  if (void *pointer = std::aligned_alloc(align, rounded)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+  try {
+    return operator new(size, alignment);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  return operator new(size, alignment, std::nothrow);
+}
+
+// aligned_alloc() memory is released with free(), like malloc() memory
+void operator delete(void *pointer, std::align_val_t) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t,
+                       std::align_val_t) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  operator delete(pointer);
+}
+
+#endif
+
+AllocationTracker::Counts
+AllocationTracker::Counts::operator-(const Counts &other) const {
+  Counts difference;
+  difference.allocations = allocations - other.allocations;
+  difference.bytes       = bytes - other.bytes;
+  difference.frees       = frees - other.frees;
+  return difference;
+}
+
+AllocationTracker::Counts &
+AllocationTracker::Counts::operator+=(const Counts &other) {
+  allocations += other.allocations;
+  bytes += other.bytes;
+  frees += other.frees;
+  return *this;
+}
+
+/**
+ * @brief Check whether allocations are counted
+ * @return true in builds with WAD_VIEWER_ALLOC_TRACKING defined
+ */
+bool AllocationTracker::enabled() {
+#ifdef WAD_VIEWER_ALLOC_TRACKING
+  return true;
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Get the allocations made since the program started
+ * @return The totals, zero if allocations are not counted
+ */
+AllocationTracker::Counts AllocationTracker::current() {
+  Counts counts;
+  counts.allocations = allocationCount.load(std::memory_order_relaxed);
+  counts.bytes       = allocatedBytes.load(std::memory_order_relaxed);
+  counts.frees       = freeCount.load(std::memory_order_relaxed);
+  return counts;
+}
+
+/**
+ * @brief Start counting a phase
+ * @param name Phase name, a string literal
+ */
+AllocationTracker::Phase::Phase(const char *name)
+    : name_(name), begin_(AllocationTracker::current()) {}
+
+/**
+ * @brief Add what was allocated since construction to the phase
+ */
+AllocationTracker::Phase::~Phase() {
+  AllocationTracker::addPhase(name_, AllocationTracker::current() - begin_);
+}
+
+/**
+ * @brief Add counts to a phase, creating it the first time its name is seen
+ * @param name Phase name
+ * @param counts Allocations made during the phase
+ * @note Phases past MAX_PHASES are not kept.
+ */
+void AllocationTracker::addPhase(const char *name, const Counts &counts) {
+  std::lock_guard<std::mutex> lock(phasesMutex);
+  for (std::size_t i = 0; i < phaseCount; i++) {
+    if (std::strcmp(phases[i].name, name) == 0) {
+      phases[i].counts += counts;
+      return;
+    }
+  }
+  if (phaseCount < MAX_PHASES) {
+    phases[phaseCount].name   = name;
+    phases[phaseCount].counts = counts;
+    phaseCount++;
+  }
+}
+
+/**
+ * @brief End the current frame and start the next one
+ */
+void AllocationTracker::markFrame() {
+  std::lock_guard<std::mutex> lock(framesMutex);
+  Counts                      now   = current();
+  Counts                      frame = now - frameStart;
+
+  frameStart = now;
+
+  frameStats.frames++;
+  frameStats.allocations += frame.allocations;
+  frameStats.bytes += frame.bytes;
+  frameStats.maxAllocations =
+      std::max(frameStats.maxAllocations, frame.allocations);
+  if (frame.allocations > 0) {
+    frameStats.allocatingFrames++;
+  }
+}
+
+/**
+ * @brief Forget the frames counted so far, for instance the warm-up ones
+ */
+void AllocationTracker::resetFrames() {
+  std::lock_guard<std::mutex> lock(framesMutex);
+  frameStart = current();
+  frameStats = FrameStats();
+}
+
+/**
+ * @brief Get the frames counted since the start or the last reset
+ * @return Frame count and what the frames allocated
+ */
+AllocationTracker::FrameStats AllocationTracker::frames() {
+  std::lock_guard<std::mutex> lock(framesMutex);
+  return frameStats;
+}
+
+/**
+ * @brief Print one line per phase, in the order they were first seen, and
+ * one for the frames
+ * @param out Stream to print to
+ */
+void AllocationTracker::report(std::ostream &out) {
+  if (!enabled()) {
+    out << "Allocations are not counted, build with make ALLOC_TRACKING=1\n";
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(phasesMutex);
+    for (std::size_t i = 0; i < phaseCount; i++) {
+      const Counts &counts = phases[i].counts;
+      out << phases[i].name << ": " << counts.allocations << " allocations, "
+          << counts.bytes << " bytes, " << counts.frees << " frees\n";
+    }
+  }
+
+  FrameStats stats = frames();
+  if (stats.frames > 0) {
+    out << "Frames: " << stats.frames << ", " << stats.allocatingFrames
+        << " allocating, " << stats.allocations << " allocations ("
+        << stats.allocations / stats.frames << " per frame, at most "
+        << stats.maxAllocations << "), " << stats.bytes << " bytes\n";
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef WAD_VIEWER_ALLOCATION_TRACKER_HPP
+#define WAD_VIEWER_ALLOCATION_TRACKER_HPP
+
+#include <cstdint>
+#include <ostream>
+
+/**
+ * @brief Heap allocation counts of the whole program, by named phase and by
+ * frame.
+ *
+ * Only builds with WAD_VIEWER_ALLOC_TRACKING defined (make ALLOC_TRACKING=1)
+ * replace the global operator new and delete to count; otherwise every
+ * count stays at zero and enabled() is false. Counts are atomic and include
+ * the pool workers, so a phase also counts what other threads allocate
+ * while it lasts. Phase names must be string literals, they are stored as
+ * pointers, and the tracker itself never allocates.
+ */
+class AllocationTracker {
+public:
+  struct Counts {
+    uint64_t allocations = 0;
+    uint64_t bytes       = 0;  // Requested by the allocations
+    uint64_t frees       = 0;
+
+    Counts operator-(const Counts &other) const;
+    Counts &operator+=(const Counts &other);
+  };
+
+  struct FrameStats {
+    uint64_t frames           = 0;
+    uint64_t allocatingFrames = 0;
+    uint64_t allocations      = 0;
+    uint64_t bytes            = 0;
+    uint64_t maxAllocations   = 0;  // Of a single frame
+  };
+
+  // Whether operator new and delete are counted in this build
+  static bool enabled();
+
+  // Totals since the program started
+  static Counts current();
+
+  // Counts from construction to destruction, added to the phase with the
+  // same name in report()
+  class Phase {
+  public:
+    explicit Phase(const char *name);
+    ~Phase();
+
+    Phase(const Phase &)            = delete;
+    Phase &operator=(const Phase &) = delete;
+
+  private:
+    const char *name_;
+    Counts      begin_;
+  };
+
+  // End the current frame, what was allocated since the previous mark
+  // counts as one frame
+  static void markFrame();
+
+  // Drop the frames counted so far, the next mark ends the first frame
+  static void resetFrames();
+
+  static FrameStats frames();
+
+  // Print the counts of every phase and the frame totals
+  static void report(std::ostream &out);
+
+private:
+  static void addPhase(const char *name, const Counts &counts);
+};
+
+#endif  // WAD_VIEWER_ALLOCATION_TRACKER_HPP
@@ -0,0 +1,277 @@
+#include "automap.hpp"
+#include "lump-name.hpp"
+#include "png-file.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+namespace {
+
+// Fractional part, for the coverage of Wu's lines
+float fraction(float value) { return value - std::floor(value); }
+
+// File name of a path without its directory and extension
+std::string baseName(const std::string &path) {
+  std::size_t slash = path.find_last_of("/\\");
+  std::string name =
+      slash == std::string::npos ? path : path.substr(slash + 1);
+  std::size_t dot = name.find_last_of('.');
+  return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+}  // namespace
+
+/**
+ * @brief Create a renderer for square images
+ * @param size Width and height of the images in pixels
+ */
+AutomapRenderer::AutomapRenderer(int size) : size_(size) {}
+
+/**
+ * @brief Draw the overview of a level
+ * @param level The level, only its geometry and things are used
+ * @param image Resized to size x size and overwritten
+ */
+void AutomapRenderer::render(const WAD::Level &level, Image &image) const {
+  const Color WALL      = {252, 0, 0};
+  const Color TWO_SIDED = {128, 128, 128};
+  const Color SPECIAL   = {252, 252, 0};
+  const Color THING     = {0, 200, 0};
+  const Color PLAYER    = {255, 255, 255};
+
+  image.width  = size_;
+  image.height = size_;
+  image.rgba.assign(static_cast<std::size_t>(size_) * size_ * 4, 0);
+  for (std::size_t i = 3; i < image.rgba.size(); i += 4) {
+    image.rgba[i] = 255;
+  }
+
+  if (level.vertices.size() == 0) {
+    return;
+  }
+
+  float minX = std::numeric_limits<float>::max();
+  float minY = std::numeric_limits<float>::max();
+  float maxX = std::numeric_limits<float>::lowest();
+  float maxY = std::numeric_limits<float>::lowest();
+  for (std::size_t i = 0; i < level.vertices.size(); i++) {
+    WAD::Vertex vertex = level.vertices[i];
+    minX               = std::min(minX, static_cast<float>(vertex.x));
+    maxX               = std::max(maxX, static_cast<float>(vertex.x));
+    minY               = std::min(minY, static_cast<float>(vertex.y));
+    maxY               = std::max(maxY, static_cast<float>(vertex.y));
+  }
+
+  // Fit the level in the image, centered, with map y going up
+  float extent  = std::max(std::max(maxX - minX, maxY - minY), 1.0f);
+  float scale   = (size_ - 2.0f * MARGIN) / extent;
+  float offsetX = (size_ - (maxX - minX) * scale) / 2.0f;
+  float offsetY = (size_ - (maxY - minY) * scale) / 2.0f;
+  auto  toImage = [&](float x, float y, float &outX, float &outY) {
+    outX = offsetX + (x - minX) * scale;
+    outY = size_ - 1.0f - (offsetY + (y - minY) * scale);
+  };
+
+  // Walls and specials over the two-sided lines, as they matter more
+  for (int pass = 0; pass < 3; pass++) {
+    for (std::size_t i = 0; i < level.linedefs.size(); i++) {
+      WAD::Linedef line = level.linedefs[i];
+      if (line.start_vertex >= level.vertices.size() ||
+          line.end_vertex >= level.vertices.size()) {
+        continue;
+      }
+
+      bool twoSided = line.left_sidedef != 0xFFFF;
+      int  linePass = line.line_type != 0 ? 2 : (twoSided ? 0 : 1);
+      if (linePass != pass) {
+        continue;
+      }
+
+      WAD::Vertex start = level.vertices[line.start_vertex];
+      WAD::Vertex end   = level.vertices[line.end_vertex];
+      float       x0, y0, x1, y1;
+      toImage(start.x, start.y, x0, y0);
+      toImage(end.x, end.y, x1, y1);
+      drawLine(image, x0, y0, x1, y1,
+               pass == 2 ? SPECIAL : (pass == 1 ? WALL : TWO_SIDED));
+    }
+  }
+
+  for (std::size_t i = 0; i < level.things.size(); i++) {
+    WAD::Thing thing = level.things[i];
+    float      x, y;
+    toImage(thing.x, thing.y, x, y);
+    drawDot(image, x, y, 1.5f, THING);
+  }
+
+  if (level.has_player_start) {
+    const WAD::Thing &start = level.player_start;
+    float             angle = start.angle * static_cast<float>(M_PI) / 180.0f;
+    float             x, y;
+    toImage(start.x, start.y, x, y);
+    drawDot(image, x, y, 3.0f, PLAYER);
+    drawLine(image, x, y, x + std::cos(angle) * 8.0f,
+             y - std::sin(angle) * 8.0f, PLAYER);
+  }
+}
+
+/**
+ * @brief Render the overview of every level of a list of WADs
+ * @param wadFiles Paths of the WADs, each one is read on its own
+ * @param outputDir Existing directory for the PNG files
+ * @param pool Threads to render the levels on, one task per level
+ * @return Number of levels and lines drawn, and the time it took
+ * @throws std::runtime_error if a WAD cannot be opened or a file written
+ */
+AutomapRenderer::CatalogueStats
+AutomapRenderer::renderCatalogue(const std::vector<std::string> &wadFiles,
+                                 const std::string &outputDir,
+                                 ThreadPool        &pool) const {
+  struct Job {
+    std::size_t wad;
+    std::size_t marker;  // Directory index of the level marker
+  };
+
+  auto start = std::chrono::steady_clock::now();
+
+  // Opening maps the files and reads the directories, which is cheap; the
+  // levels are decoded on the workers
+  std::vector<std::unique_ptr<WAD>> wads;
+  std::vector<Job>                  jobs;
+  for (std::size_t w = 0; w < wadFiles.size(); w++) {
+    wads.push_back(std::unique_ptr<WAD>(new WAD(wadFiles[w])));
+    const std::vector<WAD::Directory> &directory = wads[w]->getDirectory();
+    for (std::size_t d = 0; d < directory.size(); d++) {
+      if (wads[w]->isLevelMarker(LumpName(directory[d].name))) {
+        jobs.push_back(Job{w, d});
+      }
+    }
+  }
+
+  std::atomic<std::size_t>  lines(0);
+  PNGFile::CompressionScope compression(PNG_COMPRESSION);
+  pool.parallelFor(jobs.size(), [&](std::size_t j) {
+    WAD       &wad = *wads[jobs[j].wad];
+    LumpName   name(wad.getDirectory()[jobs[j].marker].name);
+    WAD::Level level;
+    name.copyTo(level.name);
+    wad.readLevelGeometry(jobs[j].marker, level);
+
+    Image image;
+    render(level, image);
+    PNGFile::write(outputDir + "/" + baseName(wadFiles[jobs[j].wad]) + "_" +
+                       name.str() + ".png",
+                   image.width, image.height, image.rgba.data());
+    lines += level.linedefs.size();
+  });
+
+  CatalogueStats stats;
+  stats.levels       = jobs.size();
+  stats.lines        = lines;
+  stats.milliseconds = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  return stats;
+}
+
+/**
+ * @brief Blend a color over a pixel
+ * @param image The image
+ * @param x Column, pixels outside the image are skipped
+ * @param y Row
+ * @param color Color to blend
+ * @param coverage Part of the pixel covered, from 0 to 1
+ */
+void AutomapRenderer::plot(Image &image, int x, int y, Color color,
+                           float coverage) {
+  if (x < 0 || y < 0 || x >= image.width || y >= image.height ||
+      coverage <= 0.0f) {
+    return;
+  }
+
+  unsigned char *pixel =
+      &image.rgba[(static_cast<std::size_t>(y) * image.width + x) * 4];
+  const unsigned char source[3] = {color.r, color.g, color.b};
+  float               alpha     = std::min(coverage, 1.0f);
+  for (int c = 0; c < 3; c++) {
+    pixel[c] = static_cast<unsigned char>(
+        std::lround(pixel[c] + (source[c] - pixel[c]) * alpha));
+  }
+}
+
+/**
+ * @brief Draw an anti-aliased line with Wu's algorithm
+ * @param image The image
+ * @param x0 Start column, pixel centers are at integer coordinates
+ * @param y0 Start row
+ * @param x1 End column
+ * @param y1 End row
+ * @param color Color of the line
+ * @note Every step covers two pixels across the line, weighted by the
+ * distance of the line to their centers.
+ */
+void AutomapRenderer::drawLine(Image &image, float x0, float y0, float x1,
+                               float y1, Color color) {
+  bool steep = std::fabs(y1 - y0) > std::fabs(x1 - x0);
+  if (steep) {
+    std::swap(x0, y0);
+    std::swap(x1, y1);
+  }
+  if (x0 > x1) {
+    std::swap(x0, x1);
+    std::swap(y0, y1);
+  }
+
+  float dx       = x1 - x0;
+  float gradient = dx == 0.0f ? 1.0f : (y1 - y0) / dx;
+
+  // Endpoints cover the part of their pixel the line spans
+  int   xStart = static_cast<int>(std::round(x0));
+  int   xEnd   = static_cast<int>(std::round(x1));
+  float y      = y0 + gradient * (xStart - x0);
+  for (int x = xStart; x <= xEnd; x++) {
+    float weight = 1.0f;
+    if (x == xStart) {
+      weight = 1.0f - fraction(x0 + 0.5f);
+    }
+    if (x == xEnd) {
+      weight = xStart == xEnd ? x1 - x0 : fraction(x1 + 0.5f);
+    }
+
+    int   row   = static_cast<int>(std::floor(y));
+    float below = fraction(y);
+    if (steep) {
+      plot(image, row, x, color, (1.0f - below) * weight);
+      plot(image, row + 1, x, color, below * weight);
+    } else {
+      plot(image, x, row, color, (1.0f - below) * weight);
+      plot(image, x, row + 1, color, below * weight);
+    }
+    y += gradient;
+  }
+}
+
+/**
+ * @brief Draw a filled, anti-aliased dot
+ * @param image The image
+ * @param x Center column
+ * @param y Center row
+ * @param radius Radius in pixels
+ * @param color Color of the dot
+ */
+void AutomapRenderer::drawDot(Image &image, float x, float y, float radius,
+                              Color color) {
+  int minX = static_cast<int>(std::floor(x - radius));
+  int maxX = static_cast<int>(std::ceil(x + radius));
+  int minY = static_cast<int>(std::floor(y - radius));
+  int maxY = static_cast<int>(std::ceil(y + radius));
+  for (int py = minY; py <= maxY; py++) {
+    for (int px = minX; px <= maxX; px++) {
+      float distance = std::hypot(px - x, py - y);
+      plot(image, px, py, color, radius + 0.5f - distance);
+    }
+  }
+}
@@ -0,0 +1,75 @@
+#ifndef WAD_VIEWER_AUTOMAP_HPP
+#define WAD_VIEWER_AUTOMAP_HPP
+
+#include "./thread-pool.hpp"
+#include "./wad.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Top-down overview images of levels, in the colors of the DOOM
+ * automap, for browsing WAD catalogues.
+ *
+ * Only the geometry lumps are read, so levels of PWADs render without their
+ * IWAD. Lines are drawn anti-aliased with Wu's algorithm: walls in red,
+ * two-sided lines in gray, lines with a special in yellow, things as green
+ * dots and the player start as a white dot with a tick in its direction.
+ * The level is scaled to fit the image, keeping its aspect ratio.
+ */
+class AutomapRenderer {
+public:
+  // RGBA pixels, rows top to bottom
+  struct Image {
+    int                        width  = 0;
+    int                        height = 0;
+    std::vector<unsigned char> rgba;
+  };
+
+  // Levels rendered by renderCatalogue()
+  struct CatalogueStats {
+    std::size_t levels       = 0;
+    std::size_t lines        = 0;
+    double      milliseconds = 0.0;
+
+    double levelsPerSecond() const {
+      return milliseconds > 0.0 ? levels * 1000.0 / milliseconds : 0.0;
+    }
+  };
+
+  explicit AutomapRenderer(int size = 512);
+
+  // Draw a level into an image of size x size pixels
+  void render(const WAD::Level &level, Image &image) const;
+
+  // Render every level of every WAD on the pool, saving one PNG per level
+  // in outputDir as <wad name>_<level>.png
+  CatalogueStats renderCatalogue(const std::vector<std::string> &wadFiles,
+                                 const std::string &outputDir,
+                                 ThreadPool        &pool) const;
+
+private:
+  // Free space around the level, in pixels
+  static const int MARGIN = 8;
+
+  // zlib effort of the PNG files. Encoding costs far more than drawing, and
+  // the mostly black images stay small at the fastest level
+  static const int PNG_COMPRESSION = 5;
+
+  // Color of an element, in RGB
+  struct Color {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+  };
+
+  int size_;
+
+  static void plot(Image &image, int x, int y, Color color, float coverage);
+  static void drawLine(Image &image, float x0, float y0, float x1, float y1,
+                       Color color);
+  static void drawDot(Image &image, float x, float y, float radius,
+                      Color color);
+};
+
+#endif  // WAD_VIEWER_AUTOMAP_HPP
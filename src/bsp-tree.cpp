@@ -0,0 +1,217 @@
+#include "bsp-tree.hpp"
+#include <cmath>
+
+/**
+ * @brief Copy the BSP lumps of a level
+ * @param level The level, its segs, subsectors and nodes may be empty
+ */
+BSPTree::BSPTree(const WAD::Level &level) {
+  segs_.resize(level.segs.size());
+  for (std::size_t i = 0; i < level.segs.size(); i++) {
+    WAD::Seg seg     = level.segs[i];
+    segs_[i].linedef = seg.linedef;
+    segs_[i].side    = seg.direction ? 1 : 0;
+  }
+
+  subsectorFirst_.resize(level.subsectors.size());
+  subsectorCount_.resize(level.subsectors.size());
+  for (std::size_t i = 0; i < level.subsectors.size(); i++) {
+    WAD::Subsector subsector = level.subsectors[i];
+    if (static_cast<std::size_t>(subsector.first_seg) + subsector.seg_count >
+        segs_.size()) {
+      subsectorFirst_.clear();
+      return;
+    }
+    subsectorFirst_[i] = subsector.first_seg;
+    subsectorCount_[i] = subsector.seg_count;
+  }
+
+  // The root is the last node, children always come before their parent, so
+  // a walk from the root cannot loop
+  nodes_.resize(level.nodes.size());
+  for (std::size_t i = 0; i < level.nodes.size(); i++) {
+    nodes_[i] = level.nodes[i];
+    for (int c = 0; c < 2; c++) {
+      uint16_t child = nodes_[i].children[c];
+      bool     valid = (child & WAD::Node::SUBSECTOR_BIT)
+                           ? (child & ~WAD::Node::SUBSECTOR_BIT) <
+                                 subsectorFirst_.size()
+                           : child < i;
+      if (!valid) {
+        subsectorFirst_.clear();
+        nodes_.clear();
+        return;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Get the segs of a subsector
+ * @param subsector Subsector index, below subsectorCount()
+ * @return Pointer to the first seg of the subsector
+ */
+const BSPTree::Seg *BSPTree::subsectorSegs(std::size_t subsector) const {
+  return segs_.data() + subsectorFirst_[subsector];
+}
+
+/**
+ * @brief Get the number of segs of a subsector
+ * @param subsector Subsector index, below subsectorCount()
+ * @return Number of segs
+ */
+std::size_t BSPTree::subsectorSegCount(std::size_t subsector) const {
+  return subsectorCount_[subsector];
+}
+
+/**
+ * @brief Order the subsectors from the farthest to the nearest to a point
+ * @param x Map X coordinate of the viewpoint
+ * @param y Map Y coordinate of the viewpoint
+ * @param subsectors Cleared and filled with every subsector index
+ */
+void BSPTree::backToFront(float x, float y,
+                          std::vector<uint16_t> &subsectors) const {
+  subsectors.clear();
+  if (empty()) {
+    return;
+  }
+
+  // A level with a single subsector has no nodes
+  if (nodes_.empty()) {
+    subsectors.push_back(0);
+    return;
+  }
+
+  backToFront(static_cast<uint16_t>(nodes_.size() - 1), x, y, subsectors);
+}
+
+/**
+ * @brief Walk a subtree, the half away from the viewpoint first
+ * @param child Node index, or subsector index with SUBSECTOR_BIT set
+ * @param x Map X coordinate of the viewpoint
+ * @param y Map Y coordinate of the viewpoint
+ * @param subsectors Subsector indices found so far
+ */
+void BSPTree::backToFront(uint16_t child, float x, float y,
+                          std::vector<uint16_t> &subsectors) const {
+  if (child & WAD::Node::SUBSECTOR_BIT) {
+    subsectors.push_back(child & ~WAD::Node::SUBSECTOR_BIT);
+    return;
+  }
+
+  const WAD::Node &node = nodes_[child];
+  int              side = pointSide(node, x, y);
+  backToFront(node.children[side ^ 1], x, y, subsectors);
+  backToFront(node.children[side], x, y, subsectors);
+}
+
+/**
+ * @brief Order the visible subsectors from the nearest to the farthest
+ * @param x Map X coordinate of the viewpoint
+ * @param y Map Y coordinate of the viewpoint
+ * @param angle View direction in radians, 0 is east, counterclockwise
+ * @param halfFov Half the horizontal field of view in radians
+ * @param subsectors Cleared and filled with the subsectors in the view cone
+ * @note Culling is conservative: a box is dropped only when it is entirely
+ * on the outer side of one edge of the cone, so some subsectors behind the
+ * viewpoint may be kept.
+ */
+void BSPTree::frontToBack(float x, float y, float angle, float halfFov,
+                          std::vector<uint16_t> &subsectors) const {
+  subsectors.clear();
+  if (empty()) {
+    return;
+  }
+  if (nodes_.empty()) {
+    subsectors.push_back(0);
+    return;
+  }
+
+  ViewCone cone;
+  cone.x      = x;
+  cone.y      = y;
+  cone.leftX  = std::cos(angle + halfFov);
+  cone.leftY  = std::sin(angle + halfFov);
+  cone.rightX = std::cos(angle - halfFov);
+  cone.rightY = std::sin(angle - halfFov);
+  cone.cull   = halfFov < 1.5707963f;
+
+  frontToBack(static_cast<uint16_t>(nodes_.size() - 1), cone, subsectors);
+}
+
+/**
+ * @brief Walk a subtree, the half of the viewpoint first
+ * @param child Node index, or subsector index with SUBSECTOR_BIT set
+ * @param cone The view cone
+ * @param subsectors Subsector indices found so far
+ */
+void BSPTree::frontToBack(uint16_t child, const ViewCone &cone,
+                          std::vector<uint16_t> &subsectors) const {
+  if (child & WAD::Node::SUBSECTOR_BIT) {
+    subsectors.push_back(child & ~WAD::Node::SUBSECTOR_BIT);
+    return;
+  }
+
+  const WAD::Node &node = nodes_[child];
+  int              side = pointSide(node, cone.x, cone.y);
+  if (!cone.outside(node.bbox[side])) {
+    frontToBack(node.children[side], cone, subsectors);
+  }
+  if (!cone.outside(node.bbox[side ^ 1])) {
+    frontToBack(node.children[side ^ 1], cone, subsectors);
+  }
+}
+
+/**
+ * @brief Check whether a bounding box is out of the view cone
+ * @param bbox Top, bottom, left and right map coordinates
+ * @return true if every corner is beyond the same edge of the cone
+ */
+bool BSPTree::ViewCone::outside(const int16_t bbox[4]) const {
+  if (!cull) {
+    return false;
+  }
+
+  bool beyondLeft  = true;
+  bool beyondRight = true;
+  for (int c = 0; c < 4; c++) {
+    float dx = (c & 1 ? bbox[3] : bbox[2]) - x;
+    float dy = (c & 2 ? bbox[0] : bbox[1]) - y;
+    beyondLeft  = beyondLeft && leftX * dy - leftY * dx > 0.0f;
+    beyondRight = beyondRight && rightX * dy - rightY * dx < 0.0f;
+  }
+  return beyondLeft || beyondRight;
+}
+
+/**
+ * @brief Find the subsector containing a point
+ * @param x Map X coordinate
+ * @param y Map Y coordinate
+ * @return Subsector index, 0 if the tree is empty
+ */
+uint16_t BSPTree::findSubsector(float x, float y) const {
+  if (nodes_.empty()) {
+    return 0;
+  }
+
+  uint16_t child = static_cast<uint16_t>(nodes_.size() - 1);
+  while (!(child & WAD::Node::SUBSECTOR_BIT)) {
+    const WAD::Node &node = nodes_[child];
+    child                 = node.children[pointSide(node, x, y)];
+  }
+  return child & ~WAD::Node::SUBSECTOR_BIT;
+}
+
+/**
+ * @brief Find the side of a partition line a point is on, as R_PointOnSide
+ * @param node The node holding the partition line
+ * @param x Map X coordinate of the point
+ * @param y Map Y coordinate of the point
+ * @return 0 for the right (front) child, 1 for the left (back) one
+ */
+int BSPTree::pointSide(const WAD::Node &node, float x, float y) {
+  float left  = node.dy * (x - node.x);
+  float right = (y - node.y) * node.dx;
+  return right < left ? 0 : 1;
+}
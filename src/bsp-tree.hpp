@@ -0,0 +1,81 @@
+#ifndef WAD_VIEWER_BSP_TREE_HPP
+#define WAD_VIEWER_BSP_TREE_HPP
+
+#include "./wad.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief BSP tree of a level, as built by the node builder (NODES, SSECTORS
+ * and SEGS lumps), for ordering surfaces by distance to a viewpoint.
+ *
+ * The lumps are copied, so the tree does not depend on the WAD data. Each
+ * node splits the map with a line; walking the side of the viewpoint last
+ * gives the subsectors from the farthest to the nearest, which is the order
+ * DOOM draws masked middle textures and sprites in. A tree with references
+ * out of range or children that do not come before their parent is treated
+ * as empty.
+ */
+class BSPTree {
+public:
+  // Seg of a subsector, as far as ordering is concerned
+  struct Seg {
+    uint16_t linedef;
+    uint16_t side;  // 0 right side of the linedef, 1 left side
+  };
+
+  explicit BSPTree(const WAD::Level &level);
+
+  bool        empty() const { return subsectorFirst_.empty(); }
+  std::size_t subsectorCount() const { return subsectorFirst_.size(); }
+  std::size_t segCount() const { return segs_.size(); }
+
+  // Segs of a subsector, subsectorSegCount(subsector) in a row
+  const Seg  *subsectorSegs(std::size_t subsector) const;
+  std::size_t subsectorSegCount(std::size_t subsector) const;
+
+  // Subsectors from the farthest to the nearest to a map position, into a
+  // reused buffer
+  void backToFront(float x, float y, std::vector<uint16_t> &subsectors) const;
+
+  // Subsectors from the nearest to the farthest, leaving out the subtrees
+  // whose bounding box is outside the view cone. angle is the view direction
+  // in radians (0 east, counterclockwise), halfFov half the horizontal field
+  // of view; no culling from pi / 2 on.
+  void frontToBack(float x, float y, float angle, float halfFov,
+                   std::vector<uint16_t> &subsectors) const;
+
+  // Subsector containing a map position, 0 for an empty tree
+  uint16_t findSubsector(float x, float y) const;
+
+private:
+  // Edges of a view cone, for culling node bounding boxes
+  struct ViewCone {
+    float x;
+    float y;
+    float leftX;  // Direction of the left edge
+    float leftY;
+    float rightX;  // Direction of the right edge
+    float rightY;
+    bool  cull;
+
+    bool outside(const int16_t bbox[4]) const;
+  };
+
+
+  std::vector<WAD::Node> nodes_;
+  std::vector<uint16_t>  subsectorFirst_;
+  std::vector<uint16_t>  subsectorCount_;
+  std::vector<Seg>       segs_;
+
+  void backToFront(uint16_t child, float x, float y,
+                   std::vector<uint16_t> &subsectors) const;
+  void frontToBack(uint16_t child, const ViewCone &cone,
+                   std::vector<uint16_t> &subsectors) const;
+
+  // 0 if the point is on the right (front) of the node's partition line
+  static int pointSide(const WAD::Node &node, float x, float y);
+};
+
+#endif  // WAD_VIEWER_BSP_TREE_HPP
@@ -0,0 +1,169 @@
+#include "compact-mesh.hpp"
+#include <cmath>
+
+namespace {
+
+/**
+ * @brief Round a value to the nearest int16, clamping it to the int16 range
+ * @param value Value to convert
+ * @param clamped Incremented if the value had to be clamped
+ * @return The rounded value
+ */
+int16_t toInt16(float value, std::size_t &clamped) {
+  float rounded = std::round(value);
+  if (rounded < -32768.0f) {
+    clamped++;
+    return -32768;
+  }
+  if (rounded > 32767.0f) {
+    clamped++;
+    return 32767;
+  }
+  return static_cast<int16_t>(rounded);
+}
+
+}  // namespace
+
+/**
+ * @brief Quantize a vertex
+ * @param in Float vertex built by the converter
+ * @param clampedUVs Incremented for every coordinate that did not fit
+ * @return The compact vertex
+ */
+CompactLevelMesh::Vertex CompactLevelMesh::encodeVertex(
+    const LevelMesh::Vertex &in, std::size_t &clampedUVs) const {
+  // Positions always fit, they come from 16-bit map data
+  std::size_t positionsClamped = 0;
+
+  // Undo the centering and scaling done by the converter
+  float x = in.pos[0] / scale + centerX;
+  float y = -in.pos[2] / scale + centerY;
+
+  Vertex out;
+  out.pos[0]  = toInt16(x, positionsClamped);
+  out.pos[1]  = toInt16(in.pos[1] / scale, positionsClamped);
+  out.pos[2]  = toInt16(y, positionsClamped);
+  out.padding = 0;
+  out.uv[0]   = toInt16(in.uv[0] * UV_SCALE, clampedUVs);
+  out.uv[1]   = toInt16(in.uv[1] * UV_SCALE, clampedUVs);
+  return out;
+}
+
+/**
+ * @brief Decode a vertex
+ * @param in Compact vertex
+ * @return The float vertex
+ */
+LevelMesh::Vertex CompactLevelMesh::decodeVertex(const Vertex &in) const {
+  // Same operations as the converter, so positions match exactly
+  float x = (static_cast<float>(in.pos[0]) - centerX) * scale;
+  float z = (static_cast<float>(in.pos[2]) - centerY) * scale;
+
+  LevelMesh::Vertex out;
+  out.pos[0] = x;
+  out.pos[1] = static_cast<float>(in.pos[1]) * scale;
+  out.pos[2] = -z;
+  out.uv[0]  = static_cast<float>(in.uv[0]) / UV_SCALE;
+  out.uv[1]  = static_cast<float>(in.uv[1]) / UV_SCALE;
+  return out;
+}
+
+/**
+ * @brief Quantize a level mesh
+ * @param mesh The mesh to quantize, built with the given scale
+ * @param scale World units per DOOM unit used to build the mesh
+ * @return The compact mesh
+ */
+CompactLevelMesh CompactLevelMesh::encode(const LevelMesh &mesh, float scale) {
+  CompactLevelMesh compact;
+  compact.centerX = mesh.centerX;
+  compact.centerY = mesh.centerY;
+  compact.scale   = scale;
+
+  compact.groups.resize(mesh.groups.size());
+  for (std::size_t g = 0; g < mesh.groups.size(); g++) {
+    const LevelMesh::Group &source = mesh.groups[g];
+    Group                  &group  = compact.groups[g];
+
+    group.texture = source.texture;
+    group.sector  = source.sector;
+    group.indices = source.indices;
+    group.vertices.resize(source.vertices.size());
+
+    for (std::size_t v = 0; v < source.vertices.size(); v++) {
+      group.vertices[v] =
+          compact.encodeVertex(source.vertices[v], compact.clampedUVs);
+    }
+  }
+
+  compact.masked.resize(mesh.masked.size());
+  for (std::size_t m = 0; m < mesh.masked.size(); m++) {
+    const LevelMesh::MaskedSurface &source  = mesh.masked[m];
+    MaskedSurface                  &surface = compact.masked[m];
+
+    surface.texture = source.texture;
+    surface.linedef = source.linedef;
+    surface.side    = source.side;
+    for (int v = 0; v < 4; v++) {
+      surface.vertices[v] =
+          compact.encodeVertex(source.vertices[v], compact.clampedUVs);
+    }
+  }
+
+  return compact;
+}
+
+/**
+ * @brief Decode the compact mesh back to float vertices
+ * @return The level mesh, with the same layout the converter produces
+ */
+LevelMesh CompactLevelMesh::decode() const {
+  LevelMesh mesh;
+  mesh.centerX = centerX;
+  mesh.centerY = centerY;
+  mesh.scale   = scale;
+
+  mesh.groups.resize(groups.size());
+  for (std::size_t g = 0; g < groups.size(); g++) {
+    const Group      &source = groups[g];
+    LevelMesh::Group &group  = mesh.groups[g];
+
+    group.texture = source.texture;
+    group.sector  = source.sector;
+    group.indices = source.indices;
+    group.vertices.resize(source.vertices.size());
+
+    for (std::size_t v = 0; v < source.vertices.size(); v++) {
+      group.vertices[v] = decodeVertex(source.vertices[v]);
+    }
+  }
+
+  mesh.masked.resize(masked.size());
+  for (std::size_t m = 0; m < masked.size(); m++) {
+    const MaskedSurface      &source  = masked[m];
+    LevelMesh::MaskedSurface &surface = mesh.masked[m];
+
+    surface.texture = source.texture;
+    surface.linedef = source.linedef;
+    surface.side    = source.side;
+    for (int v = 0; v < 4; v++) {
+      surface.vertices[v] = decodeVertex(source.vertices[v]);
+    }
+  }
+
+  return mesh;
+}
+
+/**
+ * @brief Get the bytes used by the vertex and index buffers
+ * @return Size in bytes
+ */
+std::size_t CompactLevelMesh::sizeInBytes() const {
+  std::size_t bytes = 0;
+  for (std::size_t g = 0; g < groups.size(); g++) {
+    bytes += groups[g].vertices.size() * sizeof(Vertex);
+    bytes += groups[g].indices.size() * sizeof(unsigned int);
+  }
+  bytes += masked.size() * sizeof(MaskedSurface::vertices);
+  return bytes;
+}
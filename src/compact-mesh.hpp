@@ -0,0 +1,69 @@
+#ifndef WAD_VIEWER_COMPACT_MESH_HPP
+#define WAD_VIEWER_COMPACT_MESH_HPP
+
+#include "./level-mesh.hpp"
+#include "./lump-name.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Quantized copy of a LevelMesh, 12 bytes per vertex instead of 20.
+ *
+ * DOOM coordinates and heights are 16-bit integers, so positions are stored
+ * as the original map coordinates and the level center and scale are applied
+ * again when decoding, which gives back the exact float positions. Texture
+ * coordinates are stored as fixed point with UV_SCALE steps per texture
+ * repeat, a quarter of a texel on a 64 texel wide texture. Values that do not
+ * fit (more than 128 repeats) are clamped and counted.
+ */
+struct CompactLevelMesh {
+  static constexpr float UV_SCALE = 256.0f;
+
+  struct Vertex {
+    int16_t pos[3];   // x, height, y in DOOM map units
+    int16_t padding;  // Keeps uv 4-byte aligned for vertex attributes
+    int16_t uv[2];    // Texture coordinates * UV_SCALE
+  };
+
+  struct Group {
+    LumpName                  texture;
+    uint16_t                  sector = LevelMesh::NO_SECTOR;
+    std::vector<Vertex>       vertices;
+    std::vector<unsigned int> indices;
+  };
+
+  // Same as LevelMesh::MaskedSurface
+  struct MaskedSurface {
+    LumpName texture;
+    uint16_t linedef;
+    uint16_t side;
+    Vertex   vertices[4];
+  };
+
+  float                      centerX = 0.0f;
+  float                      centerY = 0.0f;
+  float                      scale   = 1.0f;
+  std::vector<Group>         groups;
+  std::vector<MaskedSurface> masked;
+  std::size_t                clampedUVs = 0;  // Coordinates that did not fit
+
+  // Quantize a mesh built with the given world scale
+  static CompactLevelMesh encode(const LevelMesh &mesh, float scale);
+
+  // Back to float vertices, positions are exact and UVs within 1/512
+  LevelMesh decode() const;
+
+  // Bytes used by the vertex and index buffers
+  std::size_t sizeInBytes() const;
+
+private:
+  Vertex            encodeVertex(const LevelMesh::Vertex &in,
+                                 std::size_t             &clampedUVs) const;
+  LevelMesh::Vertex decodeVertex(const Vertex &in) const;
+};
+
+static_assert(sizeof(CompactLevelMesh::Vertex) == 12,
+              "CompactLevelMesh::Vertex must be 12 bytes");
+
+#endif  // WAD_VIEWER_COMPACT_MESH_HPP
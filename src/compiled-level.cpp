@@ -0,0 +1,102 @@
+#include "compiled-level.hpp"
+#include "./trace.hpp"
+#include <algorithm>
+#include <unordered_map>
+
+/**
+ * @brief Build the struct-of-arrays view of a level
+ * @param level Level as decoded from the WAD lumps
+ * @note Texture ids are assigned in name order, so iterating by id visits
+ *       textures in the same order as iterating names alphabetically.
+ */
+CompiledLevel::CompiledLevel(const WAD::Level &level) {
+  TRACE_ZONE("CompiledLevel::compile");
+  // Build the texture name table from every name used by sidedefs and sectors
+  texture_names.reserve(level.sidedefs.size() * 3 + level.sectors.size() * 2);
+  for (size_t i = 0; i < level.sidedefs.size(); i++) {
+    const WAD::Sidedef &s = level.sidedefs[i];
+    texture_names.push_back(LumpName(s.upper_texture));
+    texture_names.push_back(LumpName(s.lower_texture));
+    texture_names.push_back(LumpName(s.middle_texture));
+  }
+  for (size_t i = 0; i < level.sectors.size(); i++) {
+    const WAD::Sector &s = level.sectors[i];
+    texture_names.push_back(LumpName(s.floor_texture));
+    texture_names.push_back(LumpName(s.ceiling_texture));
+  }
+
+  std::sort(texture_names.begin(), texture_names.end());
+  texture_names.erase(std::unique(texture_names.begin(), texture_names.end()),
+                      texture_names.end());
+  texture_names.erase(std::remove_if(texture_names.begin(),
+                                     texture_names.end(),
+                                     [](const LumpName &name) {
+                                       return name.isNoTexture();
+                                     }),
+                      texture_names.end());
+  texture_names.insert(texture_names.begin(), LumpName());  // NO_TEXTURE
+
+  std::unordered_map<LumpName, uint16_t> textureIds;
+  for (size_t i = 1; i < texture_names.size(); i++) {
+    textureIds[texture_names[i]] = static_cast<uint16_t>(i);
+  }
+
+  // Empty and "-" names are not in the map and resolve to NO_TEXTURE
+  auto textureId = [&textureIds](const char *name) {
+    std::unordered_map<LumpName, uint16_t>::const_iterator it =
+        textureIds.find(LumpName(name));
+    return it == textureIds.end() ? NO_TEXTURE : it->second;
+  };
+  sky_flat = textureId("F_SKY1");
+
+  // Vertices
+  vertex_x.resize(level.vertices.size());
+  vertex_y.resize(level.vertices.size());
+  for (size_t i = 0; i < level.vertices.size(); i++) {
+    vertex_x[i] = level.vertices[i].x;
+    vertex_y[i] = level.vertices[i].y;
+  }
+
+  // Linedefs
+  line_start.resize(level.linedefs.size());
+  line_end.resize(level.linedefs.size());
+  line_right.resize(level.linedefs.size());
+  line_left.resize(level.linedefs.size());
+  for (size_t i = 0; i < level.linedefs.size(); i++) {
+    const WAD::Linedef &l = level.linedefs[i];
+    line_start[i]         = l.start_vertex;
+    line_end[i]           = l.end_vertex;
+    line_right[i]         = l.right_sidedef;
+    line_left[i]          = l.left_sidedef;
+  }
+
+  // Sidedefs
+  side_x_offset.resize(level.sidedefs.size());
+  side_y_offset.resize(level.sidedefs.size());
+  side_sector.resize(level.sidedefs.size());
+  side_upper.resize(level.sidedefs.size());
+  side_lower.resize(level.sidedefs.size());
+  side_middle.resize(level.sidedefs.size());
+  for (size_t i = 0; i < level.sidedefs.size(); i++) {
+    const WAD::Sidedef &s = level.sidedefs[i];
+    side_x_offset[i]      = s.x_offset;
+    side_y_offset[i]      = s.y_offset;
+    side_sector[i]        = s.sector;
+    side_upper[i]         = textureId(s.upper_texture);
+    side_lower[i]         = textureId(s.lower_texture);
+    side_middle[i]        = textureId(s.middle_texture);
+  }
+
+  // Sectors
+  sector_floor.resize(level.sectors.size());
+  sector_ceiling.resize(level.sectors.size());
+  sector_floor_texture.resize(level.sectors.size());
+  sector_ceiling_texture.resize(level.sectors.size());
+  for (size_t i = 0; i < level.sectors.size(); i++) {
+    const WAD::Sector &s      = level.sectors[i];
+    sector_floor[i]           = s.floor_height;
+    sector_ceiling[i]         = s.ceiling_height;
+    sector_floor_texture[i]   = textureId(s.floor_texture);
+    sector_ceiling_texture[i] = textureId(s.ceiling_texture);
+  }
+}
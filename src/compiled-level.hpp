@@ -0,0 +1,65 @@
+#ifndef WAD_VIEWER_COMPILED_LEVEL_HPP
+#define WAD_VIEWER_COMPILED_LEVEL_HPP
+
+#include "./lump-name.hpp"
+#include "./wad.hpp"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Struct-of-arrays view of a level, built once from the raw lumps.
+ *
+ * The geometry passes of the converter only need indices, coordinates and
+ * heights, so every field lives in its own array and texture names are
+ * replaced by 16-bit ids into a shared name table. Id 0 (NO_TEXTURE) is used
+ * for empty and "-" names.
+ */
+struct CompiledLevel {
+  static constexpr uint16_t NO_TEXTURE = 0;
+  static constexpr uint16_t NO_SIDEDEF = 0xFFFF;
+
+  explicit CompiledLevel(const WAD::Level &level);
+
+  // Vertices
+  std::vector<int16_t> vertex_x;
+  std::vector<int16_t> vertex_y;
+
+  // Linedefs
+  std::vector<uint16_t> line_start;  // Start vertex index
+  std::vector<uint16_t> line_end;    // End vertex index
+  std::vector<uint16_t> line_right;  // Right sidedef index or NO_SIDEDEF
+  std::vector<uint16_t> line_left;   // Left sidedef index or NO_SIDEDEF
+
+  // Sidedefs
+  std::vector<int16_t>  side_x_offset;
+  std::vector<int16_t>  side_y_offset;
+  std::vector<uint16_t> side_sector;
+  std::vector<uint16_t> side_upper;   // Texture ids
+  std::vector<uint16_t> side_lower;   // Texture ids
+  std::vector<uint16_t> side_middle;  // Texture ids
+
+  // Sectors
+  std::vector<int16_t>  sector_floor;
+  std::vector<int16_t>  sector_ceiling;
+  std::vector<uint16_t> sector_floor_texture;    // Texture ids
+  std::vector<uint16_t> sector_ceiling_texture;  // Texture ids
+
+  // Texture id -> name, sorted by name after the NO_TEXTURE entry
+  std::vector<LumpName> texture_names;
+
+  // Id of the F_SKY1 flat, NO_TEXTURE if the level does not use it
+  uint16_t sky_flat = NO_TEXTURE;
+
+  // DOOM draws the sky instead of ceilings with the F_SKY1 flat
+  bool hasSkyCeiling(size_t sector) const {
+    return sky_flat != NO_TEXTURE && sector_ceiling_texture[sector] == sky_flat;
+  }
+
+  size_t vertexCount() const { return vertex_x.size(); }
+  size_t linedefCount() const { return line_start.size(); }
+  size_t sidedefCount() const { return side_sector.size(); }
+  size_t sectorCount() const { return sector_floor.size(); }
+  size_t textureCount() const { return texture_names.size(); }
+};
+
+#endif  // WAD_VIEWER_COMPILED_LEVEL_HPP
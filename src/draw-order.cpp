@@ -0,0 +1,116 @@
+#include "draw-order.hpp"
+
+/**
+ * @brief Find the sector of every subsector and index the groups by sector
+ * @param level The level the mesh was built from
+ * @param mesh The mesh, its groups are referred to by index
+ */
+DrawOrder::DrawOrder(const WAD::Level &level, const LevelMesh &mesh)
+    : tree_(level), frame_(0), sectorsDrawn_(0) {
+  const std::size_t sectorCount = level.sectors.size();
+
+  // Every seg of a subsector faces the same sector, the first one that
+  // resolves is enough
+  subsectorSector_.assign(tree_.subsectorCount(), LevelMesh::NO_SECTOR);
+  for (std::size_t s = 0; s < tree_.subsectorCount(); s++) {
+    const BSPTree::Seg *segs  = tree_.subsectorSegs(s);
+    std::size_t         count = tree_.subsectorSegCount(s);
+    for (std::size_t i = 0; i < count; i++) {
+      if (segs[i].linedef >= level.linedefs.size()) {
+        continue;
+      }
+      WAD::Linedef linedef = level.linedefs[segs[i].linedef];
+      uint16_t     sidedef =
+          segs[i].side ? linedef.left_sidedef : linedef.right_sidedef;
+      if (sidedef >= level.sidedefs.size()) {
+        continue;
+      }
+      uint16_t sector = level.sidedefs[sidedef].sector;
+      if (sector < sectorCount) {
+        subsectorSector_[s] = sector;
+        break;
+      }
+    }
+  }
+
+  // Counting sort of the groups by sector
+  first_.assign(sectorCount + 1, 0);
+  for (std::size_t g = 0; g < mesh.groups.size(); g++) {
+    uint16_t sector = mesh.groups[g].sector;
+    if (sector < sectorCount) {
+      first_[sector + 1]++;
+    } else {
+      unsectored_.push_back(static_cast<uint32_t>(g));
+    }
+  }
+  for (std::size_t s = 0; s < sectorCount; s++) {
+    first_[s + 1] += first_[s];
+  }
+
+  groups_.resize(first_[sectorCount]);
+  std::vector<uint32_t> fill(first_.begin(), first_.end() - 1);
+  for (std::size_t g = 0; g < mesh.groups.size(); g++) {
+    uint16_t sector = mesh.groups[g].sector;
+    if (sector < sectorCount) {
+      groups_[fill[sector]++] = static_cast<uint32_t>(g);
+    }
+  }
+
+  drawnAt_.assign(sectorCount, 0);
+  order_.reserve(mesh.groups.size());
+  subsectors_.reserve(tree_.subsectorCount());
+}
+
+/**
+ * @brief Order the groups for a view
+ * @param x Map X coordinate of the viewpoint
+ * @param y Map Y coordinate of the viewpoint
+ * @param angle View direction in radians, 0 is east, counterclockwise
+ * @param halfFov Half the horizontal field of view in radians
+ * @return Indices of the groups of the sectors in view, nearest first, then
+ * the groups without a sector
+ * @note A mesh built without sectorGroups has only unsectored groups, which
+ * are returned in mesh order.
+ */
+const std::vector<uint32_t> &DrawOrder::frontToBack(float x, float y,
+                                                    float angle,
+                                                    float halfFov) {
+  // A frame number per call saves clearing the drawn marks
+  frame_++;
+  if (frame_ == 0) {
+    drawnAt_.assign(drawnAt_.size(), 0);
+    frame_ = 1;
+  }
+
+  order_.clear();
+  sectorsDrawn_ = 0;
+
+  tree_.frontToBack(x, y, angle, halfFov, subsectors_);
+  for (std::size_t i = 0; i < subsectors_.size(); i++) {
+    uint16_t sector = subsectorSector_[subsectors_[i]];
+    if (sector >= drawnAt_.size() || drawnAt_[sector] == frame_) {
+      continue;
+    }
+
+    drawnAt_[sector] = frame_;
+    sectorsDrawn_++;
+    order_.insert(order_.end(), groups_.begin() + first_[sector],
+                  groups_.begin() + first_[sector + 1]);
+  }
+
+  order_.insert(order_.end(), unsectored_.begin(), unsectored_.end());
+  return order_;
+}
+
+/**
+ * @brief Find the sector containing a point
+ * @param x Map X coordinate
+ * @param y Map Y coordinate
+ * @return Sector index, LevelMesh::NO_SECTOR if the level has no BSP
+ */
+uint16_t DrawOrder::sectorAt(float x, float y) const {
+  if (tree_.empty()) {
+    return LevelMesh::NO_SECTOR;
+  }
+  return subsectorSector_[tree_.findSubsector(x, y)];
+}
@@ -0,0 +1,55 @@
+#ifndef WAD_VIEWER_DRAW_ORDER_HPP
+#define WAD_VIEWER_DRAW_ORDER_HPP
+
+#include "./bsp-tree.hpp"
+#include "./level-mesh.hpp"
+#include "./wad.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Per-frame front-to-back order of the groups of a level mesh built
+ * with ConversionOptions::sectorGroups.
+ *
+ * Walking the BSP from the viewpoint gives the subsectors nearest first, and
+ * each subsector belongs to one sector, so drawing the groups of each sector
+ * the first time one of its subsectors comes up lets the depth test reject
+ * most of the hidden pixels before they are shaded. Subtrees outside the
+ * view cone are skipped, along with the sectors only they reach. Groups
+ * without a sector (the sky backdrop) come last. The buffers are reused, so
+ * a frame does not allocate.
+ */
+class DrawOrder {
+public:
+  DrawOrder(const WAD::Level &level, const LevelMesh &mesh);
+
+  // Indices into mesh.groups, nearest sector first. angle and halfFov are
+  // as in BSPTree::frontToBack().
+  const std::vector<uint32_t> &frontToBack(float x, float y, float angle,
+                                           float halfFov);
+
+  // Sector containing a map position, LevelMesh::NO_SECTOR if unknown
+  uint16_t sectorAt(float x, float y) const;
+
+  std::size_t sectorsDrawn() const { return sectorsDrawn_; }
+
+private:
+  BSPTree tree_;
+
+  std::vector<uint16_t> subsectorSector_;  // NO_SECTOR if no seg tells
+
+  // Groups of sector s are groups_[first_[s]] up to first_[s + 1]
+  std::vector<uint32_t> first_;
+  std::vector<uint32_t> groups_;
+  std::vector<uint32_t> unsectored_;
+
+  // Buffers reused by every frontToBack()
+  std::vector<uint16_t> subsectors_;
+  std::vector<uint32_t> order_;
+  std::vector<uint32_t> drawnAt_;  // frontToBack() call that drew a sector
+  uint32_t              frame_;
+  std::size_t           sectorsDrawn_;
+};
+
+#endif  // WAD_VIEWER_DRAW_ORDER_HPP
@@ -0,0 +1,464 @@
+#include "headless-modes.hpp"
+#include "allocation-tracker.hpp"
+#include "automap.hpp"
+#include "draw-order.hpp"
+#include "log.hpp"
+#include "lump-name.hpp"
+#include "memory-footprint.hpp"
+#include "mesh-optimizer.hpp"
+#include "software-renderer.hpp"
+#include "thread-pool.hpp"
+#include "trace.hpp"
+#include "wad-converter.hpp"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+
+namespace {
+
+// Degrees of a ViewPose to the radians of the software renderer
+float radians(float degrees) {
+  return degrees * static_cast<float>(M_PI) / 180.0f;
+}
+
+}  // namespace
+
+/**
+ * @brief Get the view of the player start: at its position and angle, with
+ * the eye 41 units above the floor as in DOOM.
+ * @param level The level to look at.
+ * @param mesh The mesh built for the level, for the level center.
+ * @param drawOrder Draw order of the mesh, to find the sector of the start.
+ * @return The pose, at the level center looking east if there is no start.
+ */
+ViewPose playerStartPose(const WAD::Level &level, const LevelMesh &mesh,
+                         const DrawOrder &drawOrder) {
+  const float VIEW_HEIGHT = 41.0f;
+
+  ViewPose pose;
+  pose.x     = level.has_player_start ? level.player_start.x : mesh.centerX;
+  pose.y     = level.has_player_start ? level.player_start.y : mesh.centerY;
+  pose.angle = level.has_player_start ? level.player_start.angle : 0.0f;
+
+  uint16_t sector = drawOrder.sectorAt(pose.x, pose.y);
+  float    floor  = sector < level.sectors.size()
+                        ? level.sectors[sector].floor_height
+                        : 0.0f;
+  pose.z = floor + VIEW_HEIGHT;
+  return pose;
+}
+
+/**
+ * @brief Convert a pose to a software renderer camera.
+ * @param pose The pose in map units and degrees.
+ * @param mesh The mesh to render, for the level center and scale.
+ * @param fovX Horizontal field of view in radians.
+ * @return The camera in world coordinates.
+ */
+SoftwareRenderer::Camera cameraForPose(const ViewPose &pose,
+                                       const LevelMesh &mesh, float fovX) {
+  SoftwareRenderer::Camera camera;
+  camera.position[0] = (pose.x - mesh.centerX) * mesh.scale;
+  camera.position[1] = pose.z * mesh.scale;
+  camera.position[2] = -(pose.y - mesh.centerY) * mesh.scale;
+  camera.yaw         = radians(pose.angle);
+  camera.pitch       = radians(pose.pitch);
+  camera.fovX        = fovX;
+  return camera;
+}
+
+/**
+ * @brief Load the content file and the PWADs layered over it.
+ * @param wads The stack to load into.
+ * @param contentFile Path to the base WAD file.
+ * @param pwadFiles Paths to the PWADs, in load order.
+ * @throws std::runtime_error if a file cannot be loaded.
+ */
+void loadWADStack(WADStack &wads, const std::string &contentFile,
+                  const std::vector<std::string> &pwadFiles) {
+  // The content file is the base of the stack, PWADs are layered on top
+  wads.addWAD(contentFile);
+  for (size_t i = 0; i < pwadFiles.size(); i++) {
+    wads.addWAD(pwadFiles[i]);
+  }
+  wads.processStack();
+
+  // The load log is printed by the log thread, let it finish before the
+  // caller prints to std::cout
+  Log::flush();
+}
+
+/**
+ * @brief Compare the memory used by the float and the compact vertex formats
+ * for every level, and check what the compact format loses.
+ * @param wads The loaded WAD stack.
+ * @return Exit status, 0 if every position decodes exactly.
+ */
+int reportCompactMeshes(const WADStack &wads) {
+  size_t totalFloat   = 0;
+  size_t totalCompact = 0;
+  bool   exact        = true;
+
+  for (size_t i = 0; i < wads.getLevelCount(); i++) {
+    WAD::Level       level   = wads.getLevel(wads.getLevelNameByIndex(i));
+    LevelMesh        mesh    = WADConverter::buildLevelMesh(level);
+    CompactLevelMesh compact = WADConverter::buildCompactLevelMesh(level);
+    LevelMesh        decoded = compact.decode();
+
+    // Positions must come back exactly, UVs within half a quantization step
+    size_t vertexCount   = 0;
+    size_t positionDiffs = 0;
+    float  maxUVError    = 0.0f;
+
+    auto compare = [&](const LevelMesh::Vertex &a,
+                       const LevelMesh::Vertex &b) {
+      if (a.pos[0] != b.pos[0] || a.pos[1] != b.pos[1] ||
+          a.pos[2] != b.pos[2]) {
+        positionDiffs++;
+      }
+      maxUVError = std::max(maxUVError, std::fabs(a.uv[0] - b.uv[0]));
+      maxUVError = std::max(maxUVError, std::fabs(a.uv[1] - b.uv[1]));
+      vertexCount++;
+    };
+    for (size_t g = 0; g < mesh.groups.size(); g++) {
+      const std::vector<LevelMesh::Vertex> &a = mesh.groups[g].vertices;
+      const std::vector<LevelMesh::Vertex> &b = decoded.groups[g].vertices;
+      for (size_t v = 0; v < a.size(); v++) {
+        compare(a[v], b[v]);
+      }
+    }
+    for (size_t m = 0; m < mesh.masked.size(); m++) {
+      for (int v = 0; v < 4; v++) {
+        compare(mesh.masked[m].vertices[v], decoded.masked[m].vertices[v]);
+      }
+    }
+    exact = exact && positionDiffs == 0;
+
+    totalFloat += mesh.sizeInBytes();
+    totalCompact += compact.sizeInBytes();
+    std::cout << LumpName(level.name).str() << ": " << vertexCount
+              << " vertices, float " << mesh.sizeInBytes() << " bytes, compact "
+              << compact.sizeInBytes() << " bytes, max UV error " << maxUVError
+              << ", clamped UVs " << compact.clampedUVs
+              << ", position differences " << positionDiffs << "\n";
+  }
+
+  std::cout << "Total: float " << totalFloat << " bytes, compact "
+            << totalCompact << " bytes ("
+            << (totalFloat ? totalCompact * 100 / totalFloat : 0) << "%)\n";
+  return exact ? 0 : 1;
+}
+
+/**
+ * @brief Report what the mesh simplification and optimization do to every
+ * level: triangles left after merging walls and after skipping the sky, then
+ * vertex count and average cache miss ratio (ACMR) before and after the mesh
+ * optimizer.
+ * @param wads The loaded WAD stack.
+ * @return Exit status.
+ */
+int reportMeshOptimization(const WADStack &wads) {
+  ConversionOptions plainOptions;
+  plainOptions.mergeWalls = false;
+  plainOptions.skipSky    = false;
+
+  ConversionOptions mergedOptions;
+  mergedOptions.skipSky = false;
+
+  for (size_t i = 0; i < wads.getLevelCount(); i++) {
+    WAD::Level level = wads.getLevel(wads.getLevelNameByIndex(i));
+    LevelMesh  plain =
+        WADConverter::buildLevelMesh(level, nullptr, plainOptions);
+    LevelMesh merged =
+        WADConverter::buildLevelMesh(level, nullptr, mergedOptions);
+    LevelMesh mesh = WADConverter::buildLevelMesh(level);
+
+    MeshOptimizer::Stats plainStats  = MeshOptimizer::measure(plain);
+    MeshOptimizer::Stats mergedStats = MeshOptimizer::measure(merged);
+    MeshOptimizer::Stats before      = MeshOptimizer::measure(mesh);
+    MeshOptimizer::optimize(mesh);
+    MeshOptimizer::Stats after = MeshOptimizer::measure(mesh);
+
+    std::cout << LumpName(level.name).str() << ": triangles "
+              << plainStats.triangleCount << " -> "
+              << mergedStats.triangleCount << " merged walls -> "
+              << before.triangleCount << " sky backdrop; optimized, vertices "
+              << before.vertexCount << " -> " << after.vertexCount
+              << ", ACMR " << before.acmr() << " -> " << after.acmr()
+              << "\n";
+  }
+  return 0;
+}
+
+/**
+ * @brief Print the bytes held by each structure: the directories, index and
+ * merged resources of the stack, then per level the mapped geometry, the
+ * assets the level holds, its RGBA textures and its mesh buffers.
+ * @param wads The loaded WAD stack.
+ * @return Exit status.
+ * @note Sizes are the held bytes, unused capacity included. The last line
+ * gives how much of the level assets repeat the shared resources and the
+ * capacity right-sizing would save.
+ */
+int reportMemory(const WADStack &wads) {
+  WADStack::Footprint stack = wads.footprint();
+
+  MemoryFootprint stackTotal;
+  stackTotal += stack.directories;
+  stackTotal += stack.index;
+  stackTotal += stack.palette;
+  stackTotal += stack.patchNames;
+  stackTotal += stack.textureDefs;
+  stackTotal += stack.patches;
+
+  std::cout << "Stack: directories " << stack.directories.held
+            << " bytes, lump index " << stack.index.held
+            << " bytes (estimated), palette " << stack.palette.held
+            << " bytes, patch names " << stack.patchNames.held
+            << " bytes, texture defs " << stack.textureDefs.held
+            << " bytes, patches " << stack.patches.held << " bytes\n";
+
+  MemoryFootprint assetsTotal;
+  MemoryFootprint texturesTotal;
+  MemoryFootprint meshesTotal;
+  size_t          sharedCopies = 0;
+  size_t          mapped       = 0;
+
+  for (size_t i = 0; i < wads.getLevelCount(); i++) {
+    const LevelAssetFootprint &assets = stack.levels[i];
+
+    // The viewer optimizes the mesh before creating the items
+    WAD::Level level = wads.getLevel(wads.getLevelNameByIndex(i));
+    LevelMesh  mesh  = WADConverter::buildLevelMesh(level);
+    MeshOptimizer::optimize(mesh);
+
+    MemoryFootprint textures = MemoryFootprint::rgbaTextures(level, mesh);
+    MemoryFootprint buffers  = MemoryFootprint::of(mesh);
+
+    assetsTotal += assets.total();
+    texturesTotal += textures;
+    meshesTotal += buffers;
+    sharedCopies += assets.patches.held + assets.patchNames.held +
+                    assets.textureDefs.held + assets.palette.held;
+    mapped += MemoryFootprint::mappedGeometry(level);
+
+    std::cout << LumpName(level.name).str() << ": geometry "
+              << MemoryFootprint::mappedGeometry(level)
+              << " bytes mapped; assets " << assets.total().held
+              << " bytes (patches " << assets.patches.held
+              << ", texture defs " << assets.textureDefs.held
+              << ", patch names " << assets.patchNames.held << ", palette "
+              << assets.palette.held << ", flats " << assets.flats.held
+              << "); RGBA textures " << textures.held
+              << " bytes; mesh buffers " << buffers.held << " bytes\n";
+  }
+
+  size_t unused = stackTotal.held - stackTotal.used + assetsTotal.held -
+                  assetsTotal.used + meshesTotal.held - meshesTotal.used;
+  std::cout << "Total: stack " << stackTotal.held << " bytes, level assets "
+            << assetsTotal.held << " bytes (" << sharedCopies
+            << " copying the shared resources), RGBA textures "
+            << texturesTotal.held << " bytes, mesh buffers "
+            << meshesTotal.held << " bytes, geometry " << mapped
+            << " bytes mapped; unused capacity " << unused << " bytes\n";
+  return 0;
+}
+
+/**
+ * @brief Render the player start view of every level with the headless
+ * software renderer and print the overdraw with the groups drawn in texture
+ * order and in BSP front-to-back order, one line per level.
+ * @param wads The loaded WAD stack.
+ * @return Exit status.
+ */
+int reportOverdraw(const WADStack &wads) {
+  const int   WIDTH    = 320;
+  const int   HEIGHT   = 200;
+  const float HALF_FOV = static_cast<float>(M_PI) / 4.0f;
+
+  ConversionOptions options;
+  options.sectorGroups = true;
+
+  SoftwareRenderer renderer(WIDTH, HEIGHT);
+
+  for (size_t i = 0; i < wads.getLevelCount(); i++) {
+    WAD::Level level = wads.getLevel(wads.getLevelNameByIndex(i));
+    LevelMesh  mesh  = WADConverter::buildLevelMesh(level, nullptr, options);
+    DrawOrder  drawOrder(level, mesh);
+
+    ViewPose pose = playerStartPose(level, mesh, drawOrder);
+    renderer.setCamera(cameraForPose(pose, mesh, HALF_FOV * 2.0f));
+
+    renderer.clear();
+    for (size_t g = 0; g < mesh.groups.size(); g++) {
+      renderer.drawDepth(mesh.groups[g]);
+    }
+    SoftwareRenderer::DepthStats textureOrder = renderer.stats();
+
+    const std::vector<uint32_t> &order = drawOrder.frontToBack(
+        pose.x, pose.y, radians(pose.angle), HALF_FOV);
+    renderer.clear();
+    for (size_t g = 0; g < order.size(); g++) {
+      renderer.drawDepth(mesh.groups[order[g]]);
+    }
+    SoftwareRenderer::DepthStats bspOrder = renderer.stats();
+
+    std::cout << LumpName(level.name).str() << ": overdraw "
+              << textureOrder.overdraw() << " texture order -> "
+              << bspOrder.overdraw() << " front to back; groups "
+              << mesh.groups.size() << " -> " << order.size() << " ("
+              << drawOrder.sectorsDrawn() << " of " << level.sectors.size()
+              << " sectors), covered pixels " << textureOrder.coveredPixels
+              << " -> " << bspOrder.coveredPixels << "\n";
+  }
+  return 0;
+}
+
+/**
+ * @brief Render a level with the software renderer and save it as a PNG
+ * file, without the engine.
+ * @param wads The loaded WAD stack.
+ * @param levelName Level to render, empty for the first one.
+ * @param file Path of the PNG file to write.
+ * @param pose Viewpoint, nullptr for the player start.
+ * @param width Image width in pixels.
+ * @param height Image height in pixels.
+ * @return Exit status.
+ * @throws std::runtime_error if the level or the file cannot be used.
+ */
+int takeScreenshot(const WADStack &wads, std::string levelName,
+                   const std::string &file, const ViewPose *pose, int width,
+                   int height) {
+  const float FOV_X = static_cast<float>(M_PI) / 2.0f;
+
+  if (levelName.empty()) {
+    levelName = wads.getLevelNameByIndex(0);
+  }
+
+  ConversionOptions options;
+  options.sectorGroups = true;
+
+  WAD::Level level = wads.getLevel(levelName);
+  LevelMesh  mesh  = WADConverter::buildLevelMesh(level, nullptr, options);
+  DrawOrder  drawOrder(level, mesh);
+  ViewPose   view  = pose ? *pose : playerStartPose(level, mesh, drawOrder);
+
+  SoftwareRenderer renderer(width, height);
+  renderer.loadTextures(level, mesh);
+  SoftwareRenderer::Camera camera = cameraForPose(view, mesh, FOV_X);
+  renderer.setCamera(camera);
+
+  // Nearest sectors first, so hidden pixels fail the depth test before they
+  // are textured. The cone is widened for a pitched camera
+  ThreadPool                   pool;
+  auto                         start = std::chrono::steady_clock::now();
+  const std::vector<uint32_t> &order = drawOrder.frontToBack(
+      view.x, view.y, radians(view.angle),
+      SoftwareRenderer::mapHalfFov(camera, width, height));
+  renderer.render(mesh, &order, &pool);
+  auto end = std::chrono::steady_clock::now();
+
+  renderer.writePNG(file);
+  std::cout << levelName << ": " << width << "x" << height << " rendered in "
+            << std::chrono::duration<double, std::milli>(end - start).count()
+            << " ms (" << pool.size() << " threads), saved to " << file
+            << "\n";
+  return 0;
+}
+
+/**
+ * @brief Write the zones recorded since the start of the program.
+ * @param traceFile Path of the Chrome trace JSON file, empty for none.
+ * @throws std::runtime_error if the file cannot be written.
+ */
+void writeTrace(const std::string &traceFile) {
+  if (!traceFile.empty()) {
+    Trace::write(traceFile);
+    std::cout << "Trace written to " << traceFile << "\n";
+  }
+}
+
+/**
+ * @brief Save an automap PNG of every level of every WAD and print the
+ * throughput. Each WAD is read on its own, so no content file is needed.
+ * @param dir Directory of the PNG files.
+ * @param files Paths of the WADs.
+ * @param traceFile Path of the Chrome trace JSON file, empty for none.
+ * @return Exit status.
+ */
+int renderAutomaps(const std::string              &dir,
+                   const std::vector<std::string> &files,
+                   const std::string              &traceFile) {
+  if (files.empty()) {
+    std::cerr << "Usage: wadviewer --automap <output_dir> <wad>...\n";
+    return 1;
+  }
+  try {
+    ThreadPool                      pool;
+    AutomapRenderer                 automap;
+    AutomapRenderer::CatalogueStats stats =
+        automap.renderCatalogue(files, dir, pool);
+    std::cout << "Rendered " << stats.levels << " automaps (" << stats.lines
+              << " lines) in " << stats.milliseconds << " ms, "
+              << stats.levelsPerSecond() << " levels/s on " << pool.size()
+              << " threads\n";
+    writeTrace(traceFile);
+    return 0;
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+}
+
+/**
+ * @brief Check whether a mode that does not need the engine was asked.
+ * @return true if runHeadlessMode() should run instead of the viewer.
+ */
+bool HeadlessOptions::any() const {
+  return compactReport || optimizeReport || overdrawReport || memoryReport ||
+         !screenshotFile.empty();
+}
+
+/**
+ * @brief Load the WAD stack and run the headless mode asked, then write the
+ * trace and the allocation report if asked.
+ * @param options The command line options.
+ * @return Exit status of the mode, 1 if the WADs cannot be loaded.
+ */
+int runHeadlessMode(const HeadlessOptions &options) {
+  try {
+    WADStack wads;
+    {
+      AllocationTracker::Phase phase("main::loadWADStack");
+      loadWADStack(wads, options.contentFile, options.pwadFiles);
+    }
+
+    int status;
+    {
+      AllocationTracker::Phase phase("main::headless");
+      if (options.compactReport) {
+        status = reportCompactMeshes(wads);
+      } else if (options.overdrawReport) {
+        status = reportOverdraw(wads);
+      } else if (options.memoryReport) {
+        status = reportMemory(wads);
+      } else if (!options.screenshotFile.empty()) {
+        status = takeScreenshot(
+            wads, options.levelName, options.screenshotFile,
+            options.hasPose ? &options.screenshotPose : nullptr,
+            options.screenshotWidth, options.screenshotHeight);
+      } else {
+        status = reportMeshOptimization(wads);
+      }
+    }
+    writeTrace(options.traceFile);
+    if (options.allocReport) {
+      AllocationTracker::report(std::cout);
+    }
+    return status;
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+}
@@ -0,0 +1,72 @@
+#ifndef WAD_VIEWER_HEADLESS_MODES_HPP
+#define WAD_VIEWER_HEADLESS_MODES_HPP
+
+#include "./draw-order.hpp"
+#include "./level-mesh.hpp"
+#include "./software-renderer.hpp"
+#include "./wad-stack.hpp"
+#include "./wad.hpp"
+#include <string>
+#include <vector>
+
+// A viewpoint in DOOM map units and degrees, for the software renderer
+struct ViewPose {
+  float x     = 0.0f;
+  float y     = 0.0f;
+  float z     = 0.0f;  // Eye height
+  float angle = 0.0f;  // 0 east, counterclockwise
+  float pitch = 0.0f;  // Positive looks up
+};
+
+/**
+ * @brief The command line options, the WAD, trace and allocation report ones
+ * are also used by the viewer.
+ */
+struct HeadlessOptions {
+  std::string              contentFile;
+  std::string              levelName;  // Empty means use first level
+  std::vector<std::string> pwadFiles;  // PWADs layered over contentFile
+  bool                     compactReport  = false;
+  bool                     optimizeReport = false;
+  bool                     memoryReport   = false;
+  bool                     overdrawReport = false;
+  std::string              screenshotFile;  // Empty means no screenshot
+  ViewPose                 screenshotPose;
+  bool                     hasPose          = false;
+  int                      screenshotWidth  = 640;
+  int                      screenshotHeight = 400;
+  std::string              automapDir;  // Empty means no automap images
+  std::vector<std::string> automapFiles;
+  std::string              traceFile;  // Empty means no trace
+  bool                     allocReport = false;
+
+  bool any() const;
+};
+
+// View of the player start, with the eye 41 units above the floor
+ViewPose playerStartPose(const WAD::Level &level, const LevelMesh &mesh,
+                         const DrawOrder &drawOrder);
+
+// Software renderer camera of a pose, in the world coordinates of a mesh
+SoftwareRenderer::Camera cameraForPose(const ViewPose &pose,
+                                       const LevelMesh &mesh, float fovX);
+
+void loadWADStack(WADStack &wads, const std::string &contentFile,
+                  const std::vector<std::string> &pwadFiles);
+void writeTrace(const std::string &traceFile);
+
+// Modes that only need the WAD data and not the engine
+int reportCompactMeshes(const WADStack &wads);
+int reportMeshOptimization(const WADStack &wads);
+int reportMemory(const WADStack &wads);
+int reportOverdraw(const WADStack &wads);
+int takeScreenshot(const WADStack &wads, std::string levelName,
+                   const std::string &file, const ViewPose *pose, int width,
+                   int height);
+int renderAutomaps(const std::string              &dir,
+                   const std::vector<std::string> &files,
+                   const std::string              &traceFile);
+
+int runHeadlessMode(const HeadlessOptions &options);
+
+#endif  // WAD_VIEWER_HEADLESS_MODES_HPP
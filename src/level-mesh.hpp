@@ -0,0 +1,120 @@
+#ifndef WAD_VIEWER_LEVEL_MESH_HPP
+#define WAD_VIEWER_LEVEL_MESH_HPP
+
+#include "./lump-name.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief CPU-side geometry of a level, before any engine item is created.
+ *
+ * Built by WADConverter::buildLevelMesh() without touching the engine, so
+ * several levels can be built at the same time on worker threads.
+ */
+struct LevelMesh {
+  // Sector of the groups that are not split by sector
+  static constexpr uint16_t NO_SECTOR = 0xFFFF;
+
+  // Interleaved x, y, z, u, v, the layout OkItem takes as a float array
+  struct Vertex {
+    static const std::size_t FLOAT_COUNT = 5;
+
+    float pos[3];
+    float uv[2];
+
+    bool operator==(const Vertex &other) const {
+      return pos[0] == other.pos[0] && pos[1] == other.pos[1] &&
+             pos[2] == other.pos[2] && uv[0] == other.uv[0] &&
+             uv[1] == other.uv[1];
+    }
+  };
+
+  // Geometry sharing one texture, and one sector when groups are split by
+  // sector for draw ordering
+  struct Group {
+    LumpName                  texture;
+    uint16_t                  sector = NO_SECTOR;
+    std::vector<Vertex>       vertices;
+    std::vector<unsigned int> indices;
+
+    bool operator==(const Group &other) const {
+      return texture == other.texture && sector == other.sector &&
+             vertices == other.vertices && indices == other.indices;
+    }
+  };
+
+  // Middle texture of a two-sided linedef (grates, fences), drawn with
+  // blending after the opaque groups, in back-to-front order
+  struct MaskedSurface {
+    // Triangles of the quad, counterclockwise seen from its side
+    static constexpr unsigned int INDICES[6] = {0, 2, 1, 1, 2, 3};
+
+    LumpName texture;
+    uint16_t linedef;
+    uint16_t side;         // 0 for the right sidedef, 1 for the left one
+    Vertex   vertices[4];  // Bottom left, top left, bottom right, top right
+
+    bool operator==(const MaskedSurface &other) const {
+      return texture == other.texture && linedef == other.linedef &&
+             side == other.side && vertices[0] == other.vertices[0] &&
+             vertices[1] == other.vertices[1] &&
+             vertices[2] == other.vertices[2] &&
+             vertices[3] == other.vertices[3];
+    }
+  };
+
+  // Level center in DOOM units, subtracted from every vertex
+  float centerX = 0.0f;
+  float centerY = 0.0f;
+
+  // World units per DOOM unit
+  float scale = 1.0f;
+
+  // Non-empty groups, in texture name order, then sector order
+  std::vector<Group> groups;
+
+  // Masked surfaces, in linedef order
+  std::vector<MaskedSurface> masked;
+
+  bool operator==(const LevelMesh &other) const {
+    return centerX == other.centerX && centerY == other.centerY &&
+           scale == other.scale && groups == other.groups &&
+           masked == other.masked;
+  }
+  bool operator!=(const LevelMesh &other) const { return !(*this == other); }
+
+  // Names of the textures of the groups and the masked surfaces, sorted and
+  // without duplicates, to look up with std::binary_search
+  std::vector<LumpName> usedTextures() const {
+    std::vector<LumpName> used;
+    used.reserve(groups.size() + masked.size());
+    for (std::size_t g = 0; g < groups.size(); g++) {
+      used.push_back(groups[g].texture);
+    }
+    for (std::size_t m = 0; m < masked.size(); m++) {
+      used.push_back(masked[m].texture);
+    }
+    std::sort(used.begin(), used.end());
+    used.erase(std::unique(used.begin(), used.end()), used.end());
+    return used;
+  }
+
+  // Bytes used by the vertex and index buffers
+  std::size_t sizeInBytes() const {
+    std::size_t bytes = 0;
+    for (std::size_t g = 0; g < groups.size(); g++) {
+      bytes += groups[g].vertices.size() * sizeof(Vertex);
+      bytes += groups[g].indices.size() * sizeof(unsigned int);
+    }
+    bytes += masked.size() * sizeof(MaskedSurface::vertices);
+    return bytes;
+  }
+};
+
+static_assert(sizeof(LevelMesh::Vertex) ==
+                  LevelMesh::Vertex::FLOAT_COUNT * sizeof(float),
+              "LevelMesh::Vertex must be tightly packed floats");
+
+#endif  // WAD_VIEWER_LEVEL_MESH_HPP
@@ -0,0 +1,61 @@
+#ifndef WAD_VIEWER_LITTLE_ENDIAN_HPP
+#define WAD_VIEWER_LITTLE_ENDIAN_HPP
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Loads and stores of little-endian integers at unaligned byte
+ * pointers.
+ *
+ * WAD data is little-endian and lump records have no alignment guarantees.
+ * memcpy into a local is the portable way to read them, and on little-endian
+ * targets it compiles to a single plain load.
+ */
+namespace LittleEndian {
+  inline uint16_t loadU16(const uint8_t *p) {
+    uint16_t value;
+    std::memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap16(value);
+#endif
+    return value;
+  }
+
+  inline uint32_t loadU32(const uint8_t *p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+  }
+
+  inline int16_t loadS16(const uint8_t *p) {
+    return static_cast<int16_t>(loadU16(p));
+  }
+
+  inline int32_t loadS32(const uint8_t *p) {
+    return static_cast<int32_t>(loadU32(p));
+  }
+
+  inline void storeU16(uint8_t *p, uint16_t value) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap16(value);
+#endif
+    std::memcpy(p, &value, sizeof(value));
+  }
+
+  inline void storeU32(uint8_t *p, uint32_t value) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    std::memcpy(p, &value, sizeof(value));
+  }
+
+  inline void storeS16(uint8_t *p, int16_t value) {
+    storeU16(p, static_cast<uint16_t>(value));
+  }
+}  // namespace LittleEndian
+
+#endif  // WAD_VIEWER_LITTLE_ENDIAN_HPP
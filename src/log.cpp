@@ -0,0 +1,141 @@
+#include "log.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::atomic<int>  minimumLevel(WAD_VIEWER_LOG_LEVEL);
+std::atomic<bool> writerStarted(false);
+
+// Prints the lines on its own thread. Started by the first line, and at exit
+// stopped once what is left is printed
+class Writer {
+public:
+  Writer() : thread_(&Writer::run, this) {}
+
+  ~Writer() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+
+  void push(const std::string &line) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_ += line;
+      pending_ += '\n';
+      queued_++;
+    }
+    wake_.notify_one();
+  }
+
+  void flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t                     target = queued_;
+    printedLines_.wait(lock, [&] { return printed_ >= target; });
+  }
+
+private:
+  void run() {
+    std::string                  printing;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      wake_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+      if (pending_.empty()) {
+        return;
+      }
+
+      // Print without the lock, so loggers only wait for the swap
+      printing.swap(pending_);
+      uint64_t lines = queued_;
+      lock.unlock();
+      std::cout.write(printing.data(), printing.size());
+      std::cout.flush();
+      printing.clear();
+      lock.lock();
+
+      printed_ = lines;
+      printedLines_.notify_all();
+    }
+  }
+
+  std::mutex              mutex_;
+  std::condition_variable wake_;
+  std::condition_variable printedLines_;
+  std::string             pending_;
+  uint64_t                queued_   = 0;
+  uint64_t                printed_  = 0;
+  bool                    stopping_ = false;
+  std::thread             thread_;
+};
+
+Writer &writer() {
+  static Writer instance;
+  writerStarted.store(true, std::memory_order_release);
+  return instance;
+}
+
+}  // namespace
+
+/**
+ * @brief Check whether lines of a level are printed
+ * @param level Level of the line
+ * @return true if the level is at least the one set with setLevel()
+ */
+bool Log::enabled(Level level) {
+  return static_cast<int>(level) >=
+         minimumLevel.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Set the lowest level printed
+ * @param level Lowest level, Off prints nothing
+ * @note Levels below WAD_VIEWER_LOG_LEVEL are compiled out and stay silent.
+ */
+void Log::setLevel(Level level) {
+  minimumLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Get the lowest level printed
+ * @return The level set with setLevel(), the lowest compiled in by default
+ */
+Log::Level Log::level() {
+  return static_cast<Level>(minimumLevel.load(std::memory_order_relaxed));
+}
+
+/**
+ * @brief Wait until the writer has printed every line logged so far
+ */
+void Log::flush() {
+  if (writerStarted.load(std::memory_order_acquire)) {
+    writer().flush();
+  }
+}
+
+/**
+ * @brief Hand the formatted line to the writer, and wait for errors to be
+ * printed so they are not lost if the program stops
+ */
+Log::Line::~Line() {
+  std::string line;
+  if (level_ == Level::Warning) {
+    line = "Warning: ";
+  } else if (level_ == Level::Error) {
+    line = "Error: ";
+  }
+  line += stream_.str();
+
+  writer().push(line);
+  if (level_ >= Level::Error) {
+    writer().flush();
+  }
+}
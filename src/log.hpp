@@ -0,0 +1,87 @@
+#ifndef WAD_VIEWER_LOG_HPP
+#define WAD_VIEWER_LOG_HPP
+
+#include <sstream>
+
+// Lowest level compiled in: 0 debug, 1 info, 2 warning, 3 error, 4 none
+// (make LOG_LEVEL=...)
+#ifndef WAD_VIEWER_LOG_LEVEL
+#define WAD_VIEWER_LOG_LEVEL 1
+#endif
+
+/**
+ * @brief Leveled log lines of the reader and the converter, printed to
+ * std::cout by a background thread.
+ *
+ * Lines are placed with LOG_DEBUG(...) to LOG_ERROR(...), whose argument is
+ * a stream expression: LOG_INFO("Loaded " << count << " patches"). Levels
+ * below WAD_VIEWER_LOG_LEVEL expand to nothing, so their arguments are not
+ * even compiled; levels below setLevel() are checked before the line is
+ * formatted. A formatted line is appended to a buffer under a lock and the
+ * writer thread prints it, so the caller does no I/O, except for errors
+ * which wait until they are printed. Call flush() before printing to
+ * std::cout directly, to keep the output in order.
+ */
+class Log {
+public:
+  enum class Level { Debug = 0, Info = 1, Warning = 2, Error = 3, Off = 4 };
+
+  // Whether lines of a level are printed, by default every level compiled in
+  static bool enabled(Level level);
+
+  static void  setLevel(Level level);
+  static Level level();
+
+  // Wait until every line logged so far is printed
+  static void flush();
+
+  // Formats one line, handed to the writer on destruction
+  class Line {
+  public:
+    explicit Line(Level level) : level_(level) {}
+    ~Line();
+
+    Line(const Line &)            = delete;
+    Line &operator=(const Line &) = delete;
+
+    std::ostream &stream() { return stream_; }
+
+  private:
+    Level              level_;
+    std::ostringstream stream_;
+  };
+};
+
+#define LOG_LINE(level, message)                                               \
+  do {                                                                         \
+    if (Log::enabled(level)) {                                                 \
+      Log::Line logLine(level);                                                \
+      logLine.stream() << message;                                             \
+    }                                                                          \
+  } while (0)
+
+#if WAD_VIEWER_LOG_LEVEL <= 0
+#define LOG_DEBUG(message) LOG_LINE(Log::Level::Debug, message)
+#else
+#define LOG_DEBUG(message) ((void)0)
+#endif
+
+#if WAD_VIEWER_LOG_LEVEL <= 1
+#define LOG_INFO(message) LOG_LINE(Log::Level::Info, message)
+#else
+#define LOG_INFO(message) ((void)0)
+#endif
+
+#if WAD_VIEWER_LOG_LEVEL <= 2
+#define LOG_WARNING(message) LOG_LINE(Log::Level::Warning, message)
+#else
+#define LOG_WARNING(message) ((void)0)
+#endif
+
+#if WAD_VIEWER_LOG_LEVEL <= 3
+#define LOG_ERROR(message) LOG_LINE(Log::Level::Error, message)
+#else
+#define LOG_ERROR(message) ((void)0)
+#endif
+
+#endif  // WAD_VIEWER_LOG_HPP
@@ -0,0 +1,118 @@
+#ifndef WAD_VIEWER_LUMP_NAME_HPP
+#define WAD_VIEWER_LUMP_NAME_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * @brief 8-character WAD name (lump, texture, flat or patch) packed into a
+ * 64-bit key.
+ *
+ * Names are read up to the first NUL (or 8 characters), converted to
+ * uppercase, and stored with the first character in the most significant
+ * byte. Unused bytes are zero, so comparing keys gives the same order as
+ * comparing the names as strings.
+ */
+class LumpName {
+public:
+  constexpr LumpName() : key_(0) {}
+
+  // Implicit on purpose: lets fixed char[8] fields, literals and strings be
+  // compared against a LumpName without creating temporary strings
+  constexpr LumpName(const char *name, std::size_t maxLength = 8)
+      : key_(pack(name, maxLength)) {}
+  LumpName(const std::string &name) : key_(pack(name.c_str(), name.size())) {}
+
+  constexpr uint64_t key() const { return key_; }
+
+  // Number of characters in the name (0 to 8)
+  constexpr std::size_t length() const {
+    std::size_t len = 0;
+    while (len < 8 && (*this)[len] != '\0') {
+      len++;
+    }
+    return len;
+  }
+
+  constexpr char operator[](std::size_t i) const {
+    return static_cast<char>((key_ >> (56 - i * 8)) & 0xFF);
+  }
+
+  constexpr bool empty() const { return key_ == 0; }
+
+  // DOOM uses "-" (or an empty name) for "no texture" in sidedefs
+  constexpr bool isNoTexture() const {
+    return key_ == 0 || key_ == (static_cast<uint64_t>('-') << 56);
+  }
+
+  constexpr bool operator==(const LumpName &other) const {
+    return key_ == other.key_;
+  }
+  constexpr bool operator!=(const LumpName &other) const {
+    return key_ != other.key_;
+  }
+  constexpr bool operator<(const LumpName &other) const {
+    return key_ < other.key_;
+  }
+
+  // Write the name into a fixed 8-byte field, zero padded
+  void copyTo(char *dest) const {
+    for (std::size_t i = 0; i < 8; i++) {
+      dest[i] = (*this)[i];
+    }
+  }
+
+  std::string str() const {
+    char buffer[8];
+    copyTo(buffer);
+    return std::string(buffer, length());
+  }
+
+  struct Hash {
+    constexpr std::size_t operator()(const LumpName &name) const {
+      // Fibonacci hashing mixes the characters into the high bits, then fold
+      // them back down so every byte of the name affects the bucket
+      uint64_t h = name.key_ * 0x9E3779B97F4A7C15ull;
+      return static_cast<std::size_t>(h ^ (h >> 32));
+    }
+  };
+
+private:
+  uint64_t key_;
+
+  static constexpr char toUpper(char c) {
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+  }
+
+  static constexpr uint64_t pack(const char *name, std::size_t maxLength) {
+    uint64_t    key    = 0;
+    std::size_t length = 0;
+
+    // Read up to the first NUL, ignoring trailing spaces
+    for (std::size_t i = 0; i < 8 && i < maxLength && name[i] != '\0'; i++) {
+      if (name[i] != ' ') {
+        length = i + 1;
+      }
+    }
+
+    for (std::size_t i = 0; i < length; i++) {
+      key |= static_cast<uint64_t>(static_cast<uint8_t>(toUpper(name[i])))
+             << (56 - i * 8);
+    }
+
+    return key;
+  }
+};
+
+namespace std {
+  template <>
+  struct hash<LumpName> {
+    std::size_t operator()(const LumpName &name) const {
+      return LumpName::Hash()(name);
+    }
+  };
+}  // namespace std
+
+#endif  // WAD_VIEWER_LUMP_NAME_HPP
@@ -0,0 +1,16 @@
+#include "lump-reader.hpp"
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief Report an out of bounds read
+ * @param offset Offset of the read
+ * @param count Number of bytes of the read
+ * @throws std::runtime_error always
+ */
+void LumpReader::fail(uint64_t offset, uint64_t count) const {
+  throw std::runtime_error("Corrupt lump " + name_.str() + ": reading " +
+                           std::to_string(count) + " bytes at offset " +
+                           std::to_string(offset) + " of " +
+                           std::to_string(size_));
+}
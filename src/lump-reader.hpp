@@ -0,0 +1,71 @@
+#ifndef WAD_VIEWER_LUMP_READER_HPP
+#define WAD_VIEWER_LUMP_READER_HPP
+
+#include "./little-endian.hpp"
+#include "./lump-name.hpp"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Bounds-checked little-endian reader over the bytes of a lump.
+ *
+ * Every offset read from the lump itself (column offsets, texture offsets,
+ * counts) goes through this reader, so a corrupt or malicious WAD makes the
+ * decoder throw std::runtime_error instead of reading outside the lump. The
+ * check is one compare and branch per access, the load itself is the same
+ * plain load as reading a native struct.
+ */
+class LumpReader {
+public:
+  LumpReader(const uint8_t *data, std::size_t size, LumpName name)
+      : data_(data), size_(size), name_(name) {}
+
+  std::size_t size() const { return size_; }
+
+  // true if [offset, offset + count) is inside the lump
+  bool contains(uint64_t offset, uint64_t count) const {
+    return offset <= size_ && count <= size_ - offset;
+  }
+
+  uint8_t u8(uint64_t offset) const {
+    check(offset, 1);
+    return data_[offset];
+  }
+
+  uint16_t u16(uint64_t offset) const {
+    check(offset, 2);
+    return LittleEndian::loadU16(data_ + offset);
+  }
+
+  int16_t s16(uint64_t offset) const {
+    check(offset, 2);
+    return LittleEndian::loadS16(data_ + offset);
+  }
+
+  uint32_t u32(uint64_t offset) const {
+    check(offset, 4);
+    return LittleEndian::loadU32(data_ + offset);
+  }
+
+  // Pointer to count bytes starting at offset
+  const uint8_t *bytes(uint64_t offset, uint64_t count) const {
+    check(offset, count);
+    return data_ + offset;
+  }
+
+private:
+  const uint8_t *data_;
+  std::size_t    size_;
+  LumpName       name_;
+
+  void check(uint64_t offset, uint64_t count) const {
+    if (!contains(offset, count)) {
+      fail(offset, count);
+    }
+  }
+
+  // Kept out of line so the checks stay small in the decoding loops
+  [[noreturn]] void fail(uint64_t offset, uint64_t count) const;
+};
+
+#endif  // WAD_VIEWER_LUMP_READER_HPP
@@ -0,0 +1,51 @@
+#ifndef WAD_VIEWER_LUMP_VIEW_HPP
+#define WAD_VIEWER_LUMP_VIEW_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+/**
+ * @brief Read-only typed view over the records of a lump.
+ *
+ * The view does not own or copy the lump bytes, it points directly into the
+ * WAD file data, which must outlive it. Records are decoded on access through
+ * T::decode(), which reads the little-endian on-disk layout from a possibly
+ * unaligned pointer, so element access returns values instead of references.
+ * T::RECORD_SIZE is the size of one record on disk.
+ */
+template <typename T>
+class LumpView {
+public:
+  LumpView() : data_(nullptr), count_(0) {}
+
+  // Trailing bytes that do not form a whole record are ignored
+  LumpView(const uint8_t *data, std::size_t sizeInBytes)
+      : data_(data), count_(sizeInBytes / T::RECORD_SIZE) {}
+
+  std::size_t size() const { return count_; }
+  bool        empty() const { return count_ == 0; }
+
+  T operator[](std::size_t index) const {
+    assert(index < count_);
+    return T::decode(data_ + index * T::RECORD_SIZE);
+  }
+
+  T at(std::size_t index) const {
+    if (index >= count_) {
+      throw std::out_of_range("Lump record index out of range");
+    }
+    return T::decode(data_ + index * T::RECORD_SIZE);
+  }
+
+  // Raw bytes of the view, as stored in the WAD file
+  const uint8_t *data() const { return data_; }
+  std::size_t    sizeInBytes() const { return count_ * T::RECORD_SIZE; }
+
+private:
+  const uint8_t *data_;
+  std::size_t    count_;
+};
+
+#endif  // WAD_VIEWER_LUMP_VIEW_HPP
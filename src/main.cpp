@@ -7,10 +7,20 @@
 #include "../okinawa.cpp/src/scene/scene.hpp"
 #include "../okinawa.cpp/src/utils/logger.hpp"
 #include <cmath>
+#include <cstdio>
 #include <iostream>
-#include <map>
-
+#include <vector>
+
+#include "./allocation-tracker.hpp"
+#include "./headless-modes.hpp"
+#include "./log.hpp"
+#include "./masked-sorter.hpp"
+#include "./mesh-optimizer.hpp"
+#include "./thread-pool.hpp"
+#include "./trace.hpp"
+#include "./viewer-controls.hpp"
 #include "./wad-converter.hpp"
+#include "./wad-stack.hpp"
 #include "./wad.hpp"
 
 // enum with the possible formats for the file to view
@@ -22,58 +32,19 @@ enum class Format {
   DSL_VERBOSE
 };
 
+// Moves the camera on each step of the engine loop
+ViewerControls controls;
+
 /**
  * @brief callback function for the step phase of the engine loop.
  * @param deltaTime Time since the last frame in milliseconds.
  */
 void stepCallback(float deltaTime) {
-  OkInput     *input  = OkCore::getInput();
-  OkInputState state  = input->getState();
-  OkCamera    *camera = OkCore::getCamera();
-
-  OkPoint forward = camera->getRotation().getForwardVector();
-  OkPoint right   = camera->getRotation().getRightVector();
-  OkPoint direction(0.0f, 0.0f, 0.0f);
-
-  // Calculate movement direction based on input
-  if (state.forward) {
-    direction = direction + forward;
-  }
-  if (state.backward) {
-    direction = direction - forward;
-  }
-  if (state.strafeLeft) {
-    direction = direction - right;
-  }
-  if (state.strafeRight) {
-    direction = direction + right;
-  }
-
-  // Base movement speed (units per second)
-  const float baseSpeed = 50.0f;
-
-  // Apply movement speed if there's input
-  if (direction.x() != 0 || direction.y() != 0 || direction.z() != 0) {
-    float magnitude =
-        sqrt(direction.x() * direction.x() + direction.y() * direction.y() +
-             direction.z() * direction.z());
+  // One step per frame, for the frame counts of --alloc-report
+  AllocationTracker::markFrame();
 
-    if (magnitude > 0.0001f) {  // Small epsilon to avoid floating point errors
-      direction = direction.normalize() * baseSpeed;
-    } else {
-      direction = OkPoint(0.0f, 0.0f, 0.0f);
-    }
-  }
-
-  // Set the camera's speed - this will be applied in OkObject::step
-  camera->setSpeed(direction.x(), direction.y(), direction.z());
-
-  // Log only once per second for debugging
-  static int frameCount = 0;
-  if (frameCount++ % 60 == 0) {  // Assuming 60 FPS, adjust if different
-    OkPoint position = camera->getPosition();
-    OkLogger::info("Camera pos: " + position.toString());
-  }
+  OkInput *input = OkCore::getInput();
+  controls.step(*OkCore::getCamera(), input->getState());
 }
 
 /**
@@ -188,6 +159,126 @@ void positionCameraForLevel(OkCamera                    *camera,
  * @return Exit status.
  */
 int main(int argc, char *argv[]) {
+  // ******************************************************************************************
+  // ******************************************************************************************
+  // ******************************************************************************************
+  // ******************************************************************************************
+  // ******************************************************************************************
+  // ******************************************************************************************
+
+  Format          format = Format::WAD;  // Default format
+  HeadlessOptions options;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+
+    if (arg == "-file") {
+      if (i + 1 >= argc) {
+        std::cerr << "Missing PWAD path after -file\n";
+        options.contentFile.clear();  // Show usage
+        break;
+      }
+      options.pwadFiles.push_back(argv[++i]);
+    } else if (arg == "--compact-report") {
+      options.compactReport = true;
+    } else if (arg == "--optimize-report") {
+      options.optimizeReport = true;
+    } else if (arg == "--mem-report") {
+      options.memoryReport = true;
+    } else if (arg == "--overdraw-report") {
+      options.overdrawReport = true;
+    } else if (arg == "--screenshot" && i + 1 < argc) {
+      options.screenshotFile = argv[++i];
+    } else if (arg == "--camera" && i + 1 < argc) {
+      ViewPose &p = options.screenshotPose;
+      int       n = std::sscanf(argv[++i], "%f,%f,%f,%f,%f", &p.x, &p.y, &p.z,
+                                &p.angle, &p.pitch);
+      if (n < 4) {
+        std::cerr << "Invalid camera, expected X,Y,Z,ANGLE[,PITCH]\n";
+        return 1;
+      }
+      options.hasPose = true;
+    } else if (arg == "--trace" && i + 1 < argc) {
+      options.traceFile = argv[++i];
+    } else if (arg == "--alloc-report") {
+      options.allocReport = true;
+    } else if (arg == "--automap" && i + 1 < argc) {
+      options.automapDir = argv[++i];
+    } else if (!options.automapDir.empty() && arg[0] != '-') {
+      options.automapFiles.push_back(arg);  // Every WAD after --automap
+    } else if (arg == "--size" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%dx%d", &options.screenshotWidth,
+                      &options.screenshotHeight) != 2 ||
+          options.screenshotWidth <= 0 || options.screenshotHeight <= 0) {
+        std::cerr << "Invalid size, expected WIDTHxHEIGHT\n";
+        return 1;
+      }
+    } else if (arg[0] == '-' && options.contentFile.empty()) {
+      // Format specification, only valid before the content file
+      std::string formatStr = arg.substr(1);  // Remove the leading '-'
+
+      if (formatStr == "wad") {
+        format = Format::WAD;
+      } else if (formatStr == "json") {
+        format = Format::JSON;
+      } else if (formatStr == "dsl") {
+        format = Format::DSL;
+      } else {
+        std::cerr << "Invalid format specified. Using default (wad)\n";
+      }
+    } else if (options.contentFile.empty()) {
+      options.contentFile = arg;
+    } else if (options.levelName.empty()) {
+      options.levelName = arg;
+    } else {
+      options.contentFile.clear();  // Too many arguments, show usage
+      break;
+    }
+  }
+
+  if (!options.traceFile.empty()) {
+#ifndef WAD_VIEWER_TRACING
+    std::cerr << "Tracing is not compiled in, build with make TRACE=1\n";
+#endif
+    Trace::start();
+  }
+  if (options.allocReport && !AllocationTracker::enabled()) {
+    std::cerr << "Allocation tracking is not compiled in, build with make "
+                 "ALLOC_TRACKING=1\n";
+  }
+
+  // Automap images only need the geometry of each WAD on its own
+  if (!options.automapDir.empty()) {
+    return renderAutomaps(options.automapDir, options.automapFiles,
+                          options.traceFile);
+  }
+
+  // clang-format off
+  if (options.contentFile.empty()) {
+    std::cout << "Usage: wadviewer [-format] <content_file> [-file <pwad>]... [<level_name>]\n";
+    std::cout << "  -format     : Optional format of input file (-wad, -json, -dsl). Default: wad\n";
+    std::cout << "  content_file: Path to the input file (WAD/JSON/DSL format)\n";
+    std::cout << "  -file pwad  : Optional. PWAD loaded over the content file, can be repeated\n";
+    std::cout << "  --compact-report : Compare float and compact vertex memory for every level and exit\n";
+    std::cout << "  --optimize-report: Show triangles saved by merging walls and skipping the sky, vertex counts and ACMR and exit\n";
+    std::cout << "  --mem-report     : Show the bytes held by the directories, level assets, RGBA textures and mesh buffers and exit\n";
+    std::cout << "  --overdraw-report: Show the overdraw at the player start with texture and BSP front-to-back draw order and exit\n";
+    std::cout << "  --screenshot file: Render the level with the software renderer to a PNG file and exit\n";
+    std::cout << "  --camera x,y,z,angle[,pitch]: Screenshot viewpoint in map units and degrees. Default: player start\n";
+    std::cout << "  --size WxH       : Screenshot size in pixels. Default: 640x400\n";
+    std::cout << "  --trace file     : Write a Chrome trace of the loading phases to file (needs make TRACE=1)\n";
+    std::cout << "  --alloc-report   : Print the heap allocations of each loading phase and of the frames (needs make ALLOC_TRACKING=1)\n";
+    std::cout << "  --automap dir wad...: Save an automap PNG of every level of every WAD to dir and exit\n";
+    std::cout << "  level_name  : Optional. Name of the level to display. Default: first level in the file\n";
+    return 1;
+  }
+  // clang-format on
+
+  // Headless modes, they only need the WAD data and not the engine
+  if (options.any()) {
+    return runHeadlessMode(options);
+  }
+
   OkLogger::info("Main :: Starting up...");
   OkCore::initialize();
 
@@ -222,74 +313,46 @@ int main(int argc, char *argv[]) {
     OkLogger::error("Game :: No current scene found");
   }
 
-  // ******************************************************************************************
-  // ******************************************************************************************
-  // ******************************************************************************************
-  // ******************************************************************************************
-  // ******************************************************************************************
-  // ******************************************************************************************
-
-  // clang-format off
-  if (argc < 2 || argc > 4) {
-    std::cout << "Usage: wadviewer [-format] <content_file> [<level_name>]\n";
-    std::cout << "  -format     : Optional format of input file (-wad, -json, -dsl). Default: wad\n";
-    std::cout << "  content_file: Path to the input file (WAD/JSON/DSL format)\n";
-    std::cout << "  level_name  : Optional. Name of the level to display. Default: first level in the file\n";
-    return 1;
-  }
-  // clang-format on
-
-  Format      format = Format::WAD;  // Default format
-  std::string contentFile;
-  std::string levelName = "";  // Empty string means use first level
-
-  // Check if first argument is a format specification
-  if (argv[1][0] == '-') {
-    std::string formatStr = argv[1];
-    formatStr             = formatStr.substr(1);  // Remove the leading '-'
-
-    if (formatStr == "wad") {
-      format = Format::WAD;
-    } else if (formatStr == "json") {
-      format = Format::JSON;
-    } else if (formatStr == "dsl") {
-      format = Format::DSL;
-    } else {
-      std::cerr << "Invalid format specified. Using default (wad)\n";
-    }
-
-    contentFile = argv[2];
-    if (argc == 4) {
-      levelName = argv[3];
-    }
-  } else {
-    // No format specified, use defaults
-    contentFile = argv[1];
-    if (argc == 3) {
-      levelName = argv[2];
-    }
-  }
-
   try {
-    WAD wad(contentFile);  // Verbose mode
-    wad.processWAD();
+    TRACE_ZONE("main::loadLevel");
+    WADStack wads;
+    {
+      AllocationTracker::Phase phase("main::loadWADStack");
+      loadWADStack(wads, options.contentFile, options.pwadFiles);
+    }
 
     // If no level name was provided, use the first level
-    if (levelName.empty()) {
-      levelName = wad.getLevelNameByIndex(0);
-      // OkLogger::info("Using first level: " + levelName);
+    if (options.levelName.empty()) {
+      options.levelName = wads.getLevelNameByIndex(0);
+      // OkLogger::info("Using first level: " + options.levelName);
     }
 
-    WAD::Level level = wad.getLevel(levelName);
+    WAD::Level level;
+    {
+      AllocationTracker::Phase phase("main::getLevel");
+      level = wads.getLevel(options.levelName);
+    }
     OkLogger::info("Level name: " +
                    std::string(level.name, strnlen(level.name, 8)));
 
     // Create level geometry using the converter
-    WADConverter          converter;
-    std::vector<OkItem *> levelItems = converter.createLevelGeometry(level);
+    // The linedefs and sectors of big levels are split across the pool
+    ThreadPool   pool;
+    WADConverter converter;
+    LevelMesh    mesh;
+    {
+      AllocationTracker::Phase phase("main::buildLevelMesh");
+      mesh = converter.buildLevelMesh(level, &pool);
+      MeshOptimizer::optimize(mesh);
+    }
+    std::vector<OkItem *> levelItems;
+    {
+      AllocationTracker::Phase phase("main::createLevelItems");
+      levelItems = converter.createLevelItems(level, mesh);
+    }
 
     // Create a secondary camera in the player start position
-    OkPoint  *playerStart = converter.getPlayerStartPosition(level);
+    OkPoint  *playerStart = converter.getPlayerStartPosition(level, mesh);
     OkCamera *povCamera   = new OkCamera(OkConfig::getInt("window.width"),
                                          OkConfig::getInt("window.height"));
 
@@ -305,6 +368,18 @@ int main(int argc, char *argv[]) {
       scene->addItem(levelItems[i]);
     }
 
+    // Masked surfaces are blended, so they go after the opaque geometry and
+    // from the farthest to the nearest to the player start
+    std::vector<OkItem *> maskedItems = converter.createMaskedItems(mesh);
+    MaskedSurfaceSorter   sorter(level, mesh);
+    float viewX = level.has_player_start ? level.player_start.x : mesh.centerX;
+    float viewY = level.has_player_start ? level.player_start.y : mesh.centerY;
+    const std::vector<uint32_t> &order = sorter.sort(viewX, viewY);
+    for (size_t i = 0; i < order.size(); ++i) {
+      maskedItems[order[i]]->setWireframe(false);
+      scene->addItem(maskedItems[order[i]]);
+    }
+
     // Position camera to view the entire level
     positionCameraForLevel(camera, levelItems);
 
@@ -336,8 +411,19 @@ int main(int argc, char *argv[]) {
   OkLogger::info("Scene :: Item count: " +
                  std::to_string(scene->getItemCount()));
 
-  // Start game loop
+  // Startup is over, the trace covers it
+  try {
+    writeTrace(options.traceFile);
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << "\n";
+  }
+
+  // Start game loop, the frames counted start with it
+  AllocationTracker::resetFrames();
   OkCore::loop(stepCallback, drawCallback);
+  if (options.allocReport) {
+    AllocationTracker::report(std::cout);
+  }
 
   // Cleanup
   // delete item;
@@ -0,0 +1,63 @@
+#include "mapped-file.hpp"
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Map a file into memory
+ * @param filepath Path to the file
+ * @throws std::runtime_error if the file cannot be opened or mapped
+ */
+MappedFile::MappedFile(const std::string &filepath)
+    : filepath_(filepath), data_(nullptr), size_(0) {
+  int fd = open(filepath_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Unable to open file: " + filepath_);
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    throw std::runtime_error("Unable to read file size: " + filepath_);
+  }
+
+  size_ = static_cast<std::size_t>(info.st_size);
+
+  // mmap does not accept empty mappings, an empty file just has no data
+  if (size_ > 0) {
+    void *mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Unable to map file: " + filepath_);
+    }
+    data_ = static_cast<const uint8_t *>(mapping);
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+}
+
+/**
+ * @brief Unmap the file
+ */
+MappedFile::~MappedFile() {
+  if (data_) {
+    munmap(const_cast<uint8_t *>(data_), size_);
+  }
+}
+
+/**
+ * @brief Get a pointer to a range of bytes of the file
+ * @param offset Offset of the first byte
+ * @param size Number of bytes
+ * @return Pointer to the first byte of the range
+ * @throws std::runtime_error if the range is not fully inside the file
+ */
+const uint8_t *MappedFile::range(uint64_t offset, uint64_t size) const {
+  if (offset > size_ || size > size_ - offset) {
+    throw std::runtime_error("Data out of bounds in file: " + filepath_);
+  }
+  return data_ + offset;
+}
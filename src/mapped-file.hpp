@@ -0,0 +1,34 @@
+#ifndef WAD_VIEWER_MAPPED_FILE_HPP
+#define WAD_VIEWER_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * Lump views point directly into the mapping, so it must stay alive for as
+ * long as any level loaded from the file is in use.
+ */
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &filepath);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &)            = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const uint8_t *data() const { return data_; }
+  std::size_t    size() const { return size_; }
+
+  // Pointer to the bytes [offset, offset + size), checked against the file
+  const uint8_t *range(uint64_t offset, uint64_t size) const;
+
+private:
+  std::string    filepath_;
+  const uint8_t *data_;
+  std::size_t    size_;
+};
+
+#endif  // WAD_VIEWER_MAPPED_FILE_HPP
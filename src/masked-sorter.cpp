@@ -0,0 +1,97 @@
+#include "masked-sorter.hpp"
+#include <algorithm>
+
+/**
+ * @brief Index the masked surfaces of a mesh by linedef side
+ * @param level The level the mesh was built from
+ * @param mesh The mesh, its masked surfaces are referred to by index
+ */
+MaskedSurfaceSorter::MaskedSurfaceSorter(const WAD::Level &level,
+                                         const LevelMesh  &mesh)
+    : tree_(level), frame_(0) {
+  const std::size_t sideCount = level.linedefs.size() * 2;
+
+  // Counting sort of the surfaces by linedef side
+  first_.assign(sideCount + 1, 0);
+  for (std::size_t m = 0; m < mesh.masked.size(); m++) {
+    const LevelMesh::MaskedSurface &surface = mesh.masked[m];
+    std::size_t                     side = surface.linedef * 2 + surface.side;
+    if (side < sideCount) {
+      first_[side + 1]++;
+    }
+  }
+  for (std::size_t s = 0; s < sideCount; s++) {
+    first_[s + 1] += first_[s];
+  }
+
+  surfaces_.resize(first_[sideCount]);
+  std::vector<uint32_t> fill(first_.begin(), first_.end() - 1);
+  for (std::size_t m = 0; m < mesh.masked.size(); m++) {
+    const LevelMesh::MaskedSurface &surface = mesh.masked[m];
+    std::size_t                     side = surface.linedef * 2 + surface.side;
+    if (side < sideCount) {
+      surfaces_[fill[side]++] = static_cast<uint32_t>(m);
+    }
+  }
+
+  emittedAt_.assign(mesh.masked.size(), 0);
+  order_.reserve(mesh.masked.size());
+  subsectors_.reserve(tree_.subsectorCount());
+}
+
+/**
+ * @brief Order the masked surfaces for a viewpoint
+ * @param x Map X coordinate of the viewpoint
+ * @param y Map Y coordinate of the viewpoint
+ * @return Every masked surface index, from the farthest to the nearest
+ * @note A linedef side split in several segs is emitted with its first seg.
+ */
+const std::vector<uint32_t> &MaskedSurfaceSorter::sort(float x, float y) {
+  const std::size_t sideCount = first_.size() - 1;
+
+  // A frame number per call saves clearing the emitted marks
+  frame_++;
+  if (frame_ == 0) {
+    emittedAt_.assign(emittedAt_.size(), 0);
+    frame_ = 1;
+  }
+
+  order_.clear();
+  if (emittedAt_.empty()) {
+    return order_;  // Most levels have no masked surfaces at all
+  }
+
+  tree_.backToFront(x, y, subsectors_);
+  for (std::size_t i = 0; i < subsectors_.size(); i++) {
+    const BSPTree::Seg *segs  = tree_.subsectorSegs(subsectors_[i]);
+    std::size_t         count = tree_.subsectorSegCount(subsectors_[i]);
+    for (std::size_t s = 0; s < count; s++) {
+      std::size_t side = segs[s].linedef * 2 + segs[s].side;
+      if (side >= sideCount) {
+        continue;
+      }
+
+      for (uint32_t j = first_[side]; j < first_[side + 1]; j++) {
+        uint32_t surface = surfaces_[j];
+        if (emittedAt_[surface] != frame_) {
+          emittedAt_[surface] = frame_;
+          order_.push_back(surface);
+        }
+      }
+    }
+  }
+
+  // Without a usable BSP tree, or for surfaces no seg refers to, keep the
+  // mesh order in front of the sorted ones
+  if (order_.size() < emittedAt_.size()) {
+    std::size_t sorted = order_.size();
+    for (uint32_t m = 0; m < emittedAt_.size(); m++) {
+      if (emittedAt_[m] != frame_) {
+        order_.push_back(m);
+      }
+    }
+    std::rotate(order_.begin(), order_.begin() + sorted, order_.end());
+  }
+
+  return order_;
+}
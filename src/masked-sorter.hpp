@@ -0,0 +1,44 @@
+#ifndef WAD_VIEWER_MASKED_SORTER_HPP
+#define WAD_VIEWER_MASKED_SORTER_HPP
+
+#include "./bsp-tree.hpp"
+#include "./level-mesh.hpp"
+#include "./wad.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Per-frame back-to-front order of the masked surfaces of a level.
+ *
+ * A masked surface lies on a linedef side, and the segs of that side bound
+ * the subsectors in front of it, so walking the BSP subsectors from the
+ * farthest to the nearest and emitting the surfaces of their segs gives a
+ * correct painter's order without sorting by distance. Surfaces are looked up
+ * by linedef side, and sort() reuses its buffers, so only the masked surfaces
+ * pay for the ordering and a frame does not allocate.
+ */
+class MaskedSurfaceSorter {
+public:
+  MaskedSurfaceSorter(const WAD::Level &level, const LevelMesh &mesh);
+
+  // Indices into mesh.masked from the farthest to the nearest to a map
+  // position. Surfaces no seg reaches come first.
+  const std::vector<uint32_t> &sort(float x, float y);
+
+private:
+  BSPTree tree_;
+
+  // Surfaces of linedef side s are surfaces_[first_[s]] up to first_[s + 1],
+  // where s is linedef * 2 + side
+  std::vector<uint32_t> first_;
+  std::vector<uint32_t> surfaces_;
+
+  // Buffers reused by every sort()
+  std::vector<uint16_t> subsectors_;
+  std::vector<uint32_t> order_;
+  std::vector<uint32_t> emittedAt_;  // sort() call that last emitted a surface
+  uint32_t              frame_;
+};
+
+#endif  // WAD_VIEWER_MASKED_SORTER_HPP
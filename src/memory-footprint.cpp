@@ -0,0 +1,166 @@
+#include "memory-footprint.hpp"
+#include <algorithm>
+
+/**
+ * @brief Get the footprint of a string
+ * @param text The string
+ * @return Its characters, none held if they fit in the string object
+ */
+MemoryFootprint MemoryFootprint::of(const std::string &text) {
+  const char *begin = reinterpret_cast<const char *>(&text);
+  const char *data  = text.data();
+
+  MemoryFootprint footprint;
+  if (data < begin || data >= begin + sizeof(text)) {
+    footprint.used = text.size() + 1;
+    footprint.held = text.capacity() + 1;
+  }
+  return footprint;
+}
+
+/**
+ * @brief Get the footprint of a list of strings
+ * @param strings The strings
+ * @return The string objects and the characters stored outside them
+ */
+MemoryFootprint MemoryFootprint::of(const std::vector<std::string> &strings) {
+  MemoryFootprint footprint;
+  footprint.used = strings.size() * sizeof(std::string);
+  footprint.held = strings.capacity() * sizeof(std::string);
+  for (std::size_t i = 0; i < strings.size(); i++) {
+    footprint += of(strings[i]);
+  }
+  return footprint;
+}
+
+/**
+ * @brief Get the footprint of decoded patches
+ * @param patches The patches
+ * @return The patch records and their pixel and opacity buffers
+ */
+MemoryFootprint
+MemoryFootprint::of(const std::vector<WAD::PatchData> &patches) {
+  MemoryFootprint footprint;
+  footprint.used = patches.size() * sizeof(WAD::PatchData);
+  footprint.held = patches.capacity() * sizeof(WAD::PatchData);
+  for (std::size_t i = 0; i < patches.size(); i++) {
+    footprint += of(patches[i].pixels);
+    footprint += of(patches[i].opaque);
+  }
+  return footprint;
+}
+
+/**
+ * @brief Get the footprint of texture definitions
+ * @param defs The definitions
+ * @return The definitions and their patch lists
+ */
+MemoryFootprint
+MemoryFootprint::of(const std::vector<WAD::TextureDef> &defs) {
+  MemoryFootprint footprint;
+  footprint.used = defs.size() * sizeof(WAD::TextureDef);
+  footprint.held = defs.capacity() * sizeof(WAD::TextureDef);
+  for (std::size_t i = 0; i < defs.size(); i++) {
+    footprint += of(defs[i].patches);
+  }
+  return footprint;
+}
+
+/**
+ * @brief Get the footprint of flats
+ * @param flats The flats
+ * @return The flat records and their pixels
+ */
+MemoryFootprint MemoryFootprint::of(const std::vector<WAD::FlatData> &flats) {
+  MemoryFootprint footprint;
+  footprint.used = flats.size() * sizeof(WAD::FlatData);
+  footprint.held = flats.capacity() * sizeof(WAD::FlatData);
+  for (std::size_t i = 0; i < flats.size(); i++) {
+    footprint += of(flats[i].data);
+  }
+  return footprint;
+}
+
+/**
+ * @brief Get the footprint of a level mesh
+ * @param mesh The mesh
+ * @return The groups with their vertex and index buffers, and the masked
+ * surfaces
+ */
+MemoryFootprint MemoryFootprint::of(const LevelMesh &mesh) {
+  MemoryFootprint footprint;
+  footprint.used = mesh.groups.size() * sizeof(LevelMesh::Group);
+  footprint.held = mesh.groups.capacity() * sizeof(LevelMesh::Group);
+  for (std::size_t g = 0; g < mesh.groups.size(); g++) {
+    footprint += of(mesh.groups[g].vertices);
+    footprint += of(mesh.groups[g].indices);
+  }
+  footprint += of(mesh.masked);
+  return footprint;
+}
+
+/**
+ * @brief Sum the assets of a level
+ * @return Bytes of every asset list
+ */
+MemoryFootprint LevelAssetFootprint::total() const {
+  MemoryFootprint sum;
+  sum += patches;
+  sum += patchNames;
+  sum += textureDefs;
+  sum += palette;
+  sum += flats;
+  return sum;
+}
+
+/**
+ * @brief Get the footprint of the resources a level carries
+ * @param level The level
+ * @return Bytes of each asset list
+ */
+LevelAssetFootprint LevelAssetFootprint::of(const WAD::Level &level) {
+  LevelAssetFootprint assets;
+  assets.patches     = MemoryFootprint::of(level.patches);
+  assets.patchNames  = MemoryFootprint::of(level.patch_names);
+  assets.textureDefs = MemoryFootprint::of(level.texture_defs);
+  assets.palette     = MemoryFootprint::of(level.palette);
+  assets.flats       = MemoryFootprint::of(level.flats);
+  return assets;
+}
+
+/**
+ * @brief Get the size of the geometry a level views in its WAD file
+ * @param level The level
+ * @return Bytes of the geometry and BSP lumps
+ */
+std::size_t MemoryFootprint::mappedGeometry(const WAD::Level &level) {
+  return level.vertices.sizeInBytes() + level.linedefs.sizeInBytes() +
+         level.sidedefs.sizeInBytes() + level.sectors.sizeInBytes() +
+         level.things.sizeInBytes() + level.segs.sizeInBytes() +
+         level.subsectors.sizeInBytes() + level.nodes.sizeInBytes();
+}
+
+/**
+ * @brief Get the size of the RGBA textures uploaded for a level
+ * @param level The level
+ * @param mesh The mesh built for the level
+ * @return Four bytes per texel of every flat and used wall texture
+ */
+MemoryFootprint MemoryFootprint::rgbaTextures(const WAD::Level &level,
+                                              const LevelMesh  &mesh) {
+  const std::size_t FLAT_BYTES = 64 * 64 * 4;
+
+  std::vector<LumpName> used = mesh.usedTextures();
+
+  MemoryFootprint footprint;
+  footprint.used = level.flats.size() * FLAT_BYTES;
+  for (std::size_t t = 0; t < level.texture_defs.size(); t++) {
+    const WAD::TextureDef &texDef = level.texture_defs[t];
+    if (std::binary_search(used.begin(), used.end(),
+                           LumpName(texDef.name))) {
+      footprint.used += std::size_t(texDef.width) * texDef.height * 4;
+    }
+  }
+  footprint.held = footprint.used;
+  return footprint;
+}
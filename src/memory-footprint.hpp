@@ -0,0 +1,87 @@
+#ifndef WAD_VIEWER_MEMORY_FOOTPRINT_HPP
+#define WAD_VIEWER_MEMORY_FOOTPRINT_HPP
+
+#include "./level-mesh.hpp"
+#include "./wad.hpp"
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Heap bytes held by the loaded WAD data and by what is built from
+ * it.
+ *
+ * used counts the elements and held the blocks they live in, unused
+ * capacity included, so held - used is what right-sizing a container would
+ * save. Level geometry is viewed in the mapped file and holds no heap
+ * memory, mappedGeometry() gives its size. Hash tables are estimated from
+ * their bucket and element counts.
+ */
+struct MemoryFootprint {
+  std::size_t used = 0;
+  std::size_t held = 0;
+
+  MemoryFootprint &operator+=(const MemoryFootprint &other) {
+    used += other.used;
+    held += other.held;
+    return *this;
+  }
+
+  // Containers of plain records, elements holding memory of their own have
+  // an overload below
+  template <typename T>
+  static MemoryFootprint of(const std::vector<T> &values) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Elements holding heap memory need their own overload");
+    MemoryFootprint footprint;
+    footprint.used = values.size() * sizeof(T);
+    footprint.held = values.capacity() * sizeof(T);
+    return footprint;
+  }
+
+  // One pointer per bucket, and per element a node with the next pointer
+  template <typename K, typename V, typename H>
+  static MemoryFootprint of(const std::unordered_map<K, V, H> &map) {
+    typedef typename std::unordered_map<K, V, H>::value_type Entry;
+
+    MemoryFootprint footprint;
+    footprint.used = map.size() * sizeof(Entry);
+    footprint.held = map.bucket_count() * sizeof(void *) +
+                     map.size() * (sizeof(Entry) + sizeof(void *));
+    return footprint;
+  }
+
+  static MemoryFootprint of(const std::string &text);
+  static MemoryFootprint of(const std::vector<std::string> &strings);
+  static MemoryFootprint of(const std::vector<WAD::PatchData> &patches);
+  static MemoryFootprint of(const std::vector<WAD::TextureDef> &defs);
+  static MemoryFootprint of(const std::vector<WAD::FlatData> &flats);
+
+  // Vertex and index buffers of every group and the masked surfaces
+  static MemoryFootprint of(const LevelMesh &mesh);
+
+  // Bytes of the geometry lumps viewed in the mapped WAD file
+  static std::size_t mappedGeometry(const WAD::Level &level);
+
+  // RGBA pixels of the textures WADConverter::createLevelItems() uploads:
+  // every flat of the level and the wall textures the mesh uses
+  static MemoryFootprint rgbaTextures(const WAD::Level &level,
+                                      const LevelMesh  &mesh);
+};
+
+// Footprint of the resources every level carries its own copy of
+struct LevelAssetFootprint {
+  MemoryFootprint patches;
+  MemoryFootprint patchNames;
+  MemoryFootprint textureDefs;
+  MemoryFootprint palette;
+  MemoryFootprint flats;
+
+  MemoryFootprint total() const;
+
+  static LevelAssetFootprint of(const WAD::Level &level);
+};
+
+#endif  // WAD_VIEWER_MEMORY_FOOTPRINT_HPP
@@ -0,0 +1,315 @@
+#include "mesh-optimizer.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+// Bits of a vertex, so welding only merges exactly identical vertices
+struct VertexKey {
+  uint32_t bits[LevelMesh::Vertex::FLOAT_COUNT];
+
+  explicit VertexKey(const LevelMesh::Vertex &vertex) {
+    std::memcpy(bits, &vertex, sizeof(bits));
+  }
+
+  bool operator==(const VertexKey &other) const {
+    return std::memcmp(bits, other.bits, sizeof(bits)) == 0;
+  }
+
+  struct Hash {
+    std::size_t operator()(const VertexKey &key) const {
+      // FNV-1a over the five words
+      uint64_t hash = 14695981039346656037ULL;
+      for (std::size_t i = 0; i < LevelMesh::Vertex::FLOAT_COUNT; i++) {
+        hash = (hash ^ key.bits[i]) * 1099511628211ULL;
+      }
+      return static_cast<std::size_t>(hash);
+    }
+  };
+};
+
+// Scoring constants from Tom Forsyth's "Linear-Speed Vertex Cache
+// Optimisation"
+const float CACHE_DECAY_POWER   = 1.5f;
+const float LAST_TRI_SCORE      = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+/**
+ * @brief Score of a vertex: high when it is near the front of the cache or
+ * has few triangles left, so finishing it frees a cache entry
+ * @param cachePosition Position in the cache, -1 if not in the cache
+ * @param remaining Triangles using the vertex that are not emitted yet
+ * @return The score, -1 for vertices without triangles left
+ */
+float vertexScore(int cachePosition, unsigned int remaining) {
+  if (remaining == 0) {
+    return -1.0f;
+  }
+
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      // Used by the last triangle, fixed score so it is not always reused
+      score = LAST_TRI_SCORE;
+    } else {
+      const float scaler = 1.0f / (MeshOptimizer::CACHE_SIZE - 3);
+      score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+    }
+  }
+
+  score += VALENCE_BOOST_SCALE *
+           std::pow(static_cast<float>(remaining), -VALENCE_BOOST_POWER);
+  return score;
+}
+
+}  // namespace
+
+/**
+ * @brief Optimize every group of a mesh
+ * @param mesh The mesh, modified in place
+ */
+void MeshOptimizer::optimize(LevelMesh &mesh) {
+  for (std::size_t g = 0; g < mesh.groups.size(); g++) {
+    LevelMesh::Group &group = mesh.groups[g];
+    weldVertices(group);
+    optimizeVertexCache(group.indices, group.vertices.size());
+    optimizeVertexFetch(group);
+  }
+}
+
+/**
+ * @brief Merge identical vertices of a group and drop the triangles that use
+ * the same vertex twice after merging
+ * @param group The group, modified in place
+ */
+void MeshOptimizer::weldVertices(LevelMesh::Group &group) {
+  std::unordered_map<VertexKey, unsigned int, VertexKey::Hash> unique;
+  unique.reserve(group.vertices.size());
+
+  std::vector<LevelMesh::Vertex> welded;
+  std::vector<unsigned int>      remap(group.vertices.size());
+  welded.reserve(group.vertices.size());
+
+  for (std::size_t v = 0; v < group.vertices.size(); v++) {
+    std::pair<std::unordered_map<VertexKey, unsigned int,
+                                 VertexKey::Hash>::iterator,
+              bool>
+        found = unique.insert(std::make_pair(
+            VertexKey(group.vertices[v]),
+            static_cast<unsigned int>(welded.size())));
+    if (found.second) {
+      welded.push_back(group.vertices[v]);
+    }
+    remap[v] = found.first->second;
+  }
+
+  // Remap the indices, compacting away degenerate triangles
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i + 2 < group.indices.size(); i += 3) {
+    unsigned int a = remap[group.indices[i]];
+    unsigned int b = remap[group.indices[i + 1]];
+    unsigned int c = remap[group.indices[i + 2]];
+    if (a == b || b == c || a == c) {
+      continue;
+    }
+    group.indices[kept++] = a;
+    group.indices[kept++] = b;
+    group.indices[kept++] = c;
+  }
+  group.indices.resize(kept);
+  group.vertices.swap(welded);
+}
+
+/**
+ * @brief Reorder triangles for the post-transform vertex cache
+ * @param indices Triangle list, reordered in place
+ * @param vertexCount Number of vertices the indices refer to
+ * @note Greedy: after each triangle, the next one is the best scored among
+ * the triangles of the vertices in the simulated LRU cache, so only those
+ * scores are updated. When none is left, the next unemitted triangle in the
+ * original order is taken.
+ */
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int> &indices,
+                                        std::size_t vertexCount) {
+  const std::size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  // Triangles of each vertex: the active ones are the first remaining[v]
+  // entries of adjacency starting at offsets[v]
+  std::vector<unsigned int> remaining(vertexCount, 0);
+  for (std::size_t i = 0; i < triangleCount * 3; i++) {
+    remaining[indices[i]]++;
+  }
+
+  std::vector<unsigned int> offsets(vertexCount + 1, 0);
+  for (std::size_t v = 0; v < vertexCount; v++) {
+    offsets[v + 1] = offsets[v] + remaining[v];
+  }
+
+  std::vector<unsigned int> adjacency(triangleCount * 3);
+  std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+  for (std::size_t t = 0; t < triangleCount; t++) {
+    for (int k = 0; k < 3; k++) {
+      adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+    }
+  }
+
+  std::vector<int>   cachePosition(vertexCount, -1);
+  std::vector<float> score(vertexCount);
+  for (std::size_t v = 0; v < vertexCount; v++) {
+    score[v] = vertexScore(-1, remaining[v]);
+  }
+
+  std::vector<float> triangleScore(triangleCount);
+  std::vector<char>  emitted(triangleCount, 0);
+  for (std::size_t t = 0; t < triangleCount; t++) {
+    triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] +
+                       score[indices[t * 3 + 2]];
+  }
+
+  std::vector<unsigned int> output;
+  output.reserve(triangleCount * 3);
+
+  std::vector<unsigned int> cache;
+  std::vector<unsigned int> newCache;
+  cache.reserve(CACHE_SIZE + 3);
+  newCache.reserve(CACHE_SIZE + 3);
+
+  std::size_t scanCursor = 0;
+  long        best       = -1;
+
+  while (output.size() < triangleCount * 3) {
+    if (best < 0) {
+      while (emitted[scanCursor]) {
+        scanCursor++;
+      }
+      best = static_cast<long>(scanCursor);
+    }
+
+    // Emit the triangle and take it out of its vertices' lists
+    const unsigned int *triangle = &indices[best * 3];
+    emitted[best]                = 1;
+    newCache.clear();
+    for (int k = 0; k < 3; k++) {
+      unsigned int v = triangle[k];
+      output.push_back(v);
+      newCache.push_back(v);
+
+      unsigned int *list = &adjacency[offsets[v]];
+      for (unsigned int j = 0; j < remaining[v]; j++) {
+        if (list[j] == static_cast<unsigned int>(best)) {
+          list[j] = list[remaining[v] - 1];
+          break;
+        }
+      }
+      remaining[v]--;
+    }
+
+    // The triangle's vertices move to the front of the LRU cache
+    for (std::size_t c = 0; c < cache.size(); c++) {
+      unsigned int v = cache[c];
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        newCache.push_back(v);
+      }
+    }
+
+    // Vertices pushed out of the cache lose their cache score
+    for (std::size_t c = CACHE_SIZE; c < newCache.size(); c++) {
+      unsigned int v   = newCache[c];
+      cachePosition[v] = -1;
+      score[v]         = vertexScore(-1, remaining[v]);
+    }
+    if (newCache.size() > CACHE_SIZE) {
+      newCache.resize(CACHE_SIZE);
+    }
+    cache.swap(newCache);
+
+    for (std::size_t c = 0; c < cache.size(); c++) {
+      unsigned int v   = cache[c];
+      cachePosition[v] = static_cast<int>(c);
+      score[v]         = vertexScore(static_cast<int>(c), remaining[v]);
+    }
+
+    // Rescore the triangles of the cached vertices and pick the best one
+    best            = -1;
+    float bestScore = -1.0f;
+    for (std::size_t c = 0; c < cache.size(); c++) {
+      unsigned int        v    = cache[c];
+      const unsigned int *list = &adjacency[offsets[v]];
+      for (unsigned int j = 0; j < remaining[v]; j++) {
+        unsigned int t   = list[j];
+        triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] +
+                           score[indices[t * 3 + 2]];
+        if (triangleScore[t] > bestScore) {
+          bestScore = triangleScore[t];
+          best      = static_cast<long>(t);
+        }
+      }
+    }
+  }
+
+  indices.swap(output);
+}
+
+/**
+ * @brief Reorder the vertices of a group in first-use order
+ * @param group The group, modified in place
+ */
+void MeshOptimizer::optimizeVertexFetch(LevelMesh::Group &group) {
+  const unsigned int UNUSED = ~0u;
+
+  std::vector<unsigned int>      remap(group.vertices.size(), UNUSED);
+  std::vector<LevelMesh::Vertex> ordered;
+  ordered.reserve(group.vertices.size());
+
+  for (std::size_t i = 0; i < group.indices.size(); i++) {
+    unsigned int &index = group.indices[i];
+    if (remap[index] == UNUSED) {
+      remap[index] = static_cast<unsigned int>(ordered.size());
+      ordered.push_back(group.vertices[index]);
+    }
+    index = remap[index];
+  }
+
+  // Vertices no triangle uses are dropped
+  group.vertices.swap(ordered);
+}
+
+/**
+ * @brief Count the vertices transformed by a FIFO post-transform cache
+ * @param mesh The mesh to measure
+ * @return Vertex, triangle and cache miss counts over every group
+ */
+MeshOptimizer::Stats MeshOptimizer::measure(const LevelMesh &mesh) {
+  Stats stats;
+
+  for (std::size_t g = 0; g < mesh.groups.size(); g++) {
+    const LevelMesh::Group &group = mesh.groups[g];
+
+    // A vertex is still cached if fewer than CACHE_SIZE misses happened
+    // since it was loaded
+    std::vector<std::size_t> loadedAt(group.vertices.size(), 0);
+    std::vector<char>        loaded(group.vertices.size(), 0);
+    std::size_t              misses = 0;
+
+    for (std::size_t i = 0; i < group.indices.size(); i++) {
+      unsigned int v = group.indices[i];
+      if (!loaded[v] || misses - loadedAt[v] >= CACHE_SIZE) {
+        loaded[v]   = 1;
+        loadedAt[v] = misses;
+        misses++;
+      }
+    }
+
+    stats.vertexCount += group.vertices.size();
+    stats.triangleCount += group.indices.size() / 3;
+    stats.cacheMisses += misses;
+  }
+
+  return stats;
+}
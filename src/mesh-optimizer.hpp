@@ -0,0 +1,51 @@
+#ifndef WAD_VIEWER_MESH_OPTIMIZER_HPP
+#define WAD_VIEWER_MESH_OPTIMIZER_HPP
+
+#include "./level-mesh.hpp"
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Mesh optimization stage run on a LevelMesh after it is built.
+ *
+ * Welds vertices that are bit-for-bit identical, drops the triangles that
+ * become degenerate, reorders the triangles of every group for the
+ * post-transform vertex cache (Tom Forsyth's linear-speed algorithm) and
+ * finally reorders the vertices in first-use order. The geometry drawn is
+ * unchanged, only the buffers and their order.
+ */
+class MeshOptimizer {
+public:
+  // Entries of the simulated post-transform vertex cache
+  static const std::size_t CACHE_SIZE = 32;
+
+  struct Stats {
+    std::size_t vertexCount   = 0;
+    std::size_t triangleCount = 0;
+    std::size_t cacheMisses   = 0;  // Vertices transformed with a FIFO cache
+
+    // Average cache miss ratio: transformed vertices per triangle
+    double acmr() const {
+      return triangleCount ? static_cast<double>(cacheMisses) / triangleCount
+                           : 0.0;
+    }
+  };
+
+  // Run every step on every group of the mesh
+  static void optimize(LevelMesh &mesh);
+
+  // Merge identical vertices and drop degenerate triangles
+  static void weldVertices(LevelMesh::Group &group);
+
+  // Reorder triangles to reuse the vertices still in the cache
+  static void optimizeVertexCache(std::vector<unsigned int> &indices,
+                                  std::size_t                vertexCount);
+
+  // Reorder vertices in the order the triangles first use them
+  static void optimizeVertexFetch(LevelMesh::Group &group);
+
+  // Simulate a CACHE_SIZE FIFO vertex cache over every group
+  static Stats measure(const LevelMesh &mesh);
+};
+
+#endif  // WAD_VIEWER_MESH_OPTIMIZER_HPP
@@ -0,0 +1,42 @@
+#include "png-file.hpp"
+#include <stdexcept>
+
+// Keep the implementation private to this file, the engine may build its own
+#define STB_IMAGE_WRITE_STATIC
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+namespace PNGFile {
+
+/**
+ * @brief Save RGBA pixels as a PNG file
+ * @param path Path of the file to write
+ * @param width Width in pixels
+ * @param height Height in pixels
+ * @param rgba width * height * 4 bytes, rows top to bottom
+ * @throws std::runtime_error if the file cannot be written
+ */
+void write(const std::string &path, int width, int height,
+           const unsigned char *rgba) {
+  if (!stbi_write_png(path.c_str(), width, height, 4, rgba, width * 4)) {
+    throw std::runtime_error("Could not write PNG file: " + path);
+  }
+}
+
+/**
+ * @brief Compress the following files at a level until the scope ends
+ * @param level zlib effort, lower is faster and gives larger files
+ */
+CompressionScope::CompressionScope(int level)
+    : previous_(stbi_write_png_compression_level) {
+  stbi_write_png_compression_level = level;
+}
+
+/**
+ * @brief Restore the level set before the scope
+ */
+CompressionScope::~CompressionScope() {
+  stbi_write_png_compression_level = previous_;
+}
+
+}  // namespace PNGFile
@@ -0,0 +1,33 @@
+#ifndef WAD_VIEWER_PNG_FILE_HPP
+#define WAD_VIEWER_PNG_FILE_HPP
+
+#include <string>
+
+/**
+ * @brief PNG output for the headless renderers, through stb_image_write.
+ */
+namespace PNGFile {
+
+// Save width * height RGBA pixels, rows top to bottom
+void write(const std::string &path, int width, int height,
+           const unsigned char *rgba);
+
+// Effort of the zlib compression while it lives, from 5 (fastest, stb
+// treats lower levels as 5) to 9, 8 by default. The previous level is
+// restored on destruction. The level applies to every thread, so create it
+// before writing from a pool
+class CompressionScope {
+public:
+  explicit CompressionScope(int level);
+  ~CompressionScope();
+
+  CompressionScope(const CompressionScope &)            = delete;
+  CompressionScope &operator=(const CompressionScope &) = delete;
+
+private:
+  int previous_;
+};
+
+}  // namespace PNGFile
+
+#endif  // WAD_VIEWER_PNG_FILE_HPP
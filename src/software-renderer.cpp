@@ -0,0 +1,483 @@
+#include "software-renderer.hpp"
+#include "png-file.hpp"
+#include "wad-converter.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Edge function: twice the signed area of (a, b, p), positive when p is on
+// the left of a -> b in screen space (y down)
+float edge(float ax, float ay, float bx, float by, float px, float py) {
+  return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+// Top-left rule: pixels exactly on an edge belong to the triangle only if
+// the edge is a top or a left one, for triangles with a positive area
+bool isTopLeft(float ax, float ay, float bx, float by) {
+  return (ay == by && bx > ax) || by < ay;
+}
+
+// Texel index of a repeating texture coordinate
+int wrap(float coordinate, int size) {
+  int texel = static_cast<int>(std::floor(coordinate * size)) % size;
+  return texel < 0 ? texel + size : texel;
+}
+
+}  // namespace
+
+/**
+ * @brief Allocate the color and depth buffers
+ * @param width Width in pixels
+ * @param height Height in pixels
+ */
+SoftwareRenderer::SoftwareRenderer(int width, int height)
+    : width_(width), height_(height),
+      depth_(static_cast<std::size_t>(width) * height, 0.0f),
+      color_(static_cast<std::size_t>(width) * height * 4, 0),
+      stripes_((height + STRIPE_HEIGHT - 1) / STRIPE_HEIGHT) {
+  setCamera(Camera());
+}
+
+/**
+ * @brief Set the viewpoint of the next draws
+ * @param camera Position, orientation and field of view
+ */
+void SoftwareRenderer::setCamera(const Camera &camera) {
+  const float cosYaw   = std::cos(camera.yaw);
+  const float sinYaw   = std::sin(camera.yaw);
+  const float cosPitch = std::cos(camera.pitch);
+  const float sinPitch = std::sin(camera.pitch);
+
+  // World z is the negated map y, so map angles turn clockwise around y
+  forward_[0] = cosYaw * cosPitch;
+  forward_[1] = sinPitch;
+  forward_[2] = -sinYaw * cosPitch;
+  right_[0]   = sinYaw;
+  right_[1]   = 0.0f;
+  right_[2]   = cosYaw;
+
+  // up = right x forward
+  up_[0] = right_[1] * forward_[2] - right_[2] * forward_[1];
+  up_[1] = right_[2] * forward_[0] - right_[0] * forward_[2];
+  up_[2] = right_[0] * forward_[1] - right_[1] * forward_[0];
+
+  for (int i = 0; i < 3; i++) {
+    eye_[i] = camera.position[i];
+  }
+  focal_ = (width_ / 2.0f) / std::tan(camera.fovX / 2.0f);
+}
+
+/**
+ * @brief Get the half angle of the view cone on the map
+ * @param camera The camera
+ * @param width Image width in pixels
+ * @param height Image height in pixels, pixels are square
+ * @return Half the map angle seen, pi / 2 (no culling) if the view reaches
+ * straight up or down
+ * @note A ray through the image at (sx, sy), in units of the focal length,
+ * goes cos(pitch) - sy * sin(pitch) forward on the map and sx sideways. The
+ * widest rays are at the side corners on the edge nearest the vertical.
+ */
+float SoftwareRenderer::mapHalfFov(const Camera &camera, int width,
+                                   int height) {
+  const float HALF_PI = 1.5707963f;
+
+  float tanX  = std::tan(camera.fovX / 2.0f);
+  float tanY  = tanX * height / width;
+  float pitch = std::fabs(camera.pitch);
+  float ahead = std::cos(pitch) - tanY * std::sin(pitch);
+  if (ahead <= 0.0f) {
+    return HALF_PI;
+  }
+  return std::min(HALF_PI, std::atan(tanX / ahead));
+}
+
+/**
+ * @brief Composite the wall textures and flats used by a mesh
+ * @param level The level the mesh was built from
+ * @param mesh The mesh, its groups and masked surfaces name the textures
+ * @note Textures already loaded are kept, so the renderer can be reused for
+ * the levels of a WAD.
+ */
+void SoftwareRenderer::loadTextures(const WAD::Level &level,
+                                    const LevelMesh  &mesh) {
+  std::vector<LumpName> used = mesh.usedTextures();
+
+  // Flats and wall textures share the names of the groups, as in
+  // WADConverter::createLevelItems()
+  for (std::size_t i = 0; i < level.flats.size(); i++) {
+    LumpName name(level.flats[i].name);
+    if (textures_.count(name) ||
+        !std::binary_search(used.begin(), used.end(), name)) {
+      continue;
+    }
+
+    Texture texture;
+    if (WADConverter::convertFlat(name.str(), level.flats[i], level.palette,
+                                  texture.rgba)) {
+      texture.width  = 64;
+      texture.height = 64;
+      textures_.insert(std::make_pair(name, std::move(texture)));
+    }
+  }
+
+  for (std::size_t i = 0; i < level.texture_defs.size(); i++) {
+    const WAD::TextureDef &texDef = level.texture_defs[i];
+    LumpName               name(texDef.name);
+    if (textures_.count(name) ||
+        !std::binary_search(used.begin(), used.end(), name)) {
+      continue;
+    }
+
+    Texture texture;
+    if (WADConverter::compositeTexture(texDef, level.patches, level.palette,
+                                       texture.rgba)) {
+      texture.width  = texDef.width;
+      texture.height = texDef.height;
+      textures_.insert(std::make_pair(name, std::move(texture)));
+    }
+  }
+}
+
+/**
+ * @brief Reset the buffers and the counts for a new frame
+ */
+void SoftwareRenderer::clear() {
+  std::fill(depth_.begin(), depth_.end(), 0.0f);
+  std::fill(color_.begin(), color_.end(), 0);
+  for (std::size_t i = 3; i < color_.size(); i += 4) {
+    color_[i] = 255;
+  }
+  stats_ = DepthStats();
+}
+
+/**
+ * @brief Rasterize a group into the depth buffer
+ * @param group The group, its triangles are drawn in index order
+ */
+void SoftwareRenderer::drawDepth(const LevelMesh::Group &group) {
+  view_.resize(group.vertices.size());
+  for (std::size_t v = 0; v < group.vertices.size(); v++) {
+    view_[v] = toView(group.vertices[v]);
+  }
+
+  triangles_.clear();
+  for (std::size_t i = 0; i + 2 < group.indices.size(); i += 3) {
+    setupTriangle(view_[group.indices[i]], view_[group.indices[i + 1]],
+                  view_[group.indices[i + 2]], nullptr, false);
+  }
+  for (std::size_t t = 0; t < triangles_.size(); t++) {
+    rasterize(triangles_[t], 0, height_, &stats_);
+  }
+}
+
+/**
+ * @brief Draw a whole mesh into the color buffer
+ * @param mesh The mesh, built with the world scale the camera uses
+ * @param order Indices into mesh.groups to draw, or nullptr for all of them
+ * @param pool Threads for the stripes, nullptr to draw on the caller's
+ * @note Textures must have been loaded with loadTextures(), groups without
+ * one are drawn in gray.
+ */
+void SoftwareRenderer::render(const LevelMesh             &mesh,
+                              const std::vector<uint32_t> *order,
+                              ThreadPool                  *pool) {
+  clear();
+  triangles_.clear();
+
+  std::size_t groupCount = order ? order->size() : mesh.groups.size();
+  for (std::size_t i = 0; i < groupCount; i++) {
+    const LevelMesh::Group &group   = mesh.groups[order ? (*order)[i] : i];
+    const Texture          *texture = findTexture(group.texture);
+
+    view_.resize(group.vertices.size());
+    for (std::size_t v = 0; v < group.vertices.size(); v++) {
+      view_[v] = toView(group.vertices[v]);
+    }
+    for (std::size_t j = 0; j + 2 < group.indices.size(); j += 3) {
+      setupTriangle(view_[group.indices[j]], view_[group.indices[j + 1]],
+                    view_[group.indices[j + 2]], texture, false);
+    }
+  }
+
+  // The alpha test keeps the depth buffer right, so masked surfaces need no
+  // sorting here
+  const unsigned int *quad = LevelMesh::MaskedSurface::INDICES;
+  for (std::size_t m = 0; m < mesh.masked.size(); m++) {
+    const LevelMesh::MaskedSurface &surface = mesh.masked[m];
+    const Texture                  *texture = findTexture(surface.texture);
+
+    ViewVertex corners[4];
+    for (int v = 0; v < 4; v++) {
+      corners[v] = toView(surface.vertices[v]);
+    }
+    for (int j = 0; j < 6; j += 3) {
+      setupTriangle(corners[quad[j]], corners[quad[j + 1]],
+                    corners[quad[j + 2]], texture, true);
+    }
+  }
+
+  // Bin the triangles by the stripes their bounds touch
+  for (std::size_t s = 0; s < stripes_.size(); s++) {
+    stripes_[s].clear();
+  }
+  for (std::size_t t = 0; t < triangles_.size(); t++) {
+    int first = triangles_[t].minY / STRIPE_HEIGHT;
+    int last  = triangles_[t].maxY / STRIPE_HEIGHT;
+    for (int s = first; s <= last; s++) {
+      stripes_[s].push_back(static_cast<uint32_t>(t));
+    }
+  }
+
+  std::function<void(std::size_t)> drawStripe = [this](std::size_t s) {
+    const std::vector<uint32_t> &list = stripes_[s];
+
+    int rowBegin = static_cast<int>(s) * STRIPE_HEIGHT;
+    int rowEnd   = std::min(height_, rowBegin + STRIPE_HEIGHT);
+    for (std::size_t i = 0; i < list.size(); i++) {
+      rasterize(triangles_[list[i]], rowBegin, rowEnd, nullptr);
+    }
+  };
+
+  if (pool) {
+    pool->parallelFor(stripes_.size(), drawStripe);
+  } else {
+    for (std::size_t s = 0; s < stripes_.size(); s++) {
+      drawStripe(s);
+    }
+  }
+}
+
+/**
+ * @brief Get the counts of the frame
+ * @return Fragments and shaded fragments so far, and the covered pixels
+ */
+SoftwareRenderer::DepthStats SoftwareRenderer::stats() const {
+  DepthStats stats = stats_;
+  stats.coveredPixels =
+      depth_.size() - std::count(depth_.begin(), depth_.end(), 0.0f);
+  return stats;
+}
+
+/**
+ * @brief Save the color buffer as a PNG file
+ * @param path Path of the file to write
+ * @throws std::runtime_error if the file cannot be written
+ */
+void SoftwareRenderer::writePNG(const std::string &path) const {
+  PNGFile::write(path, width_, height_, color_.data());
+}
+
+/**
+ * @brief Find a loaded texture
+ * @param name Texture or flat name
+ * @return The texture, nullptr if it was not loaded
+ */
+const SoftwareRenderer::Texture *
+SoftwareRenderer::findTexture(LumpName name) const {
+  std::map<LumpName, Texture>::const_iterator found = textures_.find(name);
+  return found != textures_.end() ? &found->second : nullptr;
+}
+
+/**
+ * @brief Move a vertex into camera space
+ * @param vertex World space vertex
+ * @return The vertex relative to the eye, along the camera axes
+ */
+SoftwareRenderer::ViewVertex
+SoftwareRenderer::toView(const LevelMesh::Vertex &vertex) const {
+  float dx = vertex.pos[0] - eye_[0];
+  float dy = vertex.pos[1] - eye_[1];
+  float dz = vertex.pos[2] - eye_[2];
+
+  ViewVertex out;
+  out.x = dx * right_[0] + dy * right_[1] + dz * right_[2];
+  out.y = dx * up_[0] + dy * up_[1] + dz * up_[2];
+  out.z = dx * forward_[0] + dy * forward_[1] + dz * forward_[2];
+  out.u = vertex.uv[0];
+  out.v = vertex.uv[1];
+  return out;
+}
+
+/**
+ * @brief Clip a triangle against the near plane and queue what is left
+ * @param a First vertex in camera space
+ * @param b Second vertex
+ * @param c Third vertex
+ * @param texture Texture to shade with, nullptr for depth only
+ * @param masked true to skip transparent texels
+ */
+void SoftwareRenderer::setupTriangle(const ViewVertex &a, const ViewVertex &b,
+                                     const ViewVertex &c,
+                                     const Texture *texture, bool masked) {
+  const ViewVertex *in[3] = {&a, &b, &c};
+
+  // A triangle clipped by one plane has at most 4 vertices
+  ViewVertex clipped[4];
+  int        count = 0;
+  for (int i = 0; i < 3; i++) {
+    const ViewVertex &current = *in[i];
+    const ViewVertex &next    = *in[(i + 1) % 3];
+    bool              inside  = current.z >= NEAR_PLANE;
+
+    if (inside) {
+      clipped[count++] = current;
+    }
+    if (inside != (next.z >= NEAR_PLANE)) {
+      float       t   = (NEAR_PLANE - current.z) / (next.z - current.z);
+      ViewVertex &cut = clipped[count++];
+      cut.x           = current.x + (next.x - current.x) * t;
+      cut.y           = current.y + (next.y - current.y) * t;
+      cut.z           = NEAR_PLANE;
+      cut.u           = current.u + (next.u - current.u) * t;
+      cut.v           = current.v + (next.v - current.v) * t;
+    }
+  }
+  if (count < 3) {
+    return;
+  }
+
+  ScreenVertex screen[4];
+  for (int i = 0; i < count; i++) {
+    float invZ       = 1.0f / clipped[i].z;
+    screen[i].x      = width_ / 2.0f + clipped[i].x * focal_ * invZ;
+    screen[i].y      = height_ / 2.0f - clipped[i].y * focal_ * invZ;
+    screen[i].invZ   = invZ;
+    screen[i].uOverZ = clipped[i].u * invZ;
+    screen[i].vOverZ = clipped[i].v * invZ;
+  }
+
+  addTriangle(screen[0], screen[1], screen[2], texture, masked);
+  if (count == 4) {
+    addTriangle(screen[0], screen[2], screen[3], texture, masked);
+  }
+}
+
+/**
+ * @brief Queue a projected triangle if it covers part of the screen and, when
+ * culling, faces the camera
+ * @param a First vertex on screen
+ * @param b Second vertex
+ * @param c Third vertex
+ * @param texture Texture to shade with, nullptr for depth only
+ * @param masked true to skip transparent texels
+ */
+void SoftwareRenderer::addTriangle(ScreenVertex a, ScreenVertex b,
+                                   ScreenVertex c, const Texture *texture,
+                                   bool masked) {
+  // Counterclockwise in the world is clockwise on screen, with y down
+  float area = edge(a.x, a.y, b.x, b.y, c.x, c.y);
+  if (area == 0.0f || (cullBackFaces_ && area > 0.0f)) {
+    return;
+  }
+  if (area < 0.0f) {
+    std::swap(b, c);
+    area = -area;
+  }
+
+  ScreenTriangle triangle;
+  triangle.minX = std::max(
+      0, static_cast<int>(std::floor(std::min(a.x, std::min(b.x, c.x)))));
+  triangle.maxX =
+      std::min(width_ - 1, static_cast<int>(std::ceil(
+                               std::max(a.x, std::max(b.x, c.x)))));
+  triangle.minY = std::max(
+      0, static_cast<int>(std::floor(std::min(a.y, std::min(b.y, c.y)))));
+  triangle.maxY =
+      std::min(height_ - 1, static_cast<int>(std::ceil(
+                                std::max(a.y, std::max(b.y, c.y)))));
+  if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+    return;
+  }
+
+  triangle.v[0]    = a;
+  triangle.v[1]    = b;
+  triangle.v[2]    = c;
+  triangle.invArea = 1.0f / area;
+  triangle.texture = texture;
+  triangle.masked  = masked;
+  triangles_.push_back(triangle);
+}
+
+/**
+ * @brief Depth test and shade the pixels whose center is in a triangle
+ * @param triangle The triangle, with a positive area
+ * @param rowBegin First row to draw
+ * @param rowEnd Row after the last one to draw
+ * @param stats Counts to update for a depth only pass, nullptr to shade
+ */
+void SoftwareRenderer::rasterize(const ScreenTriangle &triangle, int rowBegin,
+                                 int rowEnd, DepthStats *stats) {
+  const ScreenVertex &a = triangle.v[0];
+  const ScreenVertex &b = triangle.v[1];
+  const ScreenVertex &c = triangle.v[2];
+
+  int minY = std::max(rowBegin, triangle.minY);
+  int maxY = std::min(rowEnd - 1, triangle.maxY);
+
+  // Edges opposite to a, b and c, with their fill rule bias
+  const bool topLeft0 = isTopLeft(b.x, b.y, c.x, c.y);
+  const bool topLeft1 = isTopLeft(c.x, c.y, a.x, a.y);
+  const bool topLeft2 = isTopLeft(a.x, a.y, b.x, b.y);
+
+  const Texture *texture = triangle.texture;
+
+  for (int y = minY; y <= maxY; y++) {
+    float py = y + 0.5f;
+    for (int x = triangle.minX; x <= triangle.maxX; x++) {
+      float px = x + 0.5f;
+      float w0 = edge(b.x, b.y, c.x, c.y, px, py);
+      float w1 = edge(c.x, c.y, a.x, a.y, px, py);
+      float w2 = edge(a.x, a.y, b.x, b.y, px, py);
+      if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f ||
+          (w0 == 0.0f && !topLeft0) || (w1 == 0.0f && !topLeft1) ||
+          (w2 == 0.0f && !topLeft2)) {
+        continue;
+      }
+
+      w0 *= triangle.invArea;
+      w1 *= triangle.invArea;
+      w2 *= triangle.invArea;
+
+      std::size_t pixel = static_cast<std::size_t>(y) * width_ + x;
+      float       invZ  = w0 * a.invZ + w1 * b.invZ + w2 * c.invZ;
+      if (stats) {
+        stats->fragments++;
+        if (invZ > depth_[pixel]) {
+          depth_[pixel] = invZ;
+          stats->shaded++;
+        }
+        continue;
+      }
+      if (invZ <= depth_[pixel]) {
+        continue;
+      }
+
+      unsigned char *out = &color_[pixel * 4];
+      if (texture) {
+        float z = 1.0f / invZ;
+        float u = (w0 * a.uOverZ + w1 * b.uOverZ + w2 * c.uOverZ) * z;
+        float v = (w0 * a.vOverZ + w1 * b.vOverZ + w2 * c.vOverZ) * z;
+
+        const unsigned char *texel =
+            &texture->rgba[(static_cast<std::size_t>(
+                                wrap(v, texture->height)) *
+                                texture->width +
+                            wrap(u, texture->width)) *
+                           4];
+        if (triangle.masked && texel[3] == 0) {
+          continue;
+        }
+        out[0] = texel[0];
+        out[1] = texel[1];
+        out[2] = texel[2];
+      } else {
+        out[0] = 128;  // No texture loaded
+        out[1] = 128;
+        out[2] = 128;
+      }
+      depth_[pixel] = invZ;
+    }
+  }
+}
@@ -0,0 +1,168 @@
+#ifndef WAD_VIEWER_SOFTWARE_RENDERER_HPP
+#define WAD_VIEWER_SOFTWARE_RENDERER_HPP
+
+#include "./level-mesh.hpp"
+#include "./lump-name.hpp"
+#include "./thread-pool.hpp"
+#include "./wad.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Headless rasterizer for level meshes, for screenshots on machines
+ * without a GPU and for measuring what a frame costs.
+ *
+ * Triangles are clipped against the near plane and rasterized with edge
+ * functions and the top-left rule, so shared edges are covered once. Depth
+ * is 1 / z, which is linear in screen space, nearer is larger, and texture
+ * coordinates are interpolated with perspective correction and sampled
+ * nearest with repeat, as the engine does. Back faces are drawn too unless
+ * setCullBackFaces() is on, the mesh winds every triangle counterclockwise
+ * seen from the side it belongs to.
+ *
+ * render() sets up every triangle once, bins them by horizontal stripe of
+ * STRIPE_HEIGHT rows and rasterizes the stripes on a thread pool. A stripe
+ * draws its triangles in submission order and owns its pixels, so the image
+ * is the same whatever the number of threads.
+ */
+class SoftwareRenderer {
+public:
+  // Closer than this to the eye, in world units, is clipped
+  static constexpr float NEAR_PLANE = 1.0f;
+
+  // Rows of a stripe, the unit of work of render()
+  static const int STRIPE_HEIGHT = 16;
+
+  // A viewpoint in world coordinates (see LevelMesh)
+  struct Camera {
+    float position[3] = {0.0f, 0.0f, 0.0f};
+    float yaw         = 0.0f;  // Map angle in radians, 0 east, counterclockwise
+    float pitch       = 0.0f;  // Radians, positive looks up
+    float fovX        = 1.5707963f;  // Horizontal field of view in radians
+  };
+
+  // Counts since the last clear()
+  struct DepthStats {
+    std::size_t coveredPixels = 0;  // Pixels with some geometry
+    std::size_t fragments     = 0;  // Pixels rasterized, hidden or not
+    std::size_t shaded        = 0;  // Fragments that passed the depth test
+
+    // Shaded fragments per covered pixel, 1 is no overdraw at all
+    double overdraw() const {
+      return coveredPixels ? static_cast<double>(shaded) / coveredPixels
+                           : 0.0;
+    }
+  };
+
+  // RGBA pixels, rows from v = 0 down as they are uploaded to the engine
+  struct Texture {
+    int                        width  = 0;
+    int                        height = 0;
+    std::vector<unsigned char> rgba;
+  };
+
+  SoftwareRenderer(int width, int height);
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+  void setCamera(const Camera &camera);
+
+  // Skip the triangles seen from behind, off by default
+  void setCullBackFaces(bool cull) { cullBackFaces_ = cull; }
+
+  // Half the angle, around the view direction on the map, of the cone that
+  // holds what a camera sees in a width x height image, for
+  // DrawOrder::frontToBack(). Wider than fovX / 2 for a pitched camera
+  static float mapHalfFov(const Camera &camera, int width, int height);
+
+  // Composite the textures and flats a mesh uses, without the engine
+  void loadTextures(const WAD::Level &level, const LevelMesh &mesh);
+
+  // Reset the color and depth buffers and the counts
+  void clear();
+
+  // Depth test and write every triangle of a group, without shading
+  void drawDepth(const LevelMesh::Group &group);
+
+  // Clear and draw a mesh: the groups in the given order (every group in
+  // mesh order if there is none), then the masked surfaces with alpha test
+  void render(const LevelMesh &mesh, const std::vector<uint32_t> *order,
+              ThreadPool *pool = nullptr);
+
+  // Counts of the frame drawn so far with drawDepth()
+  DepthStats stats() const;
+
+  const std::vector<float>         &depth() const { return depth_; }
+  const std::vector<unsigned char> &color() const { return color_; }
+
+  // Save the color buffer as an RGBA PNG file
+  void writePNG(const std::string &path) const;
+
+private:
+  // Vertex in camera space: x right, y up, z forward
+  struct ViewVertex {
+    float x;
+    float y;
+    float z;
+    float u;
+    float v;
+  };
+
+  // Vertex on screen, attributes divided by the depth
+  struct ScreenVertex {
+    float x;
+    float y;
+    float invZ;
+    float uOverZ;
+    float vOverZ;
+  };
+
+  // Triangle ready to rasterize, with a positive area
+  struct ScreenTriangle {
+    ScreenVertex   v[3];
+    float          invArea;
+    int            minX;
+    int            maxX;
+    int            minY;
+    int            maxY;
+    const Texture *texture;  // nullptr for depth only
+    bool           masked;   // Alpha tested
+  };
+
+  int                        width_;
+  int                        height_;
+  std::vector<float>         depth_;
+  std::vector<unsigned char> color_;
+  DepthStats                 stats_;
+  bool                       cullBackFaces_ = false;
+
+  std::map<LumpName, Texture> textures_;
+
+  // Camera basis and projection
+  float eye_[3];
+  float right_[3];
+  float up_[3];
+  float forward_[3];
+  float focal_;  // Pixels per unit at depth 1
+
+  // Buffers reused by every draw
+  std::vector<ViewVertex>             view_;
+  std::vector<ScreenTriangle>         triangles_;
+  std::vector<std::vector<uint32_t>> stripes_;  // Triangles of each stripe
+
+  const Texture *findTexture(LumpName name) const;
+  ViewVertex     toView(const LevelMesh::Vertex &vertex) const;
+  void           setupTriangle(const ViewVertex &a, const ViewVertex &b,
+                               const ViewVertex &c, const Texture *texture,
+                               bool masked);
+  void           addTriangle(ScreenVertex a, ScreenVertex b, ScreenVertex c,
+                             const Texture *texture, bool masked);
+  void           rasterize(const ScreenTriangle &triangle, int rowBegin,
+                           int rowEnd, DepthStats *stats);
+};
+
+#endif  // WAD_VIEWER_SOFTWARE_RENDERER_HPP
@@ -0,0 +1,130 @@
+#include "thread-pool.hpp"
+#include <exception>
+
+/**
+ * @brief Start the worker threads
+ * @param threadCount Number of workers, 0 for one per hardware thread
+ */
+ThreadPool::ThreadPool(std::size_t threadCount) : stopping_(false) {
+  if (threadCount == 0) {
+    threadCount = std::thread::hardware_concurrency();
+  }
+  if (threadCount == 0) {
+    threadCount = 1;  // hardware_concurrency() may not know
+  }
+
+  workers_.reserve(threadCount);
+  for (std::size_t i = 0; i < threadCount; i++) {
+    workers_.push_back(std::thread(&ThreadPool::workerLoop, this));
+  }
+}
+
+/**
+ * @brief Run the remaining tasks and join the worker threads
+ */
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wakeUp_.notify_all();
+
+  for (std::size_t i = 0; i < workers_.size(); i++) {
+    workers_[i].join();
+  }
+}
+
+/**
+ * @brief Take tasks from the queue, or indices of the running loop, until
+ * the pool is stopped and empty
+ */
+void ThreadPool::workerLoop() {
+  uint64_t loopSeen = 0;
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wakeUp_.wait(lock, [this, loopSeen]() {
+        return stopping_ || !tasks_.empty() ||
+               (loop_.task && loop_.generation != loopSeen);
+      });
+      if (loop_.task && loop_.generation != loopSeen) {
+        loopSeen = loop_.generation;
+        loop_.workers++;
+        lock.unlock();
+        runLoop();
+
+        lock.lock();
+        loop_.workers--;
+        if (loop_.workers == 0) {
+          loopDone_.notify_one();
+        }
+        continue;
+      }
+      if (tasks_.empty()) {
+        return;  // Stopping and nothing left to do
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
+
+/**
+ * @brief Run indices of the current loop until none is left
+ */
+void ThreadPool::runLoop() {
+  while (true) {
+    std::size_t i = loop_.next.fetch_add(1);
+    if (i >= loop_.count) {
+      return;
+    }
+    try {
+      (*loop_.task)(i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!loop_.error) {
+        loop_.error = std::current_exception();
+      }
+    }
+  }
+}
+
+/**
+ * @brief Run a task for every index on the workers and wait for all of them
+ * @param count Number of indices
+ * @param task Task called with each index in [0, count)
+ * @throws The first exception thrown by a task, once every task is done
+ * @note Loops from several threads run one after the other.
+ */
+void ThreadPool::parallelFor(std::size_t                             count,
+                             const std::function<void(std::size_t)> &task) {
+  if (count == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> loopLock(loopMutex_);
+  std::exception_ptr          error;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    loop_.task  = &task;
+    loop_.count = count;
+    loop_.next  = 0;
+    loop_.generation++;
+    wakeUp_.notify_all();
+
+    // Every index is taken once the counter passes count, and the workers
+    // that took them have left the loop once none is in it. The task is the
+    // caller's, so wait for them before returning or rethrowing
+    loopDone_.wait(lock, [this]() {
+      return loop_.next >= loop_.count && loop_.workers == 0;
+    });
+    loop_.task  = nullptr;
+    error       = loop_.error;
+    loop_.error = nullptr;
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
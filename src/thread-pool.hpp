@@ -0,0 +1,84 @@
+#ifndef WAD_VIEWER_THREAD_POOL_HPP
+#define WAD_VIEWER_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Fixed set of worker threads running queued tasks.
+ *
+ * Tasks are run in submission order by whichever worker is free. Exceptions
+ * thrown by a task are stored in its future and rethrown by get(). The
+ * destructor finishes every queued task before joining the workers.
+ *
+ * parallelFor() does not queue tasks: the workers take the indices of the
+ * running loop from a shared counter, so a loop does not allocate and can
+ * run in the frames of the software renderer.
+ */
+class ThreadPool {
+public:
+  // 0 threads means one per hardware thread
+  explicit ThreadPool(std::size_t threadCount = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &)            = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  std::size_t size() const { return workers_.size(); }
+
+  // Queue a task, the future holds its result
+  template <typename F, typename Result = decltype(std::declval<F &>()())>
+  std::future<Result> submit(F task) {
+    // packaged_task is move-only and std::function needs a copyable target
+    std::shared_ptr<std::packaged_task<Result()>> packaged =
+        std::make_shared<std::packaged_task<Result()>>(std::move(task));
+    std::future<Result> result = packaged->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push([packaged]() { (*packaged)(); });
+    }
+    wakeUp_.notify_one();
+    return result;
+  }
+
+  // Run task(i) for every i in [0, count) on the workers and wait for all of
+  // them. Must not be called from a task running on this pool.
+  void parallelFor(std::size_t                             count,
+                   const std::function<void(std::size_t)> &task);
+
+private:
+  // The running parallelFor(), one at a time
+  struct Loop {
+    const std::function<void(std::size_t)> *task  = nullptr;
+    std::size_t                             count = 0;
+    std::atomic<std::size_t>                next{0};  // Next index to run
+    std::size_t                             workers    = 0;  // In the loop
+    uint64_t                                generation = 0;
+    std::exception_ptr                      error;  // First one thrown
+  };
+
+  std::vector<std::thread>          workers_;
+  std::queue<std::function<void()>> tasks_;
+  std::mutex                        mutex_;
+  std::condition_variable           wakeUp_;
+  bool                              stopping_;
+  Loop                              loop_;
+  std::mutex                        loopMutex_;  // Held by parallelFor()
+  std::condition_variable           loopDone_;
+
+  void workerLoop();
+  void runLoop();
+};
+
+#endif  // WAD_VIEWER_THREAD_POOL_HPP
@@ -0,0 +1,169 @@
+#include "trace.hpp"
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+struct Event {
+  const char *name;
+  LumpName    detail;
+  int64_t     begin;     // Microseconds since the trace started
+  int64_t     duration;  // Microseconds
+};
+
+// Events of one thread, only that thread appends to it while recording
+struct ThreadBuffer {
+  uint32_t           id;
+  std::vector<Event> events;
+};
+
+std::atomic<bool>                          recordingZones(false);
+std::chrono::steady_clock::time_point      traceStart;
+std::mutex                                 buffersMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+/**
+ * @brief Get the buffer of the calling thread, registering it on first use
+ * @return The buffer, valid until the program exits
+ */
+ThreadBuffer &threadBuffer() {
+  thread_local ThreadBuffer *buffer = nullptr;
+  if (!buffer) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+    buffer     = buffers.back().get();
+    buffer->id = static_cast<uint32_t>(buffers.size());
+  }
+  return *buffer;
+}
+
+// JSON string contents, zone names are literals but lump names come from
+// the WAD
+std::string escape(const std::string &text) {
+  std::string out;
+  for (std::size_t i = 0; i < text.size(); i++) {
+    unsigned char c = static_cast<unsigned char>(text[i]);
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += static_cast<char>(c);
+    } else if (c >= 0x20 && c < 0x7F) {
+      out += static_cast<char>(c);
+    }
+  }
+  return out;
+}
+
+}  // namespace
+
+/**
+ * @brief Start recording zones
+ * @note Call it before starting worker threads that record zones, buffers
+ * are cleared without waiting for them.
+ */
+void Trace::start() {
+  {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (std::size_t i = 0; i < buffers.size(); i++) {
+      buffers[i]->events.clear();
+    }
+  }
+  traceStart = std::chrono::steady_clock::now();
+  recordingZones.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief Stop recording and save the zones in the Chrome trace-event format
+ * @param path Path of the JSON file to write
+ * @throws std::runtime_error if the file cannot be written
+ * @note Call it while no other thread closes zones, the pool idle. Zones
+ * still open when this is called are lost.
+ */
+void Trace::write(const std::string &path) {
+  recordingZones.store(false, std::memory_order_release);
+
+  std::ofstream file(path.c_str());
+  if (!file) {
+    throw std::runtime_error("Could not write trace file: " + path);
+  }
+
+  std::lock_guard<std::mutex> lock(buffersMutex);
+  file << "{\"traceEvents\":[";
+  bool first = true;
+  for (std::size_t b = 0; b < buffers.size(); b++) {
+    const ThreadBuffer &buffer = *buffers[b];
+    for (std::size_t e = 0; e < buffer.events.size(); e++) {
+      const Event &event = buffer.events[e];
+      file << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name
+           << "\",\"cat\":\"wadviewer\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+           << buffer.id << ",\"ts\":" << event.begin
+           << ",\"dur\":" << event.duration;
+      if (!event.detail.empty()) {
+        file << ",\"args\":{\"lump\":\"" << escape(event.detail.str())
+             << "\"}";
+      }
+      file << "}";
+      first = false;
+    }
+  }
+  file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+  if (!file) {
+    throw std::runtime_error("Could not write trace file: " + path);
+  }
+}
+
+/**
+ * @brief Check whether zones are being recorded
+ * @return true between start() and write()
+ */
+bool Trace::recording() {
+  return recordingZones.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Add a finished zone to the buffer of the calling thread
+ * @param name Zone name, a string literal
+ * @param detail Lump the zone worked on, empty if none
+ * @param begin When the zone started
+ * @param end When the zone finished
+ */
+void Trace::record(const char *name, LumpName detail,
+                   std::chrono::steady_clock::time_point begin,
+                   std::chrono::steady_clock::time_point end) {
+  typedef std::chrono::microseconds Microseconds;
+
+  Event event;
+  event.name     = name;
+  event.detail   = detail;
+  event.begin =
+      std::chrono::duration_cast<Microseconds>(begin - traceStart).count();
+  event.duration =
+      std::chrono::duration_cast<Microseconds>(end - begin).count();
+  threadBuffer().events.push_back(event);
+}
+
+/**
+ * @brief Open a zone
+ * @param name Zone name, a string literal
+ * @param detail Lump the zone works on, shown as an argument in the trace
+ */
+Trace::Zone::Zone(const char *name, LumpName detail)
+    : name_(name), detail_(detail), active_(Trace::recording()) {
+  if (active_) {
+    begin_ = std::chrono::steady_clock::now();
+  }
+}
+
+/**
+ * @brief Close the zone and record it if a trace was being recorded when it
+ * was opened
+ */
+Trace::Zone::~Zone() {
+  if (active_ && Trace::recording()) {
+    Trace::record(name_, detail_, begin_, std::chrono::steady_clock::now());
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef WAD_VIEWER_TRACE_HPP
+#define WAD_VIEWER_TRACE_HPP
+
+#include "./lump-name.hpp"
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Scoped timing zones written as a Chrome trace-event JSON file, to
+ * open in chrome://tracing or Perfetto.
+ *
+ * Zones are placed with TRACE_ZONE("name") or TRACE_ZONE_LUMP("name", lump)
+ * and only exist in builds with WAD_VIEWER_TRACING defined (make TRACE=1);
+ * otherwise the macros expand to nothing. In a tracing build a zone costs an
+ * atomic load while no trace is recorded. Zone names must be string
+ * literals, they are stored as pointers. Each thread appends to its own
+ * buffer, so recording from pool workers takes no lock.
+ */
+class Trace {
+public:
+  // Start recording zones, dropping the ones recorded before
+  static void start();
+
+  // Stop recording and write the zones recorded so far
+  static void write(const std::string &path);
+
+  static bool recording();
+
+  // Complete event ("ph": "X") timed from construction to destruction
+  class Zone {
+  public:
+    explicit Zone(const char *name, LumpName detail = LumpName());
+    ~Zone();
+
+    Zone(const Zone &)            = delete;
+    Zone &operator=(const Zone &) = delete;
+
+  private:
+    const char                           *name_;
+    LumpName                              detail_;
+    std::chrono::steady_clock::time_point begin_;
+    bool                                  active_;
+  };
+
+private:
+  static void record(const char *name, LumpName detail,
+                     std::chrono::steady_clock::time_point begin,
+                     std::chrono::steady_clock::time_point end);
+};
+
+#ifdef WAD_VIEWER_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) Trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_ZONE_LUMP(name, lump)                                            \
+  Trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name, lump)
+#else
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_ZONE_LUMP(name, lump) ((void)0)
+#endif
+
+#endif  // WAD_VIEWER_TRACE_HPP
@@ -0,0 +1,54 @@
+#include "viewer-controls.hpp"
+#include "./log.hpp"
+#include <cmath>
+
+/**
+ * @brief Set the camera speed from the keys held, the engine moves the
+ * camera with it in OkObject::step.
+ * @param camera The camera to move.
+ * @param state The input state of the frame.
+ */
+void ViewerControls::step(OkCamera &camera, const OkInputState &state) {
+  OkPoint forward = camera.getRotation().getForwardVector();
+  OkPoint right   = camera.getRotation().getRightVector();
+  OkPoint direction(0.0f, 0.0f, 0.0f);
+
+  // Calculate movement direction based on input
+  if (state.forward) {
+    direction = direction + forward;
+  }
+  if (state.backward) {
+    direction = direction - forward;
+  }
+  if (state.strafeLeft) {
+    direction = direction - right;
+  }
+  if (state.strafeRight) {
+    direction = direction + right;
+  }
+
+  // Base movement speed (units per second)
+  const float baseSpeed = 50.0f;
+
+  // Apply movement speed if there's input
+  if (direction.x() != 0 || direction.y() != 0 || direction.z() != 0) {
+    float magnitude =
+        sqrt(direction.x() * direction.x() + direction.y() * direction.y() +
+             direction.z() * direction.z());
+
+    if (magnitude > 0.0001f) {  // Small epsilon to avoid floating point errors
+      direction = direction.normalize() * baseSpeed;
+    } else {
+      direction = OkPoint(0.0f, 0.0f, 0.0f);
+    }
+  }
+
+  // Set the camera's speed - this will be applied in OkObject::step
+  camera.setSpeed(direction.x(), direction.y(), direction.z());
+
+  // Log only once per second for debugging
+  if (frameCount_++ % 60 == 0) {  // Assuming 60 FPS, adjust if different
+    LOG_DEBUG("Camera pos: " << camera.getPosition().toString());
+  }
+}
+
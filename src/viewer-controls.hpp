@@ -0,0 +1,23 @@
+#ifndef WAD_VIEWER_VIEWER_CONTROLS_HPP
+#define WAD_VIEWER_VIEWER_CONTROLS_HPP
+
+#include "../okinawa.cpp/src/core/camera.hpp"
+#include "../okinawa.cpp/src/input/input.hpp"
+
+/**
+ * @brief The per-frame work of the viewer on the step phase of the engine
+ * loop: moving the camera from the input state.
+ *
+ * Kept out of the engine callback so the frames can be stepped without a
+ * window, for the frame allocation test.
+ */
+class ViewerControls {
+public:
+  // Set the camera speed for one frame of input
+  void step(OkCamera &camera, const OkInputState &state);
+
+private:
+  int frameCount_ = 0;
+};
+
+#endif  // WAD_VIEWER_VIEWER_CONTROLS_HPP
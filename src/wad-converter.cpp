@@ -1,51 +1,195 @@
 #include "wad-converter.hpp"
 #include "../okinawa.cpp/src/handlers/textures.hpp"
-#include "../okinawa.cpp/src/utils/logger.hpp"
-#include "../okinawa.cpp/src/utils/strings.hpp"
+#include "./log.hpp"
+#include "./trace.hpp"
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <future>
 #include <limits>
+#include <memory_resource>
 
 // Initialize static members
-float       WADConverter::centerX = 0.0f;
-float       WADConverter::centerY = 0.0f;
-const float WADConverter::SCALE   = 1.0f;
+const float WADConverter::SCALE = 1.0f;
 
 // Empty constructor/destructor
 WADConverter::WADConverter() {}
 WADConverter::~WADConverter() {}
 
-void WADConverter::createWallSection(const WAD::Vertex &vertex1,
-                                     const WAD::Vertex &vertex2,
-                                     float bottomHeight, float topHeight,
-                                     const WAD::Sidedef        &sidedef,
-                                     std::vector<float>        &vertices,
-                                     std::vector<unsigned int> &indices) {
-  // Calculate normalized positions
-  float x1 = (static_cast<float>(vertex1.x) - centerX) * SCALE;
-  float z1 = (static_cast<float>(vertex1.y) - centerY) * SCALE;
-  float x2 = (static_cast<float>(vertex2.x) - centerX) * SCALE;
-  float z2 = (static_cast<float>(vertex2.y) - centerY) * SCALE;
-
-  // Calculate wall dimensions
-  float wallBottom = bottomHeight * SCALE;
-  float wallTop    = topHeight * SCALE;
-  float wallHeight = wallTop - wallBottom;
+/**
+ * @brief Records a wall quad for the fill pass and adds it to the size of its
+ * texture group. Walls without texture or height are skipped.
+ * @param context The conversion the wall belongs to
+ * @param texture Texture id of the wall
+ * @param vertex1 Start vertex of the wall
+ * @param vertex2 End vertex of the wall
+ * @param bottomHeight Bottom of the wall
+ * @param topHeight Top of the wall
+ * @param sidedef Sidedef holding the texture offsets
+ * @param chunk Linedef chunk the wall belongs to
+ */
+void WADConverter::addWallSection(const Context &context, uint16_t texture,
+                                  uint16_t vertex1, uint16_t vertex2,
+                                  float bottomHeight, float topHeight,
+                                  uint16_t sidedef, Chunk &chunk) {
+  if (texture == CompiledLevel::NO_TEXTURE) {
+    return;
+  }
 
+  float wallHeight = topHeight * SCALE - bottomHeight * SCALE;
   if (wallHeight <= 0.0f) {
     return;
   }
 
+  uint32_t group =
+      context.groups.slot(texture, context.level.side_sector[sidedef]);
+  WallQuad quad = {texture, vertex1,   vertex2, sidedef,
+                   bottomHeight, topHeight, group};
+  chunk.quads.push_back(quad);
+  chunk.sizes[group].vertexCount += 4;
+  chunk.sizes[group].indexCount += 6;
+}
+
+/**
+ * @brief Finds the group of a texture, in a sector when groups are split.
+ * @param textureId Texture id
+ * @param sectorIndex Sector the surface faces
+ * @return The slot, 0 (NO_TEXTURE) if the pair is not in the table
+ */
+uint32_t WADConverter::GroupTable::slot(uint16_t textureId,
+                                        uint16_t sectorIndex) const {
+  if (sectorFirst.empty()) {
+    return textureId;
+  }
+  if (sectorIndex + 1u >= sectorFirst.size()) {
+    return 0;
+  }
+
+  // A sector uses a handful of textures
+  for (uint32_t i = sectorFirst[sectorIndex]; i < sectorFirst[sectorIndex + 1];
+       i++) {
+    if (texture[bySector[i]] == textureId) {
+      return bySector[i];
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Lists the output groups of a conversion.
+ * @param level The compiled level
+ * @param sectorGroups true for one group per texture and sector pair
+ * @param scratch Arena of the conversion, the table lives in it
+ * @return The group table, slots in texture name order then sector order
+ * @note With sectorGroups, every pair a sidedef or sector refers to gets a
+ * slot. Pairs nothing ends up in give empty groups, which are dropped.
+ */
+WADConverter::GroupTable
+WADConverter::buildGroupTable(const CompiledLevel        &level,
+                              bool                        sectorGroups,
+                              std::pmr::memory_resource *scratch) {
+  GroupTable table(scratch);
+
+  if (!sectorGroups) {
+    table.texture.resize(level.textureCount());
+    table.sector.assign(level.textureCount(), LevelMesh::NO_SECTOR);
+    for (size_t t = 0; t < level.textureCount(); t++) {
+      table.texture[t] = static_cast<uint16_t>(t);
+    }
+    return table;
+  }
+
+  // Texture id in the high half, so sorting gives the slot order
+  std::pmr::vector<uint32_t> pairs(scratch);
+  pairs.reserve(level.sidedefCount() * 3 + level.sectorCount() * 2);
+  for (size_t i = 0; i < level.sidedefCount(); i++) {
+    uint32_t sector = level.side_sector[i];
+    pairs.push_back(static_cast<uint32_t>(level.side_upper[i]) << 16 | sector);
+    pairs.push_back(static_cast<uint32_t>(level.side_lower[i]) << 16 | sector);
+    pairs.push_back(static_cast<uint32_t>(level.side_middle[i]) << 16 | sector);
+  }
+  for (size_t i = 0; i < level.sectorCount(); i++) {
+    uint32_t sector = static_cast<uint32_t>(i);
+    pairs.push_back(static_cast<uint32_t>(level.sector_floor_texture[i]) << 16 |
+                    sector);
+    pairs.push_back(static_cast<uint32_t>(level.sector_ceiling_texture[i])
+                        << 16 |
+                    sector);
+  }
+  std::sort(pairs.begin(), pairs.end());
+  pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+  table.texture.push_back(CompiledLevel::NO_TEXTURE);
+  table.sector.push_back(LevelMesh::NO_SECTOR);
+  for (size_t p = 0; p < pairs.size(); p++) {
+    uint16_t texture = static_cast<uint16_t>(pairs[p] >> 16);
+    uint16_t sector  = static_cast<uint16_t>(pairs[p] & 0xFFFF);
+    if (texture != CompiledLevel::NO_TEXTURE &&
+        sector < level.sectorCount()) {
+      table.texture.push_back(texture);
+      table.sector.push_back(sector);
+    }
+  }
+
+  // Slots of each sector, a counting sort keeps them in texture order
+  table.sectorFirst.assign(level.sectorCount() + 1, 0);
+  for (size_t s = 1; s < table.size(); s++) {
+    table.sectorFirst[table.sector[s] + 1]++;
+  }
+  for (size_t i = 0; i < level.sectorCount(); i++) {
+    table.sectorFirst[i + 1] += table.sectorFirst[i];
+  }
+  table.bySector.resize(table.size() - 1);
+  std::pmr::vector<uint32_t> fill(table.sectorFirst.begin(),
+                                  table.sectorFirst.end() - 1, scratch);
+  for (size_t s = 1; s < table.size(); s++) {
+    table.bySector[fill[table.sector[s]]++] = static_cast<uint32_t>(s);
+  }
+
+  return table;
+}
+
+/**
+ * @brief Writes the 4 vertices and 6 indices of a wall quad.
+ * @param context The conversion the quad belongs to
+ * @param quad The wall quad
+ * @param vertices Where the 4 vertices are written
+ * @param indices Where the 6 indices are written
+ * @param baseIndex Index of the first written vertex in its group
+ */
+void WADConverter::createWallSection(const Context &context,
+                                     const WallQuad &quad,
+                                     LevelMesh::Vertex *vertices,
+                                     unsigned int *indices,
+                                     unsigned int  baseIndex) {
+  const CompiledLevel &level = context.level;
+
+  int16_t vx1 = level.vertex_x[quad.vertex1];
+  int16_t vy1 = level.vertex_y[quad.vertex1];
+  int16_t vx2 = level.vertex_x[quad.vertex2];
+  int16_t vy2 = level.vertex_y[quad.vertex2];
+
+  // Calculate normalized positions
+  float x1 = (static_cast<float>(vx1) - context.centerX) * SCALE;
+  float z1 = (static_cast<float>(vy1) - context.centerY) * SCALE;
+  float x2 = (static_cast<float>(vx2) - context.centerX) * SCALE;
+  float z2 = (static_cast<float>(vy2) - context.centerY) * SCALE;
+
+  // Calculate wall dimensions
+  float wallBottom = quad.bottom * SCALE;
+  float wallTop    = quad.top * SCALE;
+  float wallHeight = wallTop - wallBottom;
+
   // Calculate real-world wall length (before scaling)
-  float wallLength =
-      sqrt(pow(vertex2.x - vertex1.x, 2) + pow(vertex2.y - vertex1.y, 2));
+  float wallLength = sqrt(pow(vx2 - vx1, 2) + pow(vy2 - vy1, 2));
 
   // DOOM texture constants
   const float TEXTURE_WIDTH  = 64.0f;
   const float TEXTURE_HEIGHT = 128.0f;
 
   // Calculate texture coordinates
-  float uOffset = static_cast<float>(sidedef.x_offset);
-  float vOffset = static_cast<float>(sidedef.y_offset);
+  float uOffset = static_cast<float>(level.side_x_offset[quad.sidedef]);
+  float vOffset = static_cast<float>(level.side_y_offset[quad.sidedef]);
 
   // Calculate number of texture repeats based on unscaled wall length
   float numRepeats = wallLength / TEXTURE_WIDTH;
@@ -57,282 +201,801 @@ void WADConverter::createWallSection(const WAD::Vertex &vertex1,
   float v2 = v1 + (wallHeight / (TEXTURE_HEIGHT * SCALE));
 
   // Add vertices with texture coordinates
-  // Bottom left
-  vertices.push_back(x1);
-  vertices.push_back(wallBottom);
-  vertices.push_back(-z1);
-  vertices.push_back(u1);
-  vertices.push_back(v1);
-
-  // Top left
-  vertices.push_back(x1);
-  vertices.push_back(wallTop);
-  vertices.push_back(-z1);
-  vertices.push_back(u1);
-  vertices.push_back(v2);
-
-  // Bottom right
-  vertices.push_back(x2);
-  vertices.push_back(wallBottom);
-  vertices.push_back(-z2);
-  vertices.push_back(u2);
-  vertices.push_back(v1);
-
-  // Top right
-  vertices.push_back(x2);
-  vertices.push_back(wallTop);
-  vertices.push_back(-z2);
-  vertices.push_back(u2);
-  vertices.push_back(v2);
-
-  // Add indices (CCW winding)
-  unsigned int baseIndex = vertices.size() / 5 - 4;  // We just added 4 vertices
-  indices.push_back(baseIndex);
-  indices.push_back(baseIndex + 1);
-  indices.push_back(baseIndex + 2);
-  indices.push_back(baseIndex + 1);
-  indices.push_back(baseIndex + 3);
-  indices.push_back(baseIndex + 2);
+  vertices[0] = {{x1, wallBottom, -z1}, {u1, v1}};  // Bottom left
+  vertices[1] = {{x1, wallTop, -z1}, {u1, v2}};     // Top left
+  vertices[2] = {{x2, wallBottom, -z2}, {u2, v1}};  // Bottom right
+  vertices[3] = {{x2, wallTop, -z2}, {u2, v2}};     // Top right
+
+  // Add indices, counterclockwise seen from the right of vertex1 -> vertex2
+  indices[0] = baseIndex;
+  indices[1] = baseIndex + 2;
+  indices[2] = baseIndex + 1;
+  indices[3] = baseIndex + 1;
+  indices[4] = baseIndex + 2;
+  indices[5] = baseIndex + 3;
 }
 
 /**
- * @brief Creates all the geometry for a level.
- * @param level The level to create geometry for.
- * @return A vector of OkItem pointers representing the level geometry.
+ * @brief Splits a range of items into chunks of about the same size.
+ * @param count Number of items
+ * @param pool Thread pool the chunks will run on, nullptr to run serially
+ * @param minChunkSize Fewest items in a chunk
+ * @return Chunks covering [0, count) in order, a single one without a pool
+ * or for small ranges
  */
-std::vector<OkItem *>
-WADConverter::createLevelGeometry(const WAD::Level &level) {
-  std::vector<OkItem *> items;
-
-  // Calculate level bounds and set center
-  float minX = std::numeric_limits<float>::max();
-  float maxX = std::numeric_limits<float>::lowest();
-  float minY = std::numeric_limits<float>::max();
-  float maxY = std::numeric_limits<float>::lowest();
-
-  for (int i = 0; i < (int)level.vertices.size(); i++) {
-    const WAD::Vertex &vertex = level.vertices[i];
-    minX                      = std::min(minX, static_cast<float>(vertex.x));
-    maxX                      = std::max(maxX, static_cast<float>(vertex.x));
-    minY                      = std::min(minY, static_cast<float>(vertex.y));
-    maxY                      = std::max(maxY, static_cast<float>(vertex.y));
+std::vector<WADConverter::Chunk>
+WADConverter::splitChunks(size_t count, ThreadPool *pool, size_t minChunkSize) {
+  size_t chunkCount = 1;
+  if (pool && minChunkSize > 0) {
+    // A few chunks per worker, so uneven chunks still keep every worker busy
+    chunkCount = std::min(pool->size() * 4, count / minChunkSize);
+    chunkCount = std::max(chunkCount, static_cast<size_t>(1));
   }
 
-  centerX = (minX + maxX) / 2.0f;
-  centerY = (minY + maxY) / 2.0f;
+  std::vector<Chunk> chunks(chunkCount);
+  for (size_t c = 0; c < chunkCount; c++) {
+    chunks[c].begin = count * c / chunkCount;
+    chunks[c].end   = count * (c + 1) / chunkCount;
+  }
+  return chunks;
+}
 
-  // First, create all flat (floor/ceiling) textures
-  for (int i = 0; i < (int)level.flats.size(); i++) {
-    const WAD::FlatData &flat = level.flats[i];
-    createFlatTexture(flat.name, flat, level.palette);
-  }
-
-  // Then load all wall textures we'll need
-  for (int i = 0; i < (int)level.sidedefs.size(); i++) {
-    const WAD::Sidedef &sidedef = level.sidedefs[i];
-    std::string upperTex = OkStrings::trimFixedString(sidedef.upper_texture, 8);
-    std::string middleTex =
-        OkStrings::trimFixedString(sidedef.middle_texture, 8);
-    std::string lowerTex = OkStrings::trimFixedString(sidedef.lower_texture, 8);
-
-    // Also get floor/ceiling textures
-    if (sidedef.sector < level.sectors.size()) {
-      const WAD::Sector &sector = level.sectors[sidedef.sector];
-      std::string        floorTex =
-          OkStrings::trimFixedString(sector.floor_texture, 8);
-      std::string ceilTex =
-          OkStrings::trimFixedString(sector.ceiling_texture, 8);
-
-      // Load all needed textures
-      for (int j = 0; j < (int)level.texture_defs.size(); j++) {
-        const WAD::TextureDef &texDef = level.texture_defs[j];
-        std::string texName = OkStrings::trimFixedString(texDef.name, 8);
-        if (!texName.empty() && (texName == upperTex || texName == middleTex ||
-                                 texName == lowerTex || texName == floorTex ||
-                                 texName == ceilTex)) {
-          createTextureFromDef(texDef, level.patches, level.palette);
-        }
-      }
+/**
+ * @brief Runs a task for every chunk, on the pool if there is one.
+ * @param chunkCount Number of chunks
+ * @param pool Thread pool, nullptr to run the chunks in order on this thread
+ * @param task Task called with each chunk index
+ */
+void WADConverter::runChunks(size_t chunkCount, ThreadPool *pool,
+                             const std::function<void(size_t)> &task) {
+  if (pool && chunkCount > 1) {
+    pool->parallelFor(chunkCount, task);
+  } else {
+    for (size_t c = 0; c < chunkCount; c++) {
+      task(c);
     }
   }
+}
 
-  // Track vertices for each sector
-  std::vector<std::vector<int>> sectorVertices(level.sectors.size());
+/**
+ * @brief Counting pass over a chunk of linedefs: records the wall quads and
+ * the sector vertices of each linedef and sizes the texture groups.
+ * @param context The conversion the chunk belongs to
+ * @param chunk The linedef chunk, its quads, vertices and sizes are filled
+ */
+void WADConverter::countWalls(const Context &context, Chunk &chunk) {
+  TRACE_ZONE("WADConverter::countWalls");
+  const CompiledLevel &level = context.level;
 
-  // Structure to hold geometry for each texture
-  struct GeometryGroup {
-    std::vector<float>        vertices;
-    std::vector<unsigned int> indices;
-    std::string               textureName;
-  };
-  std::map<std::string, GeometryGroup> geometryGroups;
+  const size_t vertexCount  = level.vertexCount();
+  const size_t sidedefCount = level.sidedefCount();
+  const size_t sectorCount  = level.sectorCount();
 
-  // First pass: collect vertices for each sector and create walls
-  for (int i = 0; i < (int)level.linedefs.size(); i++) {
-    const WAD::Linedef &linedef = level.linedefs[i];
+  chunk.sizes.resize(context.groups.size());
+  chunk.quads.reserve(chunk.end - chunk.begin);
+
+  for (size_t i = chunk.begin; i < chunk.end; i++) {
+    uint16_t v1 = level.line_start[i];
+    uint16_t v2 = level.line_end[i];
 
     // Skip invalid vertex indices
-    if (linedef.start_vertex >= level.vertices.size() ||
-        linedef.end_vertex >= level.vertices.size()) {
+    if (v1 >= vertexCount || v2 >= vertexCount) {
       continue;
     }
 
-    const WAD::Vertex &v1 = level.vertices[linedef.start_vertex];
-    const WAD::Vertex &v2 = level.vertices[linedef.end_vertex];
-
     // Handle right side (always present for valid linedefs)
-    if (linedef.right_sidedef != 0xFFFF &&
-        linedef.right_sidedef < level.sidedefs.size()) {
-      const WAD::Sidedef &rightSide = level.sidedefs[linedef.right_sidedef];
-
-      if (rightSide.sector < level.sectors.size()) {
-        // Add vertices to sector
-        sectorVertices[rightSide.sector].push_back(linedef.start_vertex);
-        sectorVertices[rightSide.sector].push_back(linedef.end_vertex);
-
-        // Handle two-sided linedef case
-        if (linedef.left_sidedef != 0xFFFF &&
-            linedef.left_sidedef < level.sidedefs.size()) {
-          const WAD::Sidedef &leftSide = level.sidedefs[linedef.left_sidedef];
-
-          if (leftSide.sector < level.sectors.size()) {
-            const WAD::Sector &sector1 = level.sectors[leftSide.sector];
-            const WAD::Sector &sector2 = level.sectors[rightSide.sector];
-
-            // Create upper wall if ceilings differ
-            if (sector1.ceiling_height > sector2.ceiling_height) {
-              std::string textureName =
-                  OkStrings::trimFixedString(rightSide.upper_texture, 8);
-              if (!textureName.empty() && textureName != "-") {
-                GeometryGroup &group = geometryGroups[textureName];
-                group.textureName    = textureName;
-                createWallSection(v1, v2, sector2.ceiling_height,
-                                  sector1.ceiling_height, rightSide,
-                                  group.vertices, group.indices);
-              }
-            }
-
-            // Create lower wall if floors differ
-            if (sector2.floor_height > sector1.floor_height) {
-              std::string textureName =
-                  OkStrings::trimFixedString(rightSide.lower_texture, 8);
-              if (!textureName.empty() && textureName != "-") {
-                GeometryGroup &group = geometryGroups[textureName];
-                group.textureName    = textureName;
-                createWallSection(v1, v2, sector1.floor_height,
-                                  sector2.floor_height, rightSide,
-                                  group.vertices, group.indices);
-              }
-            }
-
-            // Create middle wall in gaps
-            std::string middleTexName =
-                OkStrings::trimFixedString(rightSide.middle_texture, 8);
-            if (!middleTexName.empty() && middleTexName != "-") {
-              float upperWallBottom = sector2.ceiling_height;
-              float lowerWallTop    = sector2.floor_height;
-
-              if ((sector1.ceiling_height == sector2.ceiling_height &&
-                   sector1.floor_height == sector2.floor_height) ||
-                  (upperWallBottom > lowerWallTop)) {
-
-                float bottom =
-                    std::max(sector1.floor_height, sector2.floor_height);
-                float top =
-                    std::min(sector1.ceiling_height, sector2.ceiling_height);
-
-                if (top > bottom) {
-                  GeometryGroup &group = geometryGroups[middleTexName];
-                  group.textureName    = middleTexName;
-                  createWallSection(v1, v2, bottom, top, rightSide,
-                                    group.vertices, group.indices);
-                }
-              }
-            }
-          }
-        }
-        // One-sided linedef case
-        else {
-          const WAD::Sector &sector = level.sectors[rightSide.sector];
-          std::string        textureName =
-              OkStrings::trimFixedString(rightSide.middle_texture, 8);
-          if (!textureName.empty() && textureName != "-") {
-            GeometryGroup &group = geometryGroups[textureName];
-            group.textureName    = textureName;
-            createWallSection(v1, v2, sector.floor_height,
-                              sector.ceiling_height, rightSide, group.vertices,
-                              group.indices);
+    uint16_t rightSide = level.line_right[i];
+    if (rightSide == CompiledLevel::NO_SIDEDEF || rightSide >= sidedefCount) {
+      continue;
+    }
+
+    uint16_t rightSector = level.side_sector[rightSide];
+    if (rightSector >= sectorCount) {
+      continue;
+    }
+
+    // Add vertices to sector
+    SectorVertex start = {rightSector, v1};
+    SectorVertex end   = {rightSector, v2};
+    chunk.sectorVertices.push_back(start);
+    chunk.sectorVertices.push_back(end);
+
+    uint16_t leftSide = level.line_left[i];
+
+    // One-sided linedef case
+    if (leftSide == CompiledLevel::NO_SIDEDEF || leftSide >= sidedefCount) {
+      addWallSection(context, level.side_middle[rightSide], v1, v2,
+                     level.sector_floor[rightSector],
+                     level.sector_ceiling[rightSector], rightSide, chunk);
+      continue;
+    }
+
+    // Handle two-sided linedef case: each side shows its own textures and is
+    // walked so that it is on the right, the left side from v2 back to v1
+    uint16_t leftSector = level.side_sector[leftSide];
+    if (leftSector >= sectorCount) {
+      continue;
+    }
+
+    addSideWalls(context, i, 0, rightSector, leftSector, v1, v2, chunk);
+    addSideWalls(context, i, 1, leftSector, rightSector, v2, v1, chunk);
+  }
+}
+
+/**
+ * @brief Records the walls one side of a two-sided linedef shows.
+ * @param context The conversion the linedef belongs to
+ * @param linedef The linedef
+ * @param side 0 for the right sidedef, 1 for the left one
+ * @param frontSector Sector on this side
+ * @param backSector Sector on the other side
+ * @param vertex1 Start vertex, walking with the side on the right
+ * @param vertex2 End vertex, walking with the side on the right
+ * @param chunk Linedef chunk the walls belong to
+ * @note The upper wall is where the back ceiling is lower and the lower wall
+ * where the back floor is higher. The middle texture fills the opening, it
+ * is see-through so it goes to the masked walls instead of a texture group.
+ */
+void WADConverter::addSideWalls(const Context &context, uint16_t linedef,
+                                uint16_t side, uint16_t frontSector,
+                                uint16_t backSector, uint16_t vertex1,
+                                uint16_t vertex2, Chunk &chunk) {
+  const CompiledLevel &level   = context.level;
+  uint16_t             sidedef = side == 0 ? level.line_right[linedef]
+                                           : level.line_left[linedef];
+
+  float frontFloor   = level.sector_floor[frontSector];
+  float frontCeiling = level.sector_ceiling[frontSector];
+  float backFloor    = level.sector_floor[backSector];
+  float backCeiling  = level.sector_ceiling[backSector];
+
+  // DOOM does not draw the upper wall between two sky ceilings
+  bool skyUpper = context.options.skipSky && level.hasSkyCeiling(frontSector) &&
+                  level.hasSkyCeiling(backSector);
+  if (frontCeiling > backCeiling && !skyUpper) {
+    addWallSection(context, level.side_upper[sidedef], vertex1, vertex2,
+                   backCeiling, frontCeiling, sidedef, chunk);
+  }
+
+  if (backFloor > frontFloor) {
+    addWallSection(context, level.side_lower[sidedef], vertex1, vertex2,
+                   frontFloor, backFloor, sidedef, chunk);
+  }
+
+  uint16_t middle = level.side_middle[sidedef];
+  float    bottom = std::max(frontFloor, backFloor);
+  float    top    = std::min(frontCeiling, backCeiling);
+  if (middle != CompiledLevel::NO_TEXTURE && top * SCALE > bottom * SCALE) {
+    MaskedWall wall = {{middle, vertex1, vertex2, sidedef, bottom, top, 0},
+                       linedef,
+                       side};
+    chunk.masked.push_back(wall);
+  }
+}
+
+/**
+ * @brief Checks if a wall quad continues another one seamlessly.
+ * @param level The compiled level
+ * @param first The wall quad, ending where second starts
+ * @param second The wall quad that would be merged into first
+ * @return true if both quads can be drawn as a single quad: same texture,
+ * heights and vertical offset, same direction and a horizontal texture
+ * offset that continues where first ends, up to whole texture repeats
+ */
+bool WADConverter::canMergeWalls(const CompiledLevel &level,
+                                 const WallQuad      &first,
+                                 const WallQuad      &second) {
+  if (second.group != first.group || second.bottom != first.bottom ||
+      second.top != first.top ||
+      level.side_y_offset[second.sidedef] !=
+          level.side_y_offset[first.sidedef]) {
+    return false;
+  }
+
+  int32_t dx1 = level.vertex_x[first.vertex2] - level.vertex_x[first.vertex1];
+  int32_t dy1 = level.vertex_y[first.vertex2] - level.vertex_y[first.vertex1];
+  int32_t dx2 = level.vertex_x[second.vertex2] - level.vertex_x[second.vertex1];
+  int32_t dy2 = level.vertex_y[second.vertex2] - level.vertex_y[second.vertex1];
+
+  // Collinear and pointing the same way
+  int64_t cross = static_cast<int64_t>(dx1) * dy2 -
+                  static_cast<int64_t>(dy1) * dx2;
+  int64_t dot = static_cast<int64_t>(dx1) * dx2 +
+                static_cast<int64_t>(dy1) * dy2;
+  if (cross != 0 || dot <= 0) {
+    return false;
+  }
+
+  // The texture must continue where the first wall ends. Walls repeat it
+  // every TEXTURE_WIDTH units, as in createWallSection()
+  const float TEXTURE_WIDTH = 64.0f;
+  const float EPSILON       = 0.001f;
+
+  float length = sqrt(pow(dx1, 2) + pow(dy1, 2));
+  float end    = level.side_x_offset[first.sidedef] + length;
+  float shift  = std::fabs(
+      std::fmod(end - level.side_x_offset[second.sidedef], TEXTURE_WIDTH));
+  return shift < EPSILON || shift > TEXTURE_WIDTH - EPSILON;
+}
+
+/**
+ * @brief Merges chains of collinear wall quads into single quads.
+ * @param level The compiled level
+ * @param chunks The linedef chunks, after the counting pass
+ * @param scratch Arena of the conversion, for the quads of each vertex
+ * @return Number of quads merged away
+ * @note The first quad of a chain is extended to the end of the chain and
+ * the others are marked with NO_TEXTURE and taken out of the group sizes.
+ * Quads are visited in output order, so the result does not depend on how
+ * the linedefs were split in chunks.
+ */
+size_t WADConverter::mergeWalls(const CompiledLevel        &level,
+                                std::vector<Chunk>         &chunks,
+                                std::pmr::memory_resource *scratch) {
+  // Quads starting at each vertex, in output order
+  struct QuadRef {
+    uint32_t chunk;
+    uint32_t quad;
+  };
+  std::pmr::vector<std::pmr::vector<QuadRef>> startingAt(level.vertexCount(),
+                                                         scratch);
+  for (uint32_t c = 0; c < chunks.size(); c++) {
+    for (uint32_t q = 0; q < chunks[c].quads.size(); q++) {
+      QuadRef ref = {c, q};
+      startingAt[chunks[c].quads[q].vertex1].push_back(ref);
+    }
+  }
+
+  size_t merged = 0;
+  for (size_t c = 0; c < chunks.size(); c++) {
+    for (size_t q = 0; q < chunks[c].quads.size(); q++) {
+      WallQuad &quad = chunks[c].quads[q];
+
+      // Keep absorbing the next quad of the chain
+      bool extended = quad.texture != CompiledLevel::NO_TEXTURE;
+      while (extended) {
+        extended = false;
+
+        const std::pmr::vector<QuadRef> &next = startingAt[quad.vertex2];
+        for (size_t n = 0; n < next.size(); n++) {
+          Chunk    &owner = chunks[next[n].chunk];
+          WallQuad &other = owner.quads[next[n].quad];
+          // Overlapping linedefs can reach the same quad, it is only
+          // absorbed once
+          if (&other == &quad || other.texture == CompiledLevel::NO_TEXTURE ||
+              !canMergeWalls(level, quad, other)) {
+            continue;
           }
+
+          GroupSize &size = owner.sizes[quad.group];
+          assert(size.vertexCount >= 4 && size.indexCount >= 6);
+          quad.vertex2  = other.vertex2;
+          other.texture = CompiledLevel::NO_TEXTURE;
+          size.vertexCount -= 4;
+          size.indexCount -= 6;
+          merged++;
+          extended = true;
+          break;
         }
       }
     }
   }
 
-  // Second pass: create floor and ceiling geometry for each sector
-  for (int i = 0; i < (int)level.sectors.size(); i++) {
-    const WAD::Sector &sector = level.sectors[i];
+  return merged;
+}
+
+/**
+ * @brief Texture of a sector ceiling, as far as geometry is concerned.
+ * @param context The conversion the sector belongs to
+ * @param sector Sector index
+ * @return The ceiling texture id, NO_TEXTURE for sky ceilings when the sky
+ * is skipped
+ */
+uint16_t WADConverter::ceilingTexture(const Context &context, size_t sector) {
+  if (context.options.skipSky && context.level.hasSkyCeiling(sector)) {
+    return CompiledLevel::NO_TEXTURE;
+  }
+  return context.level.sector_ceiling_texture[sector];
+}
 
+/**
+ * @brief Counting pass over a chunk of sectors: removes duplicate sector
+ * vertices and sizes the texture groups of the floors and ceilings.
+ * @param context The conversion the chunk belongs to
+ * @param sectorVertices Vertex indices of each sector, sorted in place
+ * @param chunk The sector chunk, its sizes are filled
+ * @note A sector polygon of n vertices is a fan of n - 2 triangles.
+ */
+void WADConverter::countFlats(const Context     &context,
+                              SectorVertexLists &sectorVertices,
+                              Chunk             &chunk) {
+  TRACE_ZONE("WADConverter::countFlats");
+  const CompiledLevel &level = context.level;
+  chunk.sizes.resize(context.groups.size());
+
+  for (size_t i = chunk.begin; i < chunk.end; i++) {
     // Remove duplicate vertices
     std::sort(sectorVertices[i].begin(), sectorVertices[i].end());
     sectorVertices[i].erase(
         std::unique(sectorVertices[i].begin(), sectorVertices[i].end()),
         sectorVertices[i].end());
 
-    // Create floor
-    std::string floorTexName =
-        OkStrings::trimFixedString(sector.floor_texture, 8);
-    if (!floorTexName.empty() && floorTexName != "-") {
-      GeometryGroup &group = geometryGroups[floorTexName];
-      group.textureName    = floorTexName;
-      createSectorGeometry(level, sector, sectorVertices[i], group.vertices,
-                           group.indices, true);
+    size_t polygonSize = sectorVertices[i].size();
+    if (polygonSize < 3) {
+      continue;  // Need at least 3 vertices to form a polygon
     }
 
-    // Create ceiling
-    std::string ceilingTexName =
-        OkStrings::trimFixedString(sector.ceiling_texture, 8);
-    if (!ceilingTexName.empty() && ceilingTexName != "-") {
-      GeometryGroup &group = geometryGroups[ceilingTexName];
-      group.textureName    = ceilingTexName;
-      createSectorGeometry(level, sector, sectorVertices[i], group.vertices,
-                           group.indices, false);
+    uint16_t flatIds[2] = {level.sector_floor_texture[i],
+                           ceilingTexture(context, i)};
+    for (int f = 0; f < 2; f++) {
+      if (flatIds[f] != CompiledLevel::NO_TEXTURE) {
+        uint32_t group = context.groups.slot(flatIds[f], i);
+        chunk.sizes[group].vertexCount += polygonSize;
+        chunk.sizes[group].indexCount += (polygonSize - 2) * 3;
+      }
     }
   }
+}
 
-  // Create OkItems from geometry groups
-  for (std::map<std::string, GeometryGroup>::iterator it =
-           geometryGroups.begin();
-       it != geometryGroups.end(); it++) {
-    const GeometryGroup &group = it->second;
+/**
+ * @brief Fill pass over a chunk of linedefs: writes its wall quads.
+ * @param context The conversion the chunk belongs to
+ * @param chunk The linedef chunk, its write positions in offsets are
+ * advanced
+ * @param groups The texture groups, already at their final size
+ */
+void WADConverter::fillWalls(const Context &context, Chunk &chunk,
+                             std::pmr::vector<LevelMesh::Group> &groups) {
+  TRACE_ZONE("WADConverter::fillWalls");
+  std::pmr::vector<GroupSize> &at = chunk.offsets;
+
+  for (size_t q = 0; q < chunk.quads.size(); q++) {
+    const WallQuad &quad = chunk.quads[q];
+    if (quad.texture == CompiledLevel::NO_TEXTURE) {
+      continue;  // Merged into another quad
+    }
+
+    LevelMesh::Group &group = groups[quad.group];
+    GroupSize        &pos   = at[quad.group];
+    createWallSection(context, quad, &group.vertices[pos.vertexCount],
+                      &group.indices[pos.indexCount], pos.vertexCount);
+    pos.vertexCount += 4;
+    pos.indexCount += 6;
+  }
+}
+
+/**
+ * @brief Fill pass over a chunk of sectors: writes the floors and ceilings.
+ * @param context The conversion the chunk belongs to
+ * @param sectorVertices Vertex indices of each sector, without duplicates
+ * @param chunk The sector chunk, its write positions in offsets are advanced
+ * @param groups The texture groups, already at their final size
+ */
+void WADConverter::fillFlats(const Context                      &context,
+                             const SectorVertexLists            &sectorVertices,
+                             Chunk                              &chunk,
+                             std::pmr::vector<LevelMesh::Group> &groups) {
+  TRACE_ZONE("WADConverter::fillFlats");
+  const CompiledLevel         &level = context.level;
+  std::pmr::vector<GroupSize> &at    = chunk.offsets;
+
+  for (size_t i = chunk.begin; i < chunk.end; i++) {
+    size_t polygonSize = sectorVertices[i].size();
+    if (polygonSize < 3) {
+      continue;
+    }
+
+    // Create floor and ceiling
+    uint16_t flatIds[2] = {level.sector_floor_texture[i],
+                           ceilingTexture(context, i)};
+    for (int f = 0; f < 2; f++) {
+      if (flatIds[f] == CompiledLevel::NO_TEXTURE) {
+        continue;
+      }
+
+      uint32_t          slot    = context.groups.slot(flatIds[f], i);
+      LevelMesh::Group &group   = groups[slot];
+      GroupSize        &pos     = at[slot];
+      bool              isFloor = f == 0;
+      int16_t height =
+          isFloor ? level.sector_floor[i] : level.sector_ceiling[i];
+      createSectorGeometry(context, height, sectorVertices[i], isFloor,
+                           &group.vertices[pos.vertexCount],
+                           &group.indices[pos.indexCount], pos.vertexCount);
+      pos.vertexCount += polygonSize;
+      pos.indexCount += (polygonSize - 2) * 3;
+    }
+  }
+}
+
+/**
+ * @brief Builds the geometry of a level, grouped by texture.
+ * @param level The level to build geometry for.
+ * @param pool Optional thread pool to split the linedefs and sectors across.
+ * @param options Conversion settings.
+ * @return The level mesh, with one group per texture in name order.
+ * @note Only reads the level and keeps all its state in a local Context, so
+ * it can run for several levels at once on different threads.
+ *
+ * A counting pass decides every wall quad and sector polygon and sizes each
+ * texture group exactly, then a fill pass writes the vertex and index records
+ * straight into the final group buffers. Both passes work on chunks of
+ * linedefs and sectors. The write position of every chunk in every group is
+ * known before filling, so the chunks fill in parallel and the output is the
+ * same as the serial one: walls in linedef order, then flats in sector order.
+ *
+ * Everything but the mesh is scratch: it comes from monotonic arenas, one
+ * for the conversion and one per chunk, and is freed at once on return.
+ */
+LevelMesh WADConverter::buildLevelMesh(const WAD::Level        &level,
+                                       ThreadPool              *pool,
+                                       const ConversionOptions &options) {
+  TRACE_ZONE_LUMP("WADConverter::buildLevelMesh", LumpName(level.name));
+  LevelMesh mesh;
+
+  // Struct-of-arrays view used by the geometry passes below
+  CompiledLevel compiled(level);
+
+  // About what the scratch lists of a level take, so the arena grows in a
+  // few blocks
+  const size_t SCRATCH_BYTES_PER_LINEDEF = 64;
+  std::pmr::monotonic_buffer_resource scratch(
+      std::max<size_t>(compiled.linedefCount() * SCRATCH_BYTES_PER_LINEDEF,
+                       4096));
+
+  // Calculate level bounds and set center
+  float minX = std::numeric_limits<float>::max();
+  float maxX = std::numeric_limits<float>::lowest();
+  float minY = std::numeric_limits<float>::max();
+  float maxY = std::numeric_limits<float>::lowest();
+
+  for (size_t i = 0; i < compiled.vertexCount(); i++) {
+    minX = std::min(minX, static_cast<float>(compiled.vertex_x[i]));
+    maxX = std::max(maxX, static_cast<float>(compiled.vertex_x[i]));
+    minY = std::min(minY, static_cast<float>(compiled.vertex_y[i]));
+    maxY = std::max(maxY, static_cast<float>(compiled.vertex_y[i]));
+  }
+
+  mesh.centerX = (minX + maxX) / 2.0f;
+  mesh.centerY = (minY + maxY) / 2.0f;
+  mesh.scale   = SCALE;
+
+  GroupTable groupTable =
+      buildGroupTable(compiled, options.sectorGroups, &scratch);
+  Context context = {compiled, options, groupTable, mesh.centerX,
+                     mesh.centerY};
+
+  // Counting pass, walls
+  std::vector<Chunk> wallChunks =
+      splitChunks(compiled.linedefCount(), pool, options.minChunkSize);
+  runChunks(wallChunks.size(), pool,
+            [&](size_t c) { countWalls(context, wallChunks[c]); });
+
+  // Chains can cross chunks, so they are merged over all of them at once
+  if (options.mergeWalls) {
+    TRACE_ZONE("WADConverter::mergeWalls");
+    mergeWalls(compiled, wallChunks, &scratch);
+  }
+
+  // Track vertices for each sector, in linedef order
+  SectorVertexLists sectorVertices(compiled.sectorCount(), &scratch);
+  for (size_t c = 0; c < wallChunks.size(); c++) {
+    const std::pmr::vector<SectorVertex> &found = wallChunks[c].sectorVertices;
+    for (size_t v = 0; v < found.size(); v++) {
+      sectorVertices[found[v].sector].push_back(found[v].vertex);
+    }
+  }
+
+  // Counting pass, flats
+  std::vector<Chunk> flatChunks =
+      splitChunks(compiled.sectorCount(), pool, options.minChunkSize);
+  runChunks(flatChunks.size(), pool, [&](size_t c) {
+    countFlats(context, sectorVertices, flatChunks[c]);
+  });
+
+  // Write position of every chunk in every group: walls first and then
+  // flats, each in chunk order
+  std::pmr::vector<GroupSize> totals(groupTable.size(), &scratch);
+  for (int pass = 0; pass < 2; pass++) {
+    std::vector<Chunk> &chunks = pass == 0 ? wallChunks : flatChunks;
+    for (size_t c = 0; c < chunks.size(); c++) {
+      chunks[c].offsets.assign(totals.begin(), totals.end());
+      for (size_t t = 0; t < totals.size(); t++) {
+        totals[t].vertexCount += chunks[c].sizes[t].vertexCount;
+        totals[t].indexCount += chunks[c].sizes[t].indexCount;
+      }
+    }
+  }
+
+  // Fill pass: every group buffer is allocated once at its final size
+  std::pmr::vector<LevelMesh::Group> geometryGroups(groupTable.size(),
+                                                    &scratch);
+  for (size_t t = 0; t < geometryGroups.size(); t++) {
+    geometryGroups[t].vertices.resize(totals[t].vertexCount);
+    geometryGroups[t].indices.resize(totals[t].indexCount);
+  }
+
+  runChunks(wallChunks.size(), pool, [&](size_t c) {
+    fillWalls(context, wallChunks[c], geometryGroups);
+  });
+  runChunks(flatChunks.size(), pool, [&](size_t c) {
+    fillFlats(context, sectorVertices, flatChunks[c], geometryGroups);
+  });
+
+  // Keep the non-empty groups, in texture name order
+  for (size_t t = 0; t < geometryGroups.size(); t++) {
+    LevelMesh::Group &group = geometryGroups[t];
 
     if (group.vertices.empty() || group.indices.empty()) {
       continue;
     }
 
-    std::string   itemName   = "level_" + group.textureName;
-    float        *vertexData = new float[group.vertices.size()];
-    unsigned int *indexData  = new unsigned int[group.indices.size()];
+    group.texture = compiled.texture_names[groupTable.texture[t]];
+    group.sector  = groupTable.sector[t];
+    mesh.groups.push_back(std::move(group));
+  }
+
+  // Masked walls are few, they are written here in linedef order
+  for (size_t c = 0; c < wallChunks.size(); c++) {
+    const std::pmr::vector<MaskedWall> &walls = wallChunks[c].masked;
+    for (size_t m = 0; m < walls.size(); m++) {
+      LevelMesh::MaskedSurface surface;
+      unsigned int             indices[6];
+      surface.texture = compiled.texture_names[walls[m].quad.texture];
+      surface.linedef = walls[m].linedef;
+      surface.side    = walls[m].side;
+      createWallSection(context, walls[m].quad, surface.vertices, indices, 0);
+      mesh.masked.push_back(surface);
+    }
+  }
+
+  // The sky replaces the ceilings left out above
+  if (options.skipSky) {
+    for (size_t i = 0; i < compiled.sectorCount(); i++) {
+      if (compiled.hasSkyCeiling(i)) {
+        addSkyBackdrop(context, skyTextureName(level.name), mesh);
+        break;
+      }
+    }
+  }
+
+  return mesh;
+}
+
+/**
+ * @brief Finds the sky texture of a level, as DOOM picks it.
+ * @param levelName Level marker name, ExMy or MAPxx.
+ * @return SKY1 to SKY4 by episode for ExMy levels, SKY1 for MAP01-11, SKY2
+ * for MAP12-20 and SKY3 for the rest.
+ */
+LumpName WADConverter::skyTextureName(const char *levelName) {
+  LumpName name(levelName);
+
+  if (name[0] == 'E' && name[2] == 'M') {
+    const char sky[5] = {'S', 'K', 'Y', name[1], '\0'};
+    return LumpName(sky);
+  }
 
-    // Copy vertex and index data
-    for (int i = 0; i < (int)group.vertices.size(); i++) {
-      vertexData[i] = group.vertices[i];
+  if (name[0] == 'M' && name[1] == 'A' && name[2] == 'P') {
+    int map = (name[3] - '0') * 10 + (name[4] - '0');
+    if (map >= 21) {
+      return LumpName("SKY3");
+    }
+    if (map >= 12) {
+      return LumpName("SKY2");
     }
-    for (int i = 0; i < (int)group.indices.size(); i++) {
-      indexData[i] = group.indices[i];
+  }
+
+  return LumpName("SKY1");
+}
+
+/**
+ * @brief Adds a sky backdrop around the level: an open cylinder with a cap,
+ * facing inwards, from the lowest floor to above the highest ceiling.
+ * @param context The conversion the backdrop belongs to
+ * @param texture Sky texture of the level
+ * @param mesh The level mesh, its group for the texture is created or grown
+ * @note The backdrop is made of whole DOOM units, so it survives the compact
+ * vertex format unchanged. The sky texture repeats 4 times around, as DOOM
+ * shows a 256 pixels wide sky over 90 degrees.
+ */
+void WADConverter::addSkyBackdrop(const Context &context, LumpName texture,
+                                  LevelMesh &mesh) {
+  const CompiledLevel &level = context.level;
+  const float          PI    = 3.14159265358979f;
+
+  int16_t minX = std::numeric_limits<int16_t>::max();
+  int16_t maxX = std::numeric_limits<int16_t>::min();
+  int16_t minY = std::numeric_limits<int16_t>::max();
+  int16_t maxY = std::numeric_limits<int16_t>::min();
+  for (size_t i = 0; i < level.vertexCount(); i++) {
+    minX = std::min(minX, level.vertex_x[i]);
+    maxX = std::max(maxX, level.vertex_x[i]);
+    minY = std::min(minY, level.vertex_y[i]);
+    maxY = std::max(maxY, level.vertex_y[i]);
+  }
+
+  int16_t bottom = std::numeric_limits<int16_t>::max();
+  int16_t top    = std::numeric_limits<int16_t>::min();
+  for (size_t i = 0; i < level.sectorCount(); i++) {
+    bottom = std::min(bottom, level.sector_floor[i]);
+    top    = std::max(top, level.sector_ceiling[i]);
+  }
+
+  // Just outside the level, in whole units that stay in the 16-bit range
+  float halfWidth  = (maxX - minX) / 2.0f;
+  float halfHeight = (maxY - minY) / 2.0f;
+  float radius     = sqrt(halfWidth * halfWidth + halfHeight * halfHeight);
+
+  auto clampUnit = [](float value) {
+    return std::max(-32768.0f, std::min(32767.0f, std::round(value)));
+  };
+  float skyTop = clampUnit(top + radius / 2.0f);
+
+  // Cylinder vertices in pairs (bottom, top), the seam is duplicated so the
+  // texture can wrap
+  std::vector<LevelMesh::Vertex> vertices;
+  std::vector<unsigned int>      indices;
+  float                          capX[SKY_SEGMENTS];
+  float                          capZ[SKY_SEGMENTS];
+  for (int s = 0; s <= SKY_SEGMENTS; s++) {
+    float angle = 2.0f * PI * s / SKY_SEGMENTS;
+    float vx    = clampUnit(context.centerX + (radius + 64.0f) * cos(angle));
+    float vy    = clampUnit(context.centerY + (radius + 64.0f) * sin(angle));
+    float x     = (vx - context.centerX) * SCALE;
+    float z     = (vy - context.centerY) * SCALE;
+    float u     = 4.0f * s / SKY_SEGMENTS;
+
+    vertices.push_back({{x, bottom * SCALE, -z}, {u, 1.0f}});
+    vertices.push_back({{x, skyTop * SCALE, -z}, {u, 0.0f}});
+    if (s < SKY_SEGMENTS) {
+      capX[s] = x;
+      capZ[s] = -z;
     }
+  }
+
+  // Going around counterclockwise on the map, so the inside is on the left
+  for (unsigned int s = 0; s < SKY_SEGMENTS; s++) {
+    unsigned int       base    = s * 2;
+    const unsigned int quad[6] = {base,     base + 1, base + 2,
+                                  base + 1, base + 3, base + 2};
+    indices.insert(indices.end(), quad, quad + 6);
+  }
+
+  // Cap seen from below, a fan around the center filled with the top row
+  unsigned int center  = static_cast<unsigned int>(vertices.size());
+  float        centerX = (clampUnit(context.centerX) - context.centerX) * SCALE;
+  float        centerZ = (clampUnit(context.centerY) - context.centerY) * SCALE;
+  vertices.push_back({{centerX, skyTop * SCALE, -centerZ}, {2.0f, 0.0f}});
+  for (unsigned int s = 0; s < SKY_SEGMENTS; s++) {
+    float u = 4.0f * s / SKY_SEGMENTS;
+    vertices.push_back({{capX[s], skyTop * SCALE, capZ[s]}, {u, 0.0f}});
+  }
+  for (unsigned int s = 0; s < SKY_SEGMENTS; s++) {
+    unsigned int current = center + 1 + s;
+    unsigned int next    = center + 1 + (s + 1) % SKY_SEGMENTS;
+    indices.push_back(center);
+    indices.push_back(next);
+    indices.push_back(current);
+  }
+
+  // Keep the groups in texture name order, the backdrop after the sector
+  // groups of the same texture
+  std::vector<LevelMesh::Group>::iterator group = std::lower_bound(
+      mesh.groups.begin(), mesh.groups.end(), texture,
+      [](const LevelMesh::Group &g, LumpName n) {
+        return g.texture < n ||
+               (g.texture == n && g.sector != LevelMesh::NO_SECTOR);
+      });
+  if (group == mesh.groups.end() || group->texture != texture) {
+    LevelMesh::Group sky;
+    sky.texture = texture;
+    group       = mesh.groups.insert(group, sky);
+  }
+
+  unsigned int baseIndex = static_cast<unsigned int>(group->vertices.size());
+  group->vertices.insert(group->vertices.end(), vertices.begin(),
+                         vertices.end());
+  for (size_t i = 0; i < indices.size(); i++) {
+    group->indices.push_back(baseIndex + indices[i]);
+  }
+}
 
-    OkItem *item = new OkItem(itemName, vertexData, group.vertices.size(),
-                              indexData, group.indices.size());
+/**
+ * @brief Builds the geometry of a level in the compact vertex format.
+ * @param level The level to build geometry for.
+ * @param pool Optional thread pool to split the linedefs and sectors across.
+ * @return The quantized level mesh, CompactLevelMesh::decode() gives back
+ * float vertices for tools.
+ */
+CompactLevelMesh WADConverter::buildCompactLevelMesh(const WAD::Level &level,
+                                                     ThreadPool       *pool) {
+  return CompactLevelMesh::encode(buildLevelMesh(level, pool), SCALE);
+}
+
+/**
+ * @brief Builds the geometry of several levels on a thread pool.
+ * @param levels The levels to build geometry for.
+ * @param pool The thread pool running one task per level.
+ * @return The level meshes, in the same order as the levels.
+ * @throws The first exception thrown while building a level, if any.
+ */
+std::vector<LevelMesh>
+WADConverter::buildLevelMeshes(const std::vector<WAD::Level> &levels,
+                               ThreadPool                    &pool) {
+  std::vector<std::future<LevelMesh>> pending;
+  pending.reserve(levels.size());
+  for (size_t i = 0; i < levels.size(); i++) {
+    const WAD::Level *level = &levels[i];
+    pending.push_back(
+        pool.submit([level]() { return buildLevelMesh(*level); }));
+  }
+
+  std::vector<LevelMesh> meshes;
+  meshes.reserve(levels.size());
+  for (size_t i = 0; i < pending.size(); i++) {
+    meshes.push_back(pending[i].get());
+  }
+  return meshes;
+}
+
+/**
+ * @brief Creates the textures and engine items for a built level mesh.
+ * @param level The level the mesh was built from.
+ * @param mesh The mesh built by buildLevelMesh().
+ * @return A vector of OkItem pointers representing the level geometry.
+ */
+std::vector<OkItem *>
+WADConverter::createLevelItems(const WAD::Level &level, const LevelMesh &mesh) {
+  TRACE_ZONE_LUMP("WADConverter::createLevelItems", LumpName(level.name));
+  std::vector<OkItem *> items;
+
+  // First, create all flat (floor/ceiling) textures
+  for (int i = 0; i < (int)level.flats.size(); i++) {
+    const WAD::FlatData &flat = level.flats[i];
+    createFlatTexture(LumpName(flat.name).str(), flat, level.palette);
+  }
+
+  // Then load all wall textures we'll need: the ones of the mesh groups and
+  // of the masked surfaces
+  std::vector<LumpName> used = mesh.usedTextures();
+
+  for (int j = 0; j < (int)level.texture_defs.size(); j++) {
+    const WAD::TextureDef &texDef = level.texture_defs[j];
+    if (std::binary_search(used.begin(), used.end(), LumpName(texDef.name))) {
+      createTextureFromDef(texDef, level.patches, level.palette);
+    }
+  }
+
+  // Create OkItems from geometry groups, in texture name order
+  for (size_t t = 0; t < mesh.groups.size(); t++) {
+    const LevelMesh::Group &group = mesh.groups[t];
+
+    std::string textureName = group.texture.str();
+    std::string itemName    = "level_" + textureName;
+    if (group.sector != LevelMesh::NO_SECTOR) {
+      itemName += "_" + std::to_string(group.sector);
+    }
+
+    // The group buffers already have the interleaved layout OkItem expects,
+    // and OkItem copies them without writing to them
+    float *vertexData = const_cast<float *>(
+        reinterpret_cast<const float *>(group.vertices.data()));
+    OkItem *item = new OkItem(
+        itemName, vertexData,
+        group.vertices.size() * LevelMesh::Vertex::FLOAT_COUNT,
+        const_cast<unsigned int *>(group.indices.data()),
+        group.indices.size());
 
     OkTexture *texture =
-        OkTextureHandler::getInstance()->getTexture(group.textureName);
+        OkTextureHandler::getInstance()->getTexture(textureName);
     if (texture) {
-      item->setTexture(group.textureName, texture);
-      OkLogger::info("Assigned texture '" + group.textureName + "' to item '" +
-                     itemName + "'");
+      item->setTexture(textureName, texture);
+      LOG_DEBUG("Assigned texture '" << textureName << "' to item '"
+                                      << itemName << "'");
     } else {
-      OkLogger::error("Could not find texture '" + group.textureName +
-                      "' for item '" + itemName + "'");
+      LOG_ERROR("Could not find texture '" << textureName << "' for item '"
+                                           << itemName << "'");
     }
 
     items.push_back(item);
@@ -341,23 +1004,81 @@ WADConverter::createLevelGeometry(const WAD::Level &level) {
   return items;
 }
 
-void WADConverter::createSectorGeometry(const WAD::Level       &level,
-                                        const WAD::Sector      &sector,
-                                        const std::vector<int> &sectorVertices,
-                                        std::vector<float>     &vertices,
-                                        std::vector<unsigned int> &indices,
-                                        bool                       isFloor) {
+/**
+ * @brief Creates the engine items of the masked surfaces of a level mesh.
+ * @param mesh The mesh built by buildLevelMesh().
+ * @return One OkItem per masked surface, in the order of mesh.masked, so a
+ * MaskedSurfaceSorter order can be applied to them.
+ * @note Call createLevelItems() first, it loads the textures.
+ */
+std::vector<OkItem *> WADConverter::createMaskedItems(const LevelMesh &mesh) {
+  TRACE_ZONE("WADConverter::createMaskedItems");
+  std::vector<OkItem *> items;
+  items.reserve(mesh.masked.size());
+
+  for (size_t m = 0; m < mesh.masked.size(); m++) {
+    const LevelMesh::MaskedSurface &surface = mesh.masked[m];
+
+    std::string textureName = surface.texture.str();
+    std::string itemName    = "masked_" + std::to_string(surface.linedef) +
+                           "_" + std::to_string(surface.side);
+
+    float *vertexData = const_cast<float *>(
+        reinterpret_cast<const float *>(surface.vertices));
+    OkItem *item = new OkItem(
+        itemName, vertexData, 4 * LevelMesh::Vertex::FLOAT_COUNT,
+        const_cast<unsigned int *>(LevelMesh::MaskedSurface::INDICES), 6);
+
+    OkTexture *texture =
+        OkTextureHandler::getInstance()->getTexture(textureName);
+    if (texture) {
+      item->setTexture(textureName, texture);
+    } else {
+      LOG_ERROR("Could not find texture '" << textureName << "' for item '"
+                                           << itemName << "'");
+    }
 
-  if (sectorVertices.size() < 3) {
-    return;  // Need at least 3 vertices to form a polygon
+    items.push_back(item);
   }
 
-  float height = isFloor ? static_cast<float>(sector.floor_height) * SCALE
-                         : static_cast<float>(sector.ceiling_height) * SCALE;
+  return items;
+}
+
+/**
+ * @brief Creates all the geometry for a level.
+ * @param level The level to create geometry for.
+ * @return A vector of OkItem pointers representing the level geometry, the
+ * masked surfaces last.
+ */
+std::vector<OkItem *>
+WADConverter::createLevelGeometry(const WAD::Level &level) {
+  LevelMesh             mesh   = buildLevelMesh(level);
+  std::vector<OkItem *> items  = createLevelItems(level, mesh);
+  std::vector<OkItem *> masked = createMaskedItems(mesh);
+  items.insert(items.end(), masked.begin(), masked.end());
+  return items;
+}
+
+/**
+ * @brief Writes the floor or ceiling polygon of a sector as a triangle fan.
+ * @param context The conversion the sector belongs to
+ * @param height Height of the floor or ceiling
+ * @param sectorVertices Vertex indices of the sector, at least 3
+ * @param isFloor true for the floor, false for the ceiling
+ * @param vertices Where the sectorVertices.size() vertices are written
+ * @param indices Where the (sectorVertices.size() - 2) * 3 indices are written
+ * @param baseIndex Index of the first written vertex in its group
+ */
+void WADConverter::createSectorGeometry(
+    const Context &context, int16_t height,
+    const std::pmr::vector<int> &sectorVertices, bool isFloor,
+    LevelMesh::Vertex *vertices, unsigned int *indices,
+    unsigned int baseIndex) {
+  const CompiledLevel &level = context.level;
+
+  float y = static_cast<float>(height) * SCALE;
 
-  // First create all vertices for the sector
-  unsigned int baseIndex    = vertices.size() / 5;  // 5 floats per vertex
-  const float  TEXTURE_SIZE = 64.0f;  // DOOM uses 64x64 flat textures
+  const float TEXTURE_SIZE = 64.0f;  // DOOM uses 64x64 flat textures
 
   // Calculate sector bounds for texture mapping
   float minX = std::numeric_limits<float>::max();
@@ -367,9 +1088,8 @@ void WADConverter::createSectorGeometry(const WAD::Level       &level,
 
   // First pass - get bounds for texture coordinates
   for (int i = 0; i < (int)sectorVertices.size(); i++) {
-    const WAD::Vertex &vertex = level.vertices[sectorVertices[i]];
-    float              worldX = static_cast<float>(vertex.x);
-    float              worldY = static_cast<float>(vertex.y);
+    float worldX = static_cast<float>(level.vertex_x[sectorVertices[i]]);
+    float worldY = static_cast<float>(level.vertex_y[sectorVertices[i]]);
 
     minX = std::min(minX, worldX);
     maxX = std::max(maxX, worldX);
@@ -379,151 +1099,47 @@ void WADConverter::createSectorGeometry(const WAD::Level       &level,
 
   // Create vertices with proper texture coordinates
   for (int i = 0; i < (int)sectorVertices.size(); i++) {
-    const WAD::Vertex &vertex = level.vertices[sectorVertices[i]];
-    float              x = (static_cast<float>(vertex.x) - centerX) * SCALE;
-    float              z = (static_cast<float>(vertex.y) - centerY) * SCALE;
+    int16_t vx = level.vertex_x[sectorVertices[i]];
+    int16_t vy = level.vertex_y[sectorVertices[i]];
+    float   x  = (static_cast<float>(vx) - context.centerX) * SCALE;
+    float   z  = (static_cast<float>(vy) - context.centerY) * SCALE;
 
     // Calculate UV coordinates based on world position
-    float u = fmod((vertex.x - minX) / TEXTURE_SIZE, 1.0f);
-    float v = fmod((vertex.y - minY) / TEXTURE_SIZE, 1.0f);
+    float u = fmod((vx - minX) / TEXTURE_SIZE, 1.0f);
+    float v = fmod((vy - minY) / TEXTURE_SIZE, 1.0f);
 
     if (!isFloor) {
       v = 1.0f - v;  // Flip V coordinate for ceiling
     }
 
-    vertices.push_back(x);
-    vertices.push_back(height);
-    vertices.push_back(-z);
-    vertices.push_back(u);
-    vertices.push_back(v);
+    vertices[i] = {{x, y, -z}, {u, v}};
   }
 
-  // Create triangles using a simple triangle fan
+  // Create triangles using a simple triangle fan. The vertices are in index
+  // order, not around the sector, so each triangle is oriented on its own:
+  // counterclockwise on the map faces up, as the floor must, and the ceiling
+  // faces down
+  int64_t x0 = level.vertex_x[sectorVertices[0]];
+  int64_t y0 = level.vertex_y[sectorVertices[0]];
   for (int i = 1; i < (int)sectorVertices.size() - 1; i++) {
-    if (isFloor) {
-      // Floor - CCW winding
-      indices.push_back(baseIndex);          // Center
-      indices.push_back(baseIndex + i);      // Current
-      indices.push_back(baseIndex + i + 1);  // Next
+    int64_t x1 = level.vertex_x[sectorVertices[i]] - x0;
+    int64_t y1 = level.vertex_y[sectorVertices[i]] - y0;
+    int64_t x2 = level.vertex_x[sectorVertices[i + 1]] - x0;
+    int64_t y2 = level.vertex_y[sectorVertices[i + 1]] - y0;
+    bool    counterclockwise = x1 * y2 - y1 * x2 > 0;
+
+    unsigned int *triangle = indices + (i - 1) * 3;
+    triangle[0]            = baseIndex;  // Center
+    if (counterclockwise == isFloor) {
+      triangle[1] = baseIndex + i;      // Current
+      triangle[2] = baseIndex + i + 1;  // Next
     } else {
-      // Ceiling - Reverse winding
-      indices.push_back(baseIndex);          // Center
-      indices.push_back(baseIndex + i + 1);  // Next
-      indices.push_back(baseIndex + i);      // Current
+      triangle[1] = baseIndex + i + 1;  // Next
+      triangle[2] = baseIndex + i;      // Current
     }
   }
 }
 
-/**
- * @brief Creates a vertical wall face between two sectors with different
- * heights.
- * @param vertex1 First vertex of the wall
- * @param vertex2 Second vertex of the wall
- * @param sector1 First sector
- * @param sector2 Second sector
- * @param sidedef Sidedef containing texture information
- * @param vertices Output vertex data
- * @param indices Output index data
- */
-void WADConverter::createWallFace(const WAD::Vertex         &vertex1,
-                                  const WAD::Vertex         &vertex2,
-                                  const WAD::Sector         &sector1,
-                                  const WAD::Sector         &sector2,
-                                  const WAD::Sidedef        &sidedef,
-                                  std::vector<float>        &vertices,
-                                  std::vector<unsigned int> &indices) {
-  // Calculate normalized positions
-  float x1 = (static_cast<float>(vertex1.x) - centerX) * SCALE;
-  float z1 = (static_cast<float>(vertex1.y) - centerY) * SCALE;
-  float x2 = (static_cast<float>(vertex2.x) - centerX) * SCALE;
-  float z2 = (static_cast<float>(vertex2.y) - centerY) * SCALE;
-
-  // Get ceiling and floor heights, applying the same scale
-  float floor1 = static_cast<float>(sector1.floor_height) * SCALE;
-  float ceil1  = static_cast<float>(sector1.ceiling_height) * SCALE;
-  float floor2 = static_cast<float>(sector2.floor_height) * SCALE;
-  float ceil2  = static_cast<float>(sector2.ceiling_height) * SCALE;
-
-  // Calculate wall height and length for texture mapping
-  float wallBottom, wallTop;
-  float wallHeight;
-
-  if (sector1.ceiling_height > sector2.ceiling_height) {
-    // Upper wall section - from sector2's ceiling to sector1's ceiling
-    wallBottom = ceil2;  // Lower ceiling
-    wallTop    = ceil1;  // Higher ceiling
-    wallHeight = ceil1 - ceil2;
-  } else if (sector2.floor_height > sector1.floor_height) {
-    // Lower wall section - from lower floor to higher floor
-    wallBottom = floor1;  // Lower floor
-    wallTop    = floor2;  // Higher floor
-    wallHeight = floor2 - floor1;
-  } else {
-    // Middle wall section - use full height between sectors
-    wallBottom = std::max(floor1, floor2);
-    wallTop    = std::min(ceil1, ceil2);
-    wallHeight = wallTop - wallBottom;
-  }
-
-  float wallLength = sqrt(pow(x2 - x1, 2) + pow(z2 - z1, 2));
-
-  // Texture coordinates handling
-  const float TEXTURE_WIDTH  = 64.0f;   // Standard DOOM texture width
-  const float TEXTURE_HEIGHT = 128.0f;  // Standard DOOM texture height
-
-  // Get texture offsets from sidedef
-  float uOffset = static_cast<float>(sidedef.x_offset);
-  float vOffset = static_cast<float>(sidedef.y_offset);
-
-  // Calculate vertex indices
-  unsigned int baseIndex = vertices.size() / 5;  // 5 floats per vertex
-
-  // Calculate texture coordinates
-  float u1 = uOffset / TEXTURE_WIDTH;
-  float u2 = u1 + (wallLength / TEXTURE_WIDTH);  // Texture repeats along length
-  float v1 = vOffset / TEXTURE_HEIGHT;
-  float v2 = v1 + (wallHeight /
-                   (TEXTURE_HEIGHT * SCALE));  // Scale height for texturing
-
-  // Add vertices for the wall quad with proper texture coordinates
-  // Bottom left
-  vertices.push_back(x1);
-  vertices.push_back(wallBottom);
-  vertices.push_back(-z1);
-  vertices.push_back(u1);
-  vertices.push_back(v1);
-
-  // Top left
-  vertices.push_back(x1);
-  vertices.push_back(wallTop);
-  vertices.push_back(-z1);
-  vertices.push_back(u1);
-  vertices.push_back(v2);
-
-  // Bottom right
-  vertices.push_back(x2);
-  vertices.push_back(wallBottom);
-  vertices.push_back(-z2);
-  vertices.push_back(u2);
-  vertices.push_back(v1);
-
-  // Top right
-  vertices.push_back(x2);
-  vertices.push_back(wallTop);
-  vertices.push_back(-z2);
-  vertices.push_back(u2);
-  vertices.push_back(v2);
-
-  // Add indices for two triangles (CCW winding)
-  indices.push_back(baseIndex);      // Bottom left
-  indices.push_back(baseIndex + 1);  // Top left
-  indices.push_back(baseIndex + 2);  // Bottom right
-
-  indices.push_back(baseIndex + 1);  // Top left
-  indices.push_back(baseIndex + 3);  // Top right
-  indices.push_back(baseIndex + 2);  // Bottom right
-}
-
 /**
  * @brief Composite a patch onto a texture.
  * @param textureData The texture data to composite onto.
@@ -541,18 +1157,25 @@ void WADConverter::compositePatch(std::vector<unsigned char> &textureData,
                                   const std::vector<WAD::Color> &palette) {
   // Validate patch data
   if (patch.pixels.empty() || patch.width <= 0 || patch.height <= 0) {
-    OkLogger::error("Invalid patch data for patch " +
-                    std::string(patch.name, strnlen(patch.name, 8)));
+    LOG_ERROR("Invalid patch data for patch " << LumpName(patch.name).str());
     return;
   }
 
   // Validate texture data size
   if (textureData.size() < (size_t)(texWidth * texHeight * 4)) {
-    OkLogger::error("Invalid texture data size for patch " +
-                    std::string(patch.name, strnlen(patch.name, 8)));
+    LOG_ERROR("Invalid texture data size for patch "
+              << LumpName(patch.name).str());
     return;
   }
 
+  // Pixels past the end of a short patch buffer are skipped, reported once
+  // rather than for every pixel
+  int available = (int)std::min(patch.pixels.size(), patch.opaque.size());
+  if (available < patch.width * patch.height) {
+    LOG_ERROR("Source index out of bounds in patch "
+              << LumpName(patch.name).str());
+  }
+
   // For each pixel in the patch
   for (int x = 0; x < patch.width; x++) {
     int destX = originX + x;
@@ -568,16 +1191,16 @@ void WADConverter::compositePatch(std::vector<unsigned char> &textureData,
 
       // Calculate source and destination indices with bounds checking
       int srcIndex = y * patch.width + x;
-      if (srcIndex >= (int)patch.pixels.size()) {
-        OkLogger::error("Source index out of bounds in patch " +
-                        std::string(patch.name, strnlen(patch.name, 8)));
+      if (srcIndex >= available) {
         continue;
       }
 
+      // In bounds, destX and destY are clipped and the size checked above
       int destIndex = (destY * texWidth + destX) * 4;  // RGBA format
-      if (destIndex + 3 >= (int)textureData.size()) {
-        OkLogger::error("Destination index out of bounds in patch " +
-                        std::string(patch.name, strnlen(patch.name, 8)));
+
+      // Pixels between the column posts are transparent, they show through
+      // on masked middle textures
+      if (!patch.opaque[srcIndex]) {
         continue;
       }
 
@@ -587,46 +1210,44 @@ void WADConverter::compositePatch(std::vector<unsigned char> &textureData,
         continue;
       }
 
-      // Copy color from palette with opacity check
-      const WAD::Color &color = palette[colorIndex];
-      if (colorIndex > 0) {  // Index 0 is typically transparent
-        textureData[destIndex + 0] = color.r;
-        textureData[destIndex + 1] = color.g;
-        textureData[destIndex + 2] = color.b;
-        textureData[destIndex + 3] = 255;  // Full opacity
-      }
+      // Copy color from palette
+      const WAD::Color &color    = palette[colorIndex];
+      textureData[destIndex + 0] = color.r;
+      textureData[destIndex + 1] = color.g;
+      textureData[destIndex + 2] = color.b;
+      textureData[destIndex + 3] = 255;  // Full opacity
     }
   }
 }
 
 /**
- * @brief Create an OpenGL texture from a flat (floor/ceiling) texture name.
- * @param flatName The name of the flat texture to create.
+ * @brief Convert a flat (floor/ceiling) to RGBA pixels.
+ * @param flatName The name of the flat, for error messages.
  * @param flatData The flat data to use.
  * @param palette The color palette to use.
+ * @param textureData Filled with the 64x64 RGBA pixels.
+ * @return false if the flat does not have 64x64 pixels.
  */
-void WADConverter::createFlatTexture(const std::string             &flatName,
-                                     const WAD::FlatData           &flatData,
-                                     const std::vector<WAD::Color> &palette) {
-  // Check if texture already exists in handler
-  if (OkTextureHandler::getInstance()->getTexture(flatName)) {
-    return;
-  }
-
+bool WADConverter::convertFlat(const std::string             &flatName,
+                               const WAD::FlatData           &flatData,
+                               const std::vector<WAD::Color> &palette,
+                               std::vector<unsigned char>    &textureData) {
+  TRACE_ZONE_LUMP("WADConverter::convertFlat", LumpName(flatName));
   // DOOM flats are always 64x64
   const int FLAT_SIZE    = 64;
   const int TOTAL_PIXELS = FLAT_SIZE * FLAT_SIZE;
 
   // Validate flat data size
   if ((int)flatData.data.size() != TOTAL_PIXELS) {
-    OkLogger::error("Invalid flat size for '" + flatName +
-                    "': " + std::to_string(flatData.data.size()) +
-                    " (expected " + std::to_string(TOTAL_PIXELS) + ")");
-    return;
+    LOG_ERROR("Invalid flat size for '" << flatName
+                                        << "': " << flatData.data.size()
+                                        << " (expected " << TOTAL_PIXELS
+                                        << ")");
+    return false;
   }
 
   // Create texture data (RGBA format)
-  std::vector<unsigned char> textureData(TOTAL_PIXELS * 4, 0);
+  textureData.assign(TOTAL_PIXELS * 4, 0);
 
   // Convert flat data to RGBA using the palette
   for (int i = 0; i < TOTAL_PIXELS; i++) {
@@ -642,39 +1263,64 @@ void WADConverter::createFlatTexture(const std::string             &flatName,
     textureData[idx + 2]    = color.b;
     textureData[idx + 3]    = 255;  // Full opacity
   }
+  return true;
+}
+
+/**
+ * @brief Create an OpenGL texture from a flat (floor/ceiling) texture name.
+ * @param flatName The name of the flat texture to create.
+ * @param flatData The flat data to use.
+ * @param palette The color palette to use.
+ */
+void WADConverter::createFlatTexture(const std::string             &flatName,
+                                     const WAD::FlatData           &flatData,
+                                     const std::vector<WAD::Color> &palette) {
+  // Check if texture already exists in handler
+  if (OkTextureHandler::getInstance()->getTexture(flatName)) {
+    return;
+  }
+
+  const int                  FLAT_SIZE = 64;
+  std::vector<unsigned char> textureData;
+  if (!convertFlat(flatName, flatData, palette, textureData)) {
+    return;
+  }
 
   // Create the texture through the handler
   OkTextureHandler::getInstance()->createTextureFromRawData(
       flatName, textureData.data(), FLAT_SIZE, FLAT_SIZE, 4);
 
-  OkLogger::info("WADConverter :: Created flat texture '" + flatName +
-                 "' (64x64)");
+  LOG_DEBUG("WADConverter :: Created flat texture '" << flatName
+                                                     << "' (64x64)");
 }
 
 /**
- * @brief Create an OpenGL texture from a WAD texture definition.
+ * @brief Composite the patches of a WAD texture definition to RGBA pixels.
  * @param texDef The texture definition containing patch information.
  * @param patches The vector of patch data.
+ * @param palette The color palette to use.
+ * @param textureData Filled with width * height RGBA pixels.
+ * @return false if the definition is invalid or no patch could be used.
  */
-void WADConverter::createTextureFromDef(
-    const WAD::TextureDef &texDef, const std::vector<WAD::PatchData> &patches,
-    const std::vector<WAD::Color> &palette) {
-
-  std::string texName = OkStrings::trimFixedString(texDef.name, 8);
-
-  // Check if texture already exists in handler
-  if (OkTextureHandler::getInstance()->getTexture(texName)) {
-    return;
-  }
+bool WADConverter::compositeTexture(const WAD::TextureDef             &texDef,
+                                    const std::vector<WAD::PatchData> &patches,
+                                    const std::vector<WAD::Color>     &palette,
+                                    std::vector<unsigned char> &textureData) {
+  TRACE_ZONE_LUMP("WADConverter::compositeTexture", LumpName(texDef.name));
+  LumpName texName(texDef.name);
 
   // Basic validation
   if (texDef.width <= 0 || texDef.height <= 0 || palette.empty()) {
-    OkLogger::error("Invalid texture definition for " + texName);
-    return;
+    LOG_ERROR("Invalid texture definition for " << texName.str());
+    return false;
   }
 
-  // Create empty texture data with default color (to handle missing patches)
-  std::vector<unsigned char> textureData(texDef.width * texDef.height * 4, 128);
+  // Create empty texture data with default color (to handle missing patches),
+  // transparent so holes between patches show through on masked walls
+  textureData.assign(texDef.width * texDef.height * 4, 128);
+  for (size_t alpha = 3; alpha < textureData.size(); alpha += 4) {
+    textureData[alpha] = 0;
+  }
 
   // Count valid patches
   size_t validPatchCount = 0;
@@ -686,9 +1332,8 @@ void WADConverter::createTextureFromDef(
 
     // Skip invalid patch indices
     if (patchInfo.patch_num >= patches.size()) {
-      OkLogger::warning("Skipping invalid patch index " +
-                        std::to_string(patchInfo.patch_num) + " in texture " +
-                        texName);
+      LOG_WARNING("Skipping invalid patch index "
+                  << patchInfo.patch_num << " in texture " << texName.str());
       continue;
     }
 
@@ -698,7 +1343,7 @@ void WADConverter::createTextureFromDef(
     // Skip invalid patches but don't fail the texture
     if (patchData.pixels.empty() || patchData.width <= 0 ||
         patchData.height <= 0) {
-      OkLogger::warning("Skipping invalid patch data in texture " + texName);
+      LOG_WARNING("Skipping invalid patch data in texture " << texName.str());
       continue;
     }
 
@@ -710,44 +1355,69 @@ void WADConverter::createTextureFromDef(
                      patchInfo.origin_x, patchInfo.origin_y, palette);
       validPatchCount++;
     } catch (const std::exception &e) {
-      OkLogger::error("Error compositing patch in texture " + texName + ": " +
-                      e.what());
+      LOG_ERROR("Error compositing patch in texture " << texName.str()
+                                                        << ": " << e.what());
       continue;
     }
   }
 
-  // Create texture even if some patches failed, as long as we have valid data
-  if (hasValidPatches) {
-    OkLogger::info("WADConverter :: Creating texture '" + texName + "' (" +
-                   std::to_string(texDef.width) + "x" +
-                   std::to_string(texDef.height) +
-                   "), Valid patches: " + std::to_string(validPatchCount) +
-                   "/" + std::to_string(texDef.patches.size()));
+  // Use the texture even if some patches failed, as long as we have valid
+  // data
+  if (!hasValidPatches) {
+    LOG_ERROR("No valid patches found for texture "
+              << texName.str() << " - texture will not be created");
+    return false;
+  }
+
+  LOG_DEBUG("WADConverter :: Composited texture '"
+            << texName.str() << "' (" << texDef.width << "x" << texDef.height
+            << "), Valid patches: " << validPatchCount << "/"
+            << texDef.patches.size());
+  return true;
+}
 
+/**
+ * @brief Create an OpenGL texture from a WAD texture definition.
+ * @param texDef The texture definition containing patch information.
+ * @param patches The vector of patch data.
+ * @param palette The color palette to use.
+ */
+void WADConverter::createTextureFromDef(
+    const WAD::TextureDef &texDef, const std::vector<WAD::PatchData> &patches,
+    const std::vector<WAD::Color> &palette) {
+
+  std::string texName = LumpName(texDef.name).str();
+
+  // Check if texture already exists in handler
+  if (OkTextureHandler::getInstance()->getTexture(texName)) {
+    return;
+  }
+
+  std::vector<unsigned char> textureData;
+  if (compositeTexture(texDef, patches, palette, textureData)) {
     // Create texture using the dedicated creation method with pre-trimmed name
     OkTextureHandler::getInstance()->createTextureFromRawData(
         texName, textureData.data(), texDef.width, texDef.height, 4);
-  } else {
-    OkLogger::error("No valid patches found for texture " + texName +
-                    " - texture will not be created");
   }
 }
 
 /**
  * @brief Get the player's starting position in the level as a 3D point.
  * @param level The level to get the player start position from.
+ * @param mesh The mesh built for the level, which holds the level center.
  * @return A pointer to an OkPoint containing the player start position, or
  * nullptr if no start position exists.
  * @note The returned position represents a camera position for FPS view, with Y
  * coordinate at eye level.
  */
-OkPoint *WADConverter::getPlayerStartPosition(const WAD::Level &level) {
+OkPoint *WADConverter::getPlayerStartPosition(const WAD::Level &level,
+                                              const LevelMesh  &mesh) {
   if (!level.has_player_start)
     return nullptr;
 
   // Convert DOOM coordinates to our coordinate system
-  float x = (static_cast<float>(level.player_start.x) - centerX) * SCALE;
-  float z = (static_cast<float>(level.player_start.y) - centerY) * SCALE;
+  float x = (static_cast<float>(level.player_start.x) - mesh.centerX) * SCALE;
+  float z = (static_cast<float>(level.player_start.y) - mesh.centerY) * SCALE;
 
   // Find the sector the player is in to get the floor height
   float floorHeight = 0.0f;
@@ -2,22 +2,112 @@
 #define WAD_VIEWER_WAD_CONVERTER_HPP
 
 #include "../okinawa.cpp/src/item/item.hpp"
+#include "./compact-mesh.hpp"
+#include "./compiled-level.hpp"
+#include "./level-mesh.hpp"
+#include "./thread-pool.hpp"
 #include "./wad.hpp"
+#include <functional>
+#include <memory_resource>
 #include <vector>
 
+// Settings of a level conversion
+struct ConversionOptions {
+  // Fewest linedefs or sectors worth a task of their own
+  size_t minChunkSize = 1024;
+
+  // Merge chains of collinear walls with continuous textures into one quad
+  bool mergeWalls = true;
+
+  // Leave out sky ceilings and the upper walls between two sky sectors, and
+  // add a sky backdrop around the level instead
+  bool skipSky = true;
+
+  // One group per texture and sector instead of per texture, so a renderer
+  // can draw the level sector by sector in BSP order (see DrawOrder)
+  bool sectorGroups = false;
+};
+
 class WADConverter {
 public:
   WADConverter();
   ~WADConverter();
 
+  // Builds the level geometry without touching the engine, safe to call
+  // from several threads at once. With a pool, the linedefs and sectors of
+  // the level are split in chunks across it.
+  static LevelMesh
+  buildLevelMesh(const WAD::Level &level, ThreadPool *pool = nullptr,
+                 const ConversionOptions &options = ConversionOptions());
+
+  // Sky texture DOOM uses for a level: SKY<episode> or SKY1-3 by map number
+  static LumpName skyTextureName(const char *levelName);
+
+  // Builds the level geometry in the quantized 12-byte vertex format
+  static CompactLevelMesh buildCompactLevelMesh(const WAD::Level &level,
+                                                ThreadPool *pool = nullptr);
+
+  // Builds the geometry of every level on the thread pool, in level order
+  static std::vector<LevelMesh>
+  buildLevelMeshes(const std::vector<WAD::Level> &levels, ThreadPool &pool);
+
+  // Creates the textures and engine items, must run on the engine thread
+  std::vector<OkItem *> createLevelItems(const WAD::Level &level,
+                                         const LevelMesh  &mesh);
+
+  // Creates one engine item per masked surface, in mesh.masked order, after
+  // createLevelItems() loaded their textures
+  std::vector<OkItem *> createMaskedItems(const LevelMesh &mesh);
+
+  // RGBA pixels of a texture definition and of a flat, without touching the
+  // engine. Return false when there is nothing to show.
+  static bool compositeTexture(const WAD::TextureDef             &texDef,
+                               const std::vector<WAD::PatchData> &patches,
+                               const std::vector<WAD::Color>     &palette,
+                               std::vector<unsigned char> &textureData);
+  static bool convertFlat(const std::string             &flatName,
+                          const WAD::FlatData           &flatData,
+                          const std::vector<WAD::Color> &palette,
+                          std::vector<unsigned char>    &textureData);
+
   std::vector<OkItem *> createLevelGeometry(const WAD::Level &level);
-  OkPoint              *getPlayerStartPosition(const WAD::Level &level);
+  OkPoint *getPlayerStartPosition(const WAD::Level &level,
+                                  const LevelMesh  &mesh);
 
 private:
-  static float       centerX;
-  static float       centerY;
   static const float SCALE;
 
+  // Sides of the sky backdrop cylinder
+  static const int SKY_SEGMENTS = 16;
+
+  // Output groups of a conversion: one per texture id, or one per texture
+  // and sector pair in use. Slots are in texture name order, then sector
+  // order, and slot 0 is NO_TEXTURE.
+  struct GroupTable {
+    explicit GroupTable(std::pmr::memory_resource *arena)
+        : texture(arena), sector(arena), sectorFirst(arena), bySector(arena) {}
+
+    std::pmr::vector<uint16_t> texture;  // Texture id of each slot
+    std::pmr::vector<uint16_t> sector;   // Sector of each slot or NO_SECTOR
+
+    // Slots of sector s are bySector[sectorFirst[s]] up to sectorFirst[s + 1]
+    // sorted by texture id, empty when groups are not split by sector
+    std::pmr::vector<uint32_t> sectorFirst;
+    std::pmr::vector<uint32_t> bySector;
+
+    size_t   size() const { return texture.size(); }
+    uint32_t slot(uint16_t textureId, uint16_t sectorIndex) const;
+  };
+
+  // State of a single conversion, passed to every geometry helper
+  struct Context {
+    const CompiledLevel     &level;
+    const ConversionOptions &options;
+    const GroupTable        &groups;
+    float                    centerX;  // Level center, subtracted from vertices
+    float                    centerY;
+  };
+
   /**
    * @brief Check if a point is inside a sector boundary line.
    * Uses a cross product to determine which side of the line the point is on.
@@ -37,29 +127,118 @@ private:
     return crossProduct > 0;
   }
 
-  void createWallSection(const WAD::Vertex &vertex1, const WAD::Vertex &vertex2,
-                         float bottomHeight, float topHeight,
-                         const WAD::Sidedef        &sidedef,
-                         std::vector<float>        &vertices,
-                         std::vector<unsigned int> &indices);
+  // Wall quad recorded by the counting pass, emitted by the fill pass
+  struct WallQuad {
+    uint16_t texture;
+    uint16_t vertex1;
+    uint16_t vertex2;
+    uint16_t sidedef;
+    float    bottom;
+    float    top;
+    uint32_t group;  // Slot in the GroupTable
+  };
+
+  // Middle section of a two-sided linedef, kept out of the texture groups
+  struct MaskedWall {
+    WallQuad quad;
+    uint16_t linedef;
+    uint16_t side;  // 0 right, 1 left
+  };
+
+  // Vertex and index count of a texture group
+  struct GroupSize {
+    size_t vertexCount = 0;
+    size_t indexCount  = 0;
+  };
+
+  // Vertex of a sector boundary, found while walking the linedefs
+  struct SectorVertex {
+    uint16_t sector;
+    uint16_t vertex;
+  };
+
+  // Range of linedefs or sectors processed as one task. Chunks fill their
+  // lists on different threads, so each one has an arena of its own.
+  struct Chunk {
+    Chunk()
+        : quads(&arena), masked(&arena), sectorVertices(&arena),
+          sizes(&arena), offsets(&arena) {}
+
+    Chunk(const Chunk &)            = delete;
+    Chunk &operator=(const Chunk &) = delete;
+
+    std::pmr::monotonic_buffer_resource arena;
+
+    size_t                         begin = 0;
+    size_t                         end   = 0;
+    std::pmr::vector<WallQuad>     quads;           // Linedef chunks only
+    std::pmr::vector<MaskedWall>   masked;          // Linedef chunks only
+    std::pmr::vector<SectorVertex> sectorVertices;  // Linedef chunks only
+    std::pmr::vector<GroupSize>    sizes;    // Size of the chunk in each group
+    std::pmr::vector<GroupSize>    offsets;  // Write position in each group,
+                                             // advanced by the fill pass
+  };
+
+  // Vertex indices of each sector, in the scratch arena of the conversion
+  typedef std::pmr::vector<std::pmr::vector<int>> SectorVertexLists;
+
+  static GroupTable buildGroupTable(const CompiledLevel        &level,
+                                    bool                        sectorGroups,
+                                    std::pmr::memory_resource *scratch);
+
+  static std::vector<Chunk> splitChunks(size_t count, ThreadPool *pool,
+                                        size_t minChunkSize);
+  static void               runChunks(size_t chunkCount, ThreadPool *pool,
+                                      const std::function<void(size_t)> &task);
+
+  static void   countWalls(const Context &context, Chunk &chunk);
+  static size_t mergeWalls(const CompiledLevel        &level,
+                           std::vector<Chunk>         &chunks,
+                           std::pmr::memory_resource *scratch);
+  static bool   canMergeWalls(const CompiledLevel &level, const WallQuad &first,
+                              const WallQuad &second);
+  static uint16_t ceilingTexture(const Context &context, size_t sector);
+  static void countFlats(const Context     &context,
+                         SectorVertexLists &sectorVertices, Chunk &chunk);
+  static void fillWalls(const Context &context, Chunk &chunk,
+                        std::pmr::vector<LevelMesh::Group> &groups);
+  static void fillFlats(const Context                      &context,
+                        const SectorVertexLists            &sectorVertices,
+                        Chunk                              &chunk,
+                        std::pmr::vector<LevelMesh::Group> &groups);
+
+  static void addSideWalls(const Context &context, uint16_t linedef,
+                           uint16_t side, uint16_t frontSector,
+                           uint16_t backSector, uint16_t vertex1,
+                           uint16_t vertex2, Chunk &chunk);
+
+  static void addWallSection(const Context &context, uint16_t texture,
+                             uint16_t vertex1, uint16_t vertex2,
+                             float bottomHeight, float topHeight,
+                             uint16_t sidedef, Chunk &chunk);
+
+  static void createWallSection(const Context &context, const WallQuad &quad,
+                                LevelMesh::Vertex *vertices,
+                                unsigned int *indices, unsigned int baseIndex);
 
-  void createSectorGeometry(const WAD::Level &level, const WAD::Sector &sector,
-                            const std::vector<int>    &sectorVertices,
-                            std::vector<float>        &vertices,
-                            std::vector<unsigned int> &indices, bool isFloor);
+  static void addSkyBackdrop(const Context &context, LumpName texture,
+                             LevelMesh &mesh);
 
-  void createWallFace(const WAD::Vertex &vertex1, const WAD::Vertex &vertex2,
-                      const WAD::Sector &sector1, const WAD::Sector &sector2,
-                      const WAD::Sidedef &sidedef, std::vector<float> &vertices,
-                      std::vector<unsigned int> &indices);
+  static void createSectorGeometry(const Context &context, int16_t height,
+                                   const std::pmr::vector<int> &sectorVertices,
+                                   bool isFloor, LevelMesh::Vertex *vertices,
+                                   unsigned int *indices,
+                                   unsigned int  baseIndex);
 
   void createTextureFromDef(const WAD::TextureDef             &texDef,
                             const std::vector<WAD::PatchData> &patches,
                             const std::vector<WAD::Color>     &palette);
 
-  void compositePatch(std::vector<unsigned char> &textureData, int texWidth,
-                      int texHeight, const WAD::PatchData &patch, int originX,
-                      int originY, const std::vector<WAD::Color> &palette);
+  static void compositePatch(std::vector<unsigned char> &textureData,
+                             int texWidth, int texHeight,
+                             const WAD::PatchData &patch, int originX,
+                             int                            originY,
+                             const std::vector<WAD::Color> &palette);
 
   void createFlatTexture(const std::string             &flatName,
                          const WAD::FlatData           &flatData,
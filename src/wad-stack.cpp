@@ -0,0 +1,382 @@
+#include "wad-stack.hpp"
+#include "./log.hpp"
+#include "./trace.hpp"
+#include <cstring>
+#include <memory_resource>
+#include <set>
+#include <utility>
+
+/**
+ * @brief WADStack constructor
+ * @param verbose Print information about every WAD added to the stack
+ */
+WADStack::WADStack(bool verbose) {
+  verbose_ = verbose;
+}
+
+/**
+ * @brief Add a WAD file on top of the stack
+ * @param filepath Path to the WAD file
+ * @throws std::runtime_error if the file cannot be opened or is not a valid WAD
+ * file
+ * @note Lumps in this WAD replace lumps with the same name in the WADs that
+ *       were added before it.
+ */
+void WADStack::addWAD(const std::string &filepath) {
+  TRACE_ZONE("WADStack::addWAD");
+  wads_.push_back(std::unique_ptr<WAD>(new WAD(filepath, verbose_)));
+  indexWAD(static_cast<uint32_t>(wads_.size() - 1));
+  LOG_INFO("WADStack :: Added " << filepath << " ("
+                                << wads_.back()->getDirectory().size()
+                                << " lumps)");
+}
+
+/**
+ * @brief Add every lump of a WAD to the combined index
+ * @param wadIndex Index of the WAD in the stack
+ * @note Entries are overwritten in directory order, so the last lump with a
+ *       given name wins, both inside a WAD and across the stack.
+ */
+void WADStack::indexWAD(uint32_t wadIndex) {
+  const std::vector<WAD::Directory> &directory =
+      wads_[wadIndex]->getDirectory();
+
+  index_.reserve(index_.size() + directory.size());
+  for (uint32_t i = 0; i < directory.size(); i++) {
+    index_[LumpName(directory[i].name)] = LumpRef{wadIndex, i};
+  }
+}
+
+/**
+ * @brief Find the topmost lump with the given name
+ * @param name Lump name
+ * @param ref Reference to the lump, set only if the lump is found
+ * @return true if the lump is found, false otherwise
+ */
+bool WADStack::findLump(LumpName name, LumpRef &ref) const {
+  std::unordered_map<LumpName, LumpRef>::const_iterator it = index_.find(name);
+  if (it == index_.end()) {
+    return false;
+  }
+  ref = it->second;
+  return true;
+}
+
+/**
+ * @brief Find the last lump with the given name inside a single WAD
+ * @param wadIndex Index of the WAD in the stack
+ * @param name Lump name
+ * @param lumpIndex Index of the lump in the WAD directory
+ * @return true if the lump is found, false otherwise
+ */
+bool WADStack::findLumpInWAD(uint32_t wadIndex, LumpName name,
+                             uint32_t &lumpIndex) const {
+  const std::vector<WAD::Directory> &directory =
+      wads_[wadIndex]->getDirectory();
+
+  for (size_t i = directory.size(); i > 0; i--) {
+    if (LumpName(directory[i - 1].name) == name) {
+      lumpIndex = static_cast<uint32_t>(i - 1);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief Merge the TEXTURE1/TEXTURE2 definitions of every WAD in the stack
+ * @note Each texture definition refers to patches by their index in the PNAMES
+ *       lump of its own WAD (or of the closest WAD below it). Those indices are
+ *       remapped to a single merged patch name list, and textures defined again
+ *       in a later WAD replace the earlier definition with the same name.
+ */
+void WADStack::mergeTextures() {
+  TRACE_ZONE("WADStack::mergeTextures");
+  std::unordered_map<LumpName, uint16_t> patchSlots;
+  std::unordered_map<LumpName, size_t>   textureSlots;
+  std::vector<std::string>               layerPatchNames;
+
+  patchNames_.clear();
+  textureDefs_.clear();
+
+  const char *textureLumps[] = {"TEXTURE1", "TEXTURE2"};
+
+  for (uint32_t w = 0; w < wads_.size(); w++) {
+    WAD                               &wad       = *wads_[w];
+    const std::vector<WAD::Directory> &directory = wad.getDirectory();
+    uint32_t                           lumpIndex;
+
+    if (findLumpInWAD(w, "PNAMES", lumpIndex)) {
+      layerPatchNames = wad.readPatchNames(directory[lumpIndex].filepos,
+                                           directory[lumpIndex].size);
+    }
+
+    for (size_t t = 0; t < 2; t++) {
+      if (!findLumpInWAD(w, textureLumps[t], lumpIndex)) {
+        continue;
+      }
+
+      std::vector<WAD::TextureDef> defs = wad.readTextureDefs(
+          directory[lumpIndex].filepos, directory[lumpIndex].size);
+
+      for (size_t i = 0; i < defs.size(); i++) {
+        WAD::TextureDef &tex = defs[i];
+
+        // Remap patch numbers from this layer's PNAMES to the merged list
+        for (size_t j = 0; j < tex.patches.size(); j++) {
+          uint16_t patchNum = tex.patches[j].patch_num;
+          if (patchNum >= layerPatchNames.size()) {
+            tex.patches[j].patch_num = 0xFFFF;
+            continue;
+          }
+
+          LumpName patchName(layerPatchNames[patchNum]);
+          std::unordered_map<LumpName, uint16_t>::iterator slot =
+              patchSlots.find(patchName);
+          if (slot == patchSlots.end()) {
+            uint16_t mergedNum = static_cast<uint16_t>(patchNames_.size());
+            slot =
+                patchSlots.insert(std::make_pair(patchName, mergedNum)).first;
+            patchNames_.push_back(patchName);
+          }
+          tex.patches[j].patch_num = slot->second;
+        }
+
+        // Last definition of a texture wins, keeping its original position
+        LumpName texName(tex.name);
+        std::unordered_map<LumpName, size_t>::iterator slot =
+            textureSlots.find(texName);
+        if (slot == textureSlots.end()) {
+          textureSlots[texName] = textureDefs_.size();
+          textureDefs_.push_back(tex);
+        } else {
+          textureDefs_[slot->second] = tex;
+        }
+      }
+    }
+  }
+
+  LOG_INFO("WADStack :: Merged " << textureDefs_.size() << " textures using "
+                                 << patchNames_.size() << " patches");
+}
+
+/**
+ * @brief Load the patches referenced by the merged texture definitions
+ * @note patches_ is indexed by merged patch number, so patch_num in the merged
+ *       texture definitions can be used directly. Missing patches are left
+ *       empty and skipped when the texture is composited.
+ */
+void WADStack::loadPatches() {
+  TRACE_ZONE("WADStack::loadPatches");
+  std::vector<bool> requiredPatches(patchNames_.size(), false);
+  for (size_t i = 0; i < textureDefs_.size(); i++) {
+    const WAD::TextureDef &tex = textureDefs_[i];
+    for (size_t j = 0; j < tex.patches.size(); j++) {
+      if (tex.patches[j].patch_num < requiredPatches.size()) {
+        requiredPatches[tex.patches[j].patch_num] = true;
+      }
+    }
+  }
+
+  patches_.clear();
+  patches_.resize(patchNames_.size());
+
+  size_t loaded = 0;
+  for (size_t p = 0; p < patchNames_.size(); p++) {
+    patchNames_[p].copyTo(patches_[p].name);
+
+    LumpRef ref;
+    if (!requiredPatches[p] || !findLump(patchNames_[p], ref)) {
+      continue;
+    }
+
+    // A corrupt patch is left empty and skipped when compositing textures
+    WAD                  &wad   = *wads_[ref.wadIndex];
+    const WAD::Directory &entry = wad.getDirectory()[ref.lumpIndex];
+    try {
+      patches_[p] =
+          wad.readPatch(entry.filepos, entry.size, patchNames_[p].str());
+      loaded++;
+    } catch (const std::runtime_error &e) {
+      LOG_WARNING("WADStack :: Skipping patch: " << e.what());
+    }
+  }
+
+  LOG_INFO("WADStack :: Loaded " << loaded << " patches");
+}
+
+/**
+ * @brief Load all unique flats referenced by the sectors of a level
+ * @param level Level whose flats are loaded
+ */
+void WADStack::loadFlats(WAD::Level &level) {
+  TRACE_ZONE_LUMP("WADStack::loadFlats", LumpName(level.name));
+  // The set only lives for this call, its nodes come from a buffer on the
+  // stack that holds a typical level's flats
+  unsigned char                       nodes[4096];
+  std::pmr::monotonic_buffer_resource arena(nodes, sizeof(nodes));
+  std::pmr::set<LumpName>             uniqueFlats(&arena);
+  for (size_t j = 0; j < level.sectors.size(); j++) {
+    LumpName floorTex(level.sectors[j].floor_texture);
+    LumpName ceilTex(level.sectors[j].ceiling_texture);
+
+    if (!floorTex.isNoTexture()) {
+      uniqueFlats.insert(floorTex);
+    }
+    if (!ceilTex.isNoTexture()) {
+      uniqueFlats.insert(ceilTex);
+    }
+  }
+
+  level.flats.reserve(uniqueFlats.size());
+  for (std::pmr::set<LumpName>::iterator it = uniqueFlats.begin();
+       it != uniqueFlats.end(); ++it) {
+    LumpRef ref;
+    if (!findLump(*it, ref)) {
+      continue;
+    }
+
+    std::vector<uint8_t> flatData =
+        wads_[ref.wadIndex]->readLump(ref.lumpIndex);
+    if (flatData.size() == 64 * 64) {  // DOOM flats are always 64x64
+      WAD::FlatData flat;
+      it->copyTo(flat.name);
+      flat.data = std::move(flatData);
+      level.flats.push_back(std::move(flat));
+    }
+  }
+}
+
+/**
+ * @brief Process every WAD in the stack and build the levels
+ * @throws std::runtime_error if any of the lumps cannot be read
+ * @note A level defined in several WADs is taken entirely from the topmost
+ *       one, while textures, patches, flats and the palette are resolved lump
+ *       by lump across the whole stack.
+ */
+void WADStack::processStack() {
+  TRACE_ZONE("WADStack::processStack");
+  LumpRef ref;
+
+  palette_.clear();
+  if (findLump("PLAYPAL", ref)) {
+    WAD                  &wad   = *wads_[ref.wadIndex];
+    const WAD::Directory &entry = wad.getDirectory()[ref.lumpIndex];
+    palette_                    = wad.readPalette(entry.filepos, entry.size);
+  }
+
+  mergeTextures();
+  loadPatches();
+
+  // Collect level markers, in order of first appearance, from the topmost WAD
+  std::vector<LumpRef>                 markers;
+  std::unordered_map<LumpName, size_t> markerSlots;
+  for (uint32_t w = 0; w < wads_.size(); w++) {
+    const std::vector<WAD::Directory> &directory = wads_[w]->getDirectory();
+    for (uint32_t i = 0; i < directory.size(); i++) {
+      LumpName lumpName(directory[i].name);
+      if (!wads_[w]->isLevelMarker(lumpName)) {
+        continue;
+      }
+
+      std::unordered_map<LumpName, size_t>::iterator slot =
+          markerSlots.find(lumpName);
+      if (slot == markerSlots.end()) {
+        markerSlots[lumpName] = markers.size();
+        markers.push_back(LumpRef{w, i});
+      } else {
+        markers[slot->second] = LumpRef{w, i};
+      }
+    }
+  }
+
+  // Levels keep the PNAMES entries as strings
+  std::vector<std::string> patchNames(patchNames_.size());
+  for (size_t p = 0; p < patchNames_.size(); p++) {
+    patchNames[p] = patchNames_[p].str();
+  }
+
+  levels_.clear();
+  levels_.reserve(markers.size());
+  for (size_t m = 0; m < markers.size(); m++) {
+    WAD &wad = *wads_[markers[m].wadIndex];
+
+    WAD::Level level;
+    LumpName(wad.getDirectory()[markers[m].lumpIndex].name).copyTo(level.name);
+    LOG_DEBUG("WADStack :: Building level " << LumpName(level.name).str());
+    level.texture_defs = textureDefs_;
+    level.patches      = patches_;
+    level.patch_names  = patchNames;
+    level.palette      = palette_;
+
+    wad.readLevelGeometry(markers[m].lumpIndex, level);
+    loadFlats(level);
+
+    levels_.push_back(std::move(level));
+  }
+
+  LOG_INFO("WADStack :: Built " << levels_.size() << " levels");
+}
+
+/**
+ * @brief Get a level by name
+ * @param name Name of the level
+ * @return Level object
+ * @throws std::runtime_error if the level is not found
+ */
+WAD::Level WADStack::getLevel(std::string name) const {
+  for (size_t i = 0; i < levels_.size(); i++) {
+    if (strncmp(levels_[i].name, name.c_str(), 8) == 0) {
+      return levels_[i];
+    }
+  }
+
+  throw std::runtime_error("Level not found");
+}
+
+/**
+ * @brief Get the name of a level by index
+ * @param index Index of the level
+ * @return Name of the level
+ * @throws std::out_of_range if the index is out of range
+ */
+std::string WADStack::getLevelNameByIndex(size_t index) const {
+  if (index < levels_.size()) {
+    return std::string(levels_[index].name, strnlen(levels_[index].name, 8));
+  } else {
+    throw std::out_of_range("Index out of range");
+  }
+}
+
+/**
+ * @brief Get the number of levels in the stack
+ * @return Number of levels
+ */
+size_t WADStack::getLevelCount() const {
+  return levels_.size();
+}
+
+/**
+ * @brief Measure the memory held by the stack
+ * @return Bytes of the directories, the index, the merged resources and the
+ *         assets of every level
+ * @note Each level holds its own copy of the merged resources, so the level
+ *       assets repeat the stack totals once per level.
+ */
+WADStack::Footprint WADStack::footprint() const {
+  Footprint footprint;
+  for (size_t w = 0; w < wads_.size(); w++) {
+    footprint.directories += MemoryFootprint::of(wads_[w]->getDirectory());
+  }
+  footprint.index       = MemoryFootprint::of(index_);
+  footprint.palette     = MemoryFootprint::of(palette_);
+  footprint.patchNames  = MemoryFootprint::of(patchNames_);
+  footprint.textureDefs = MemoryFootprint::of(textureDefs_);
+  footprint.patches     = MemoryFootprint::of(patches_);
+
+  for (size_t i = 0; i < levels_.size(); i++) {
+    footprint.levels.push_back(LevelAssetFootprint::of(levels_[i]));
+  }
+  return footprint;
+}
@@ -0,0 +1,82 @@
+#ifndef WAD_VIEWER_WAD_STACK_HPP
+#define WAD_VIEWER_WAD_STACK_HPP
+
+#include "./lump-name.hpp"
+#include "./memory-footprint.hpp"
+#include "./wad.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Layered set of WAD files (an IWAD plus any number of PWADs).
+ *
+ * Lumps are resolved last-wins: a lump in a WAD added later replaces any lump
+ * with the same name in the WADs below it. The combined index only stores
+ * references to the directory entries of each file, lump data is read on
+ * demand from the WAD that owns it.
+ */
+class WADStack {
+public:
+  explicit WADStack(bool verbose = false);
+
+  // Add a WAD on top of the stack (the first one is usually the IWAD)
+  void addWAD(const std::string &filepath);
+
+  // Build the levels, merging textures and patches from every layer
+  void processStack();
+
+  WAD::Level  getLevel(std::string name) const;
+  std::string getLevelNameByIndex(size_t index) const;
+  size_t      getLevelCount() const;
+
+  // Reference to the directory entry of a lump inside one of the WADs
+  struct LumpRef {
+    uint32_t wadIndex;   // Index of the WAD in the stack
+    uint32_t lumpIndex;  // Index of the lump in that WAD's directory
+  };
+
+  // O(1) lookup of the topmost lump with the given name
+  bool findLump(LumpName name, LumpRef &ref) const;
+
+  // Heap bytes held by the stack, by structure
+  struct Footprint {
+    MemoryFootprint directories;  // Directory of every WAD
+    MemoryFootprint index;        // Combined lump index, estimated
+    MemoryFootprint palette;
+    MemoryFootprint patchNames;
+    MemoryFootprint textureDefs;
+    MemoryFootprint patches;
+
+    // Assets each level holds, in level index order
+    std::vector<LevelAssetFootprint> levels;
+  };
+
+  Footprint footprint() const;
+
+private:
+  bool                              verbose_;
+  std::vector<std::unique_ptr<WAD>> wads_;
+
+  // Combined index: lump name -> topmost lump with that name
+  std::unordered_map<LumpName, LumpRef> index_;
+
+  // Merged resources shared by every level
+  std::vector<WAD::Color>      palette_;
+  std::vector<LumpName>        patchNames_;   // merged PNAMES
+  std::vector<WAD::TextureDef> textureDefs_;  // merged TEXTURE1/TEXTURE2
+  std::vector<WAD::PatchData>  patches_;      // indexed like patchNames_
+
+  std::vector<WAD::Level> levels_;
+
+  void indexWAD(uint32_t wadIndex);
+  bool findLumpInWAD(uint32_t wadIndex, LumpName name,
+                     uint32_t &lumpIndex) const;
+  void mergeTextures();
+  void loadPatches();
+  void loadFlats(WAD::Level &level);
+};
+
+#endif  // WAD_VIEWER_WAD_STACK_HPP
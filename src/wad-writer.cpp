@@ -0,0 +1,88 @@
+#include "wad-writer.hpp"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+/**
+ * @brief Create an empty WAD
+ * @param type "IWAD" or "PWAD", the first 4 characters are used
+ */
+WADWriter::WADWriter(const char *type) { std::memcpy(type_, type, 4); }
+
+/**
+ * @brief Append a lump
+ * @param name Lump name
+ * @param data Contents of the lump
+ * @param size Size of the contents in bytes
+ * @throws std::runtime_error if the WAD would grow past 4 GB
+ */
+void WADWriter::addLump(LumpName name, const uint8_t *data, std::size_t size) {
+  uint64_t filepos = WAD::Header::RECORD_SIZE + data_.size();
+  if (filepos + size > UINT32_MAX) {
+    throw std::runtime_error("WAD too large for 32-bit lump offsets");
+  }
+
+  WAD::Directory entry;
+  entry.filepos = static_cast<uint32_t>(filepos);
+  entry.size    = static_cast<uint32_t>(size);
+  name.copyTo(entry.name);
+  directory_.push_back(entry);
+  data_.insert(data_.end(), data, data + size);
+}
+
+/**
+ * @brief Append a lump
+ * @param name Lump name
+ * @param data Contents of the lump
+ */
+void WADWriter::addLump(LumpName name, const std::vector<uint8_t> &data) {
+  addLump(name, data.data(), data.size());
+}
+
+/**
+ * @brief Append an empty lump, such as a level marker or F_START
+ * @param name Lump name
+ */
+void WADWriter::addMarker(LumpName name) { addLump(name, nullptr, 0); }
+
+/**
+ * @brief Get the size of the file
+ * @return Header, lump contents and directory, in bytes
+ */
+std::size_t WADWriter::size() const {
+  return WAD::Header::RECORD_SIZE + data_.size() +
+         directory_.size() * WAD::Directory::RECORD_SIZE;
+}
+
+/**
+ * @brief Save the WAD
+ * @param path Path of the file to write
+ * @throws std::runtime_error if the file cannot be written
+ */
+void WADWriter::write(const std::string &path) const {
+  // The directory goes after the lumps
+  uint32_t directoryOffset =
+      static_cast<uint32_t>(WAD::Header::RECORD_SIZE + data_.size());
+
+  WAD::Header header;
+  std::memcpy(header.identification, type_, 4);
+  header.numlumps     = static_cast<uint32_t>(directory_.size());
+  header.infotableofs = directoryOffset;
+  uint8_t headerBytes[WAD::Header::RECORD_SIZE];
+  header.encode(headerBytes);
+
+  std::vector<uint8_t> directory(directory_.size() *
+                                 WAD::Directory::RECORD_SIZE);
+  for (std::size_t i = 0; i < directory_.size(); i++) {
+    directory_[i].encode(&directory[i * WAD::Directory::RECORD_SIZE]);
+  }
+
+  std::ofstream file(path.c_str(), std::ios::binary);
+  file.write(reinterpret_cast<const char *>(headerBytes), sizeof(headerBytes));
+  file.write(reinterpret_cast<const char *>(data_.data()), data_.size());
+  file.write(reinterpret_cast<const char *>(directory.data()),
+             directory.size());
+  if (!file) {
+    throw std::runtime_error("Could not write WAD file: " + path);
+  }
+}
@@ -0,0 +1,51 @@
+#ifndef WAD_VIEWER_WAD_WRITER_HPP
+#define WAD_VIEWER_WAD_WRITER_HPP
+
+#include "./lump-name.hpp"
+#include "./wad.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Builds a WAD file in memory, lump by lump, and saves it.
+ *
+ * Used to write test data for the benchmarks: lumps are stored in the order
+ * they are added, followed by the directory, as the DOOM tools lay them out.
+ */
+class WADWriter {
+public:
+  // type is "IWAD" or "PWAD"
+  explicit WADWriter(const char *type = "PWAD");
+
+  // Add a lump with the given contents, or an empty marker lump
+  void addLump(LumpName name, const uint8_t *data, std::size_t size);
+  void addLump(LumpName name, const std::vector<uint8_t> &data);
+  void addMarker(LumpName name);
+
+  // Add a lump of level records (WAD::Vertex, WAD::Linedef...), encoded
+  // with their on-disk layout
+  template <typename T>
+  void addRecords(LumpName name, const std::vector<T> &records) {
+    std::vector<uint8_t> data(records.size() * T::RECORD_SIZE);
+    for (std::size_t i = 0; i < records.size(); i++) {
+      records[i].encode(&data[i * T::RECORD_SIZE]);
+    }
+    addLump(name, data);
+  }
+
+  std::size_t lumpCount() const { return directory_.size(); }
+
+  // Bytes the file will take
+  std::size_t size() const;
+
+  void write(const std::string &path) const;
+
+private:
+  char                        type_[4];
+  std::vector<uint8_t>        data_;  // Lump contents, after the header
+  std::vector<WAD::Directory> directory_;
+};
+
+#endif  // WAD_VIEWER_WAD_WRITER_HPP
@@ -1,10 +1,13 @@
 #include "wad.hpp"
+#include "./log.hpp"
+#include "./lump-reader.hpp"
+#include "./trace.hpp"
 #include "../okinawa.cpp/src/utils/strings.hpp"
 #include <fstream>
-#include <iostream>
 #include <nlohmann/json.hpp>
 #include <set>
 #include <sstream>
+#include <unordered_map>
 
 /**
  * @brief WAD constructor
@@ -13,20 +16,22 @@
  * file
  */
 WAD::WAD(const std::string &filepath, bool verbose) {
+  TRACE_ZONE("WAD::open");
   filepath_ = filepath;
   verbose_  = verbose;
 
-  std::ifstream file(filepath_, std::ios::binary);
-
-  if (!file) {
+  // Map the whole file: lumps are read or viewed directly from the mapping
+  try {
+    file_.reset(new MappedFile(filepath_));
+  } catch (const std::runtime_error &) {
     throw std::runtime_error("Unable to open WAD file: " + filepath_);
   }
 
   // Read header
-  file.read(reinterpret_cast<char *>(&header_), sizeof(Header));
-  if (!file) {
+  if (file_->size() < Header::RECORD_SIZE) {
     throw std::runtime_error("Unable to read WAD header");
   }
+  header_ = Header::decode(file_->data());
 
   // Verify WAD type
   std::string id(header_.identification, 4);
@@ -35,8 +40,8 @@ WAD::WAD(const std::string &filepath, bool verbose) {
   }
 
   if (verbose_) {
-    std::cout << "WAD type: " << id << std::endl;
-    std::cout << "Num lumps: " << header_.numlumps << std::endl;
+    LOG_INFO("WAD type: " << id);
+    LOG_INFO("Num lumps: " << header_.numlumps);
   }
 
   // Read directory
@@ -48,37 +53,31 @@ WAD::WAD(const std::string &filepath, bool verbose) {
  * @throws std::runtime_error if the directory cannot be read
  */
 void WAD::readDirectory() {
-  // Open the WAD file in binary mode.
-  std::ifstream file(filepath_, std::ios::binary);
-
-  // Move the file read position to the start of the directory, using the
-  // offset from the header (header_.infotableofs).
-  file.seekg(header_.infotableofs);
+  // The directory starts at the offset from the header (header_.infotableofs)
+  // and has one fixed-size record (16 bytes) per lump (header_.numlumps).
+  const uint8_t *data = file_->range(
+      header_.infotableofs,
+      static_cast<uint64_t>(header_.numlumps) * Directory::RECORD_SIZE);
 
-  // Prepare the directory_ vector to hold all directory entries. The number of
-  // entries is specified in the header (header_.numlumps).
+  // Decode the entire directory into memory at once.
   directory_.resize(header_.numlumps);
-
-  // Read the entire directory into memory: each lump has a fixed-size record
-  // (16 bytes), and we read all of them at once.
-  file.read(reinterpret_cast<char *>(directory_.data()),
-            header_.numlumps * sizeof(Directory));
+  for (uint32_t i = 0; i < header_.numlumps; i++) {
+    directory_[i] = Directory::decode(data + i * Directory::RECORD_SIZE);
+  }
 }
 
-bool WAD::isLevelMarker(const std::string &name) const {
-  std::string cleanName = OkStrings::trimFixedString(name, 8);
+bool WAD::isLevelMarker(LumpName name) const {
+  size_t length = name.length();
 
   // DOOM 1 level names are ExMy (x = episode, y = mission)
-  if (cleanName.length() == 4 && cleanName[0] == 'E' && cleanName[2] == 'M' &&
-      std::isdigit(cleanName[1]) && std::isdigit(cleanName[3])) {
-    std::cout << "WAD :: Found DOOM1 level in WAD file: " << cleanName << "\n";
+  if (length == 4 && name[0] == 'E' && name[2] == 'M' &&
+      std::isdigit(name[1]) && std::isdigit(name[3])) {
     return true;
   }
 
   // DOOM 2 level names are MAPxx (xx = 01-32)
-  if (cleanName.length() == 5 && cleanName.substr(0, 3) == "MAP" &&
-      std::isdigit(cleanName[3]) && std::isdigit(cleanName[4])) {
-    std::cout << "WAD :: Found DOOM2 level in WAD file: " << cleanName << "\n";
+  if (length == 5 && name[0] == 'M' && name[1] == 'A' && name[2] == 'P' &&
+      std::isdigit(name[3]) && std::isdigit(name[4])) {
     return true;
   }
 
@@ -93,18 +92,20 @@ bool WAD::isLevelMarker(const std::string &name) const {
  * @param startIndex Index to start searching from
  * @return true if the lump is found, false otherwise
  */
-bool WAD::findLump(const std::string &name, uint32_t &offset, uint32_t &size,
+bool WAD::findLump(LumpName name, uint32_t &offset, uint32_t &size,
                    size_t startIndex) const {
+  // Level data lumps are only searched up to the next level marker
+  bool isLevelLump = name == "VERTEXES" || name == "LINEDEFS" ||
+                     name == "SIDEDEFS" || name == "SECTORS" ||
+                     name == "THINGS" || name == "SEGS" ||
+                     name == "SSECTORS" || name == "NODES";
+
   for (size_t i = startIndex; i < directory_.size(); i++) {
-    std::string lumpName = OkStrings::trimFixedString(directory_[i].name, 8);
+    LumpName lumpName(directory_[i].name);
 
     // Stop searching for level data at next level marker
-    if (name == "VERTEXES" || name == "LINEDEFS" || name == "SIDEDEFS" ||
-        name == "SECTORS" || name == "THINGS") {
-      // Only stop if we're after a level marker and find another one
-      if (i > startIndex && isLevelMarker(lumpName)) {
-        break;
-      }
+    if (isLevelLump && i > startIndex && isLevelMarker(lumpName)) {
+      break;
     }
 
     if (lumpName == name) {
@@ -125,134 +126,176 @@ bool WAD::findLump(const std::string &name, uint32_t &offset, uint32_t &size,
  * @throws std::runtime_error if the lump cannot be read
  */
 std::vector<uint8_t> WAD::readLump(std::streamoff offset, std::size_t size) {
-  std::vector<uint8_t> data(size);
-  std::ifstream        file(filepath_, std::ios::binary);
-  if (!file) {
-    throw std::runtime_error("Unable to open file: " + filepath_);
-  }
-  file.seekg(offset);
-  file.read(reinterpret_cast<char *>(data.data()), size);
-  return data;
+  const uint8_t *data = file_->range(offset, size);
+  return std::vector<uint8_t>(data, data + size);
+}
+
+/**
+ * @brief Read a lump from the WAD file by its directory index
+ * @param index Index of the lump in the directory
+ * @return Vector containing the lump data
+ * @throws std::out_of_range if the index is out of range
+ */
+std::vector<uint8_t> WAD::readLump(size_t index) {
+  if (index >= directory_.size()) {
+    throw std::out_of_range("Lump index out of range");
+  }
+  return readLump(directory_[index].filepos, directory_[index].size);
+}
+
+/**
+ * @brief Get the WAD directory
+ * @return Vector with one entry per lump, in file order
+ */
+const std::vector<WAD::Directory> &WAD::getDirectory() const {
+  return directory_;
 }
 
 /**
  * @brief Read vertices from the WAD file
  * @param offset Offset of the vertices in the file
  * @param size Size of the vertices
- * @return Vector containing the vertices
+ * @return View of the vertices in the WAD file data
+ * @throws std::runtime_error if the lump is outside the file
  */
-std::vector<WAD::Vertex> WAD::readVertices(std::streamoff offset,
-                                           std::size_t    size) {
-  auto                data = readLump(offset, size);
-  std::vector<Vertex> vertices(size / sizeof(Vertex));
-  std::memcpy(vertices.data(), data.data(), size);
-  return vertices;
+LumpView<WAD::Vertex> WAD::readVertices(std::streamoff offset,
+                                        std::size_t    size) {
+  return LumpView<Vertex>(file_->range(offset, size), size);
 }
 
 /**
  * @brief Read linedefs from the WAD file
  * @param offset Offset of the linedefs in the file
  * @param size Size of the linedefs
- * @return Vector containing the linedefs
+ * @return View of the linedefs in the WAD file data
+ * @throws std::runtime_error if the lump is outside the file
  */
-std::vector<WAD::Linedef> WAD::readLinedefs(std::streamoff offset,
-                                            std::size_t    size) {
-  auto                 data = readLump(offset, size);
-  std::vector<Linedef> linedefs(size / sizeof(Linedef));
-  std::memcpy(linedefs.data(), data.data(), size);
-  return linedefs;
+LumpView<WAD::Linedef> WAD::readLinedefs(std::streamoff offset,
+                                         std::size_t    size) {
+  return LumpView<Linedef>(file_->range(offset, size), size);
 }
 
 /**
  * @brief Read sidedefs from the WAD file
  * @param offset Offset of the sidedefs in the file
  * @param size Size of the sidedefs
- * @return Vector containing the sidedefs
+ * @return View of the sidedefs in the WAD file data
+ * @throws std::runtime_error if the lump is outside the file
  */
-std::vector<WAD::Sidedef> WAD::readSidedefs(std::streamoff offset,
-                                            std::size_t    size) {
-  auto                 data = readLump(offset, size);
-  std::vector<Sidedef> sidedefs(size / sizeof(Sidedef));
-  std::memcpy(sidedefs.data(), data.data(), size);
-  return sidedefs;
+LumpView<WAD::Sidedef> WAD::readSidedefs(std::streamoff offset,
+                                         std::size_t    size) {
+  return LumpView<Sidedef>(file_->range(offset, size), size);
 }
 
 /**
  * @brief Read sectors from the WAD file
  * @param offset Offset of the sectors in the file
  * @param size Size of the sectors
- * @return Vector containing the sectors
+ * @return View of the sectors in the WAD file data
+ * @throws std::runtime_error if the lump is outside the file
  */
-std::vector<WAD::Sector> WAD::readSectors(std::streamoff offset,
-                                          std::size_t    size) {
-  auto                data = readLump(offset, size);
-  std::vector<Sector> sectors(size / sizeof(Sector));
-  std::memcpy(sectors.data(), data.data(), size);
-  return sectors;
+LumpView<WAD::Sector> WAD::readSectors(std::streamoff offset,
+                                       std::size_t    size) {
+  return LumpView<Sector>(file_->range(offset, size), size);
 }
 
 /**
  * @brief Read things from the WAD file
  * @param offset Offset of the things in the file
  * @param size Size of the things
- * @return Vector containing the things
+ * @return View of the things in the WAD file data
+ * @throws std::runtime_error if the lump is outside the file
  */
-std::vector<WAD::Thing> WAD::readThings(std::streamoff offset,
-                                        std::size_t    size) {
-  auto               data = readLump(offset, size);
-  std::vector<Thing> things(size / sizeof(Thing));
-  std::memcpy(things.data(), data.data(), size);
-  return things;
+LumpView<WAD::Thing> WAD::readThings(std::streamoff offset, std::size_t size) {
+  return LumpView<Thing>(file_->range(offset, size), size);
+}
+
+/**
+ * @brief Read segs from the WAD file
+ * @param offset Offset of the segs in the file
+ * @param size Size of the segs
+ * @return View of the segs in the WAD file data
+ * @throws std::runtime_error if the lump is outside the file
+ */
+LumpView<WAD::Seg> WAD::readSegs(std::streamoff offset, std::size_t size) {
+  return LumpView<Seg>(file_->range(offset, size), size);
 }
 
 /**
- * @brief Read a patch lump and convert it to RGBA format
+ * @brief Read subsectors from the WAD file
+ * @param offset Offset of the subsectors in the file
+ * @param size Size of the subsectors
+ * @return View of the subsectors in the WAD file data
+ * @throws std::runtime_error if the lump is outside the file
+ */
+LumpView<WAD::Subsector> WAD::readSubsectors(std::streamoff offset,
+                                             std::size_t    size) {
+  return LumpView<Subsector>(file_->range(offset, size), size);
+}
+
+/**
+ * @brief Read BSP nodes from the WAD file
+ * @param offset Offset of the nodes in the file
+ * @param size Size of the nodes
+ * @return View of the nodes in the WAD file data
+ * @throws std::runtime_error if the lump is outside the file
+ */
+LumpView<WAD::Node> WAD::readNodes(std::streamoff offset, std::size_t size) {
+  return LumpView<Node>(file_->range(offset, size), size);
+}
+
+/**
+ * @brief Read a patch lump into palette indices and a coverage mask
  * @param offset Offset of the patch in the file
  * @param size Size of the patch
  * @param name Name of the patch
- * @return PatchData containing the converted patch
+ * @return PatchData with the palette index and coverage of every pixel
+ * @throws std::runtime_error if the patch header, a column offset or a post
+ * points outside the lump
  */
 WAD::PatchData WAD::readPatch(std::streamoff offset, std::size_t size,
                               const std::string &name) {
-  auto      data = readLump(offset, size);
-  PatchData patch;
-  std::strncpy(patch.name, name.c_str(), 8);  // Copy name to char array
-
-  // Read patch header
-  const PatchHeader *header =
-      reinterpret_cast<const PatchHeader *>(data.data());
-  patch.width  = header->width;
-  patch.height = header->height;
-
-  // Initialize pixel data (RGBA format)
-  patch.pixels.resize(patch.width * patch.height * 4, 0);
+  TRACE_ZONE_LUMP("WAD::readPatch", LumpName(name));
+  LumpReader lump(file_->range(offset, size), size, name);
+  PatchData  patch;
+  LumpName(name).copyTo(patch.name);  // Copy name to char array
+
+  // Read patch header (width, height, left and top offsets)
+  int16_t width  = lump.s16(0);
+  int16_t height = lump.s16(2);
+  if (width <= 0 || height <= 0) {
+    throw std::runtime_error("Invalid size in patch " + name);
+  }
+  patch.width  = width;
+  patch.height = height;
 
-  // Read column offsets
-  const uint32_t *columnOffsets = &header->column_offsets[0];
+  // Pixels no post covers stay transparent
+  patch.pixels.resize(patch.width * patch.height, 0);
+  patch.opaque.resize(patch.width * patch.height, 0);
 
-  // Process each column
+  // Process each column, column offsets follow the 8-byte header and are
+  // checked once as a whole
+  const uint8_t *columns =
+      lump.bytes(8, static_cast<uint64_t>(patch.width) * 4);
   for (int x = 0; x < patch.width; x++) {
-    uint32_t       columnOffset = columnOffsets[x];
-    const uint8_t *column       = data.data() + columnOffset;
+    uint64_t column = LittleEndian::loadU32(columns + x * 4);
 
     while (true) {
-      uint8_t topdelta = *column++;
+      uint8_t topdelta = lump.u8(column++);
       if (topdelta == 0xFF)  // End of column
         break;
 
-      uint8_t length = *column++;
+      uint8_t length = lump.u8(column++);
       column++;  // Skip padding byte
 
-      // Copy pixels to RGBA format
-      for (int y = 0; y < length; y++) {
-        uint8_t pixel     = *column++;
-        int     destIndex = ((topdelta + y) * patch.width + x) * 4;
+      const uint8_t *post = lump.bytes(column, length);
+      column += length;
 
-        // Convert palette index to RGBA (placeholder values for now)
-        patch.pixels[destIndex + 0] = pixel;  // R
-        patch.pixels[destIndex + 1] = pixel;  // G
-        patch.pixels[destIndex + 2] = pixel;  // B
-        patch.pixels[destIndex + 3] = 255;    // A
+      // Copy the post, clipping posts taller than the patch
+      for (int y = 0; y < length && topdelta + y < patch.height; y++) {
+        int destIndex           = (topdelta + y) * patch.width + x;
+        patch.pixels[destIndex] = post[y];
+        patch.opaque[destIndex] = 1;
       }
 
       column++;  // Skip padding byte
@@ -267,20 +310,22 @@ WAD::PatchData WAD::readPatch(std::streamoff offset, std::size_t size,
  * @param offset Offset of the patch names in the file
  * @param size Size of the patch names
  * @return Vector containing the patch names
+ * @throws std::runtime_error if the name count does not fit in the lump
  */
 std::vector<std::string> WAD::readPatchNames(std::streamoff offset,
                                              std::size_t    size) {
-  auto                     data = readLump(offset, size);
+  LumpReader               lump(file_->range(offset, size), size, "PNAMES");
   std::vector<std::string> names;
 
   // First 4 bytes is number of patches
-  uint32_t num_patches;
-  std::memcpy(&num_patches, data.data(), sizeof(uint32_t));
+  uint32_t num_patches = lump.u32(0);
 
   // Read patch names (8 bytes each, zero-terminated)
-  const char *name_data = reinterpret_cast<const char *>(data.data() + 4);
+  const char *name_data = reinterpret_cast<const char *>(
+      lump.bytes(4, static_cast<uint64_t>(num_patches) * 8));
+  names.reserve(num_patches);
   for (uint32_t i = 0; i < num_patches; i++) {
-    names.push_back(OkStrings::trimFixedString(name_data + i * 8, 8));
+    names.push_back(LumpName(name_data + i * 8).str());
   }
 
   return names;
@@ -291,43 +336,43 @@ std::vector<std::string> WAD::readPatchNames(std::streamoff offset,
  * @param offset Offset of the texture definitions in the file
  * @param size Size of the texture definitions
  * @return Vector containing the texture definitions
+ * @throws std::runtime_error if a texture offset or patch list points outside
+ * the lump
  */
 std::vector<WAD::TextureDef> WAD::readTextureDefs(std::streamoff offset,
                                                   std::size_t    size) {
-  auto                    data = readLump(offset, size);
+  LumpReader              lump(file_->range(offset, size), size, "TEXTURE");
   std::vector<TextureDef> textures;
 
-  // First 4 bytes is number of textures
-  uint32_t num_textures;
-  std::memcpy(&num_textures, data.data(), sizeof(uint32_t));
-
-  // Get offsets to each texture
-  std::vector<uint32_t> offsets(num_textures);
-  std::memcpy(offsets.data(), data.data() + 4, num_textures * sizeof(uint32_t));
+  // First 4 bytes is number of textures, followed by an offset to each one
+  uint32_t num_textures = lump.u32(0);
+  lump.bytes(4, static_cast<uint64_t>(num_textures) * 4);
+  textures.reserve(num_textures);
 
   // Read each texture definition
   for (uint32_t i = 0; i < num_textures; i++) {
-    TextureDef     tex;
-    const uint8_t *tex_data = data.data() + offsets[i];
+    TextureDef tex;
+    uint64_t   tex_data = lump.u32(4 + i * 4);
 
     // Read texture header
-    std::memcpy(tex.name, tex_data, 8);
-    std::memcpy(&tex.masked, tex_data + 8, 4);
-    std::memcpy(&tex.width, tex_data + 12, 2);
-    std::memcpy(&tex.height, tex_data + 14, 2);
-    std::memcpy(&tex.column_dir, tex_data + 16, 4);
-    std::memcpy(&tex.patch_count, tex_data + 20, 2);
-
-    // Read patches
-    const uint8_t *patch_data = tex_data + 22;
+    std::memcpy(tex.name, lump.bytes(tex_data, 8), 8);
+    tex.masked      = lump.u32(tex_data + 8);
+    tex.width       = lump.u16(tex_data + 12);
+    tex.height      = lump.u16(tex_data + 14);
+    tex.column_dir  = lump.u32(tex_data + 16);
+    tex.patch_count = lump.u16(tex_data + 20);
+
+    // Read patches (10 bytes each)
+    uint64_t patch_data = tex_data + 22;
+    lump.bytes(patch_data, static_cast<uint64_t>(tex.patch_count) * 10);
+    tex.patches.resize(tex.patch_count);
     for (uint16_t j = 0; j < tex.patch_count; j++) {
-      PatchInTexture patch;
-      std::memcpy(&patch.origin_x, patch_data + j * 10, 2);
-      std::memcpy(&patch.origin_y, patch_data + j * 10 + 2, 2);
-      std::memcpy(&patch.patch_num, patch_data + j * 10 + 4, 2);
-      std::memcpy(&patch.stepdir, patch_data + j * 10 + 6, 2);
-      std::memcpy(&patch.colormap, patch_data + j * 10 + 8, 2);
-      tex.patches.push_back(patch);
+      PatchInTexture &patch = tex.patches[j];
+      patch.origin_x        = lump.s16(patch_data + j * 10);
+      patch.origin_y        = lump.s16(patch_data + j * 10 + 2);
+      patch.patch_num       = lump.u16(patch_data + j * 10 + 4);
+      patch.stepdir         = lump.u16(patch_data + j * 10 + 6);
+      patch.colormap        = lump.u16(patch_data + j * 10 + 8);
     }
 
     textures.push_back(tex);
@@ -341,13 +386,15 @@ std::vector<WAD::TextureDef> WAD::readTextureDefs(std::streamoff offset,
  * @param offset Offset of the palette in the file
  * @param size Size of the palette
  * @return Vector containing the palette colors
+ * @throws std::runtime_error if the lump is smaller than one palette
  */
 std::vector<WAD::Color> WAD::readPalette(std::streamoff offset,
                                          std::size_t    size) {
-  std::vector<Color>   palette(256);  // DOOM palette has 256 colors
-  std::vector<uint8_t> data = readLump(offset, size);
+  std::vector<Color> palette(256);  // DOOM palette has 256 colors
+  LumpReader         lump(file_->range(offset, size), size, "PLAYPAL");
 
   // First palette is at offset 0
+  const uint8_t *data = lump.bytes(0, 256 * 3);
   for (int i = 0; i < 256; i++) {
     palette[i].r = data[i * 3];      // Red
     palette[i].g = data[i * 3 + 1];  // Green
@@ -357,6 +404,53 @@ std::vector<WAD::Color> WAD::readPalette(std::streamoff offset,
   return palette;
 }
 
+/**
+ * @brief Read the geometry lumps of a level
+ * @param markerIndex Directory index of the level marker (ExMy / MAPxx)
+ * @param level Level to fill with vertices, linedefs, sidedefs, sectors,
+ * things and the BSP tree
+ * @note The lumps are searched only between this marker and the next one.
+ */
+void WAD::readLevelGeometry(size_t markerIndex, Level &level) {
+  TRACE_ZONE_LUMP("WAD::readLevelGeometry", LumpName(level.name));
+  level.has_player_start = false;
+
+  uint32_t vOffset, vSize;
+  if (findLump("VERTEXES", vOffset, vSize, markerIndex + 1)) {
+    level.vertices = readVertices(vOffset, vSize);
+  }
+  if (findLump("LINEDEFS", vOffset, vSize, markerIndex + 1)) {
+    level.linedefs = readLinedefs(vOffset, vSize);
+  }
+  if (findLump("SIDEDEFS", vOffset, vSize, markerIndex + 1)) {
+    level.sidedefs = readSidedefs(vOffset, vSize);
+  }
+  if (findLump("SECTORS", vOffset, vSize, markerIndex + 1)) {
+    level.sectors = readSectors(vOffset, vSize);
+  }
+  if (findLump("THINGS", vOffset, vSize, markerIndex + 1)) {
+    level.things = readThings(vOffset, vSize);
+  }
+  if (findLump("SEGS", vOffset, vSize, markerIndex + 1)) {
+    level.segs = readSegs(vOffset, vSize);
+  }
+  if (findLump("SSECTORS", vOffset, vSize, markerIndex + 1)) {
+    level.subsectors = readSubsectors(vOffset, vSize);
+  }
+  if (findLump("NODES", vOffset, vSize, markerIndex + 1)) {
+    level.nodes = readNodes(vOffset, vSize);
+  }
+
+  // Load player start position (Thing type 1)
+  for (size_t j = 0; j < level.things.size(); j++) {
+    if (level.things[j].type == 1) {
+      level.has_player_start = true;
+      level.player_start     = level.things[j];
+      break;
+    }
+  }
+}
+
 /**
  * @brief Process the WAD file and load all data
  * @throws std::runtime_error if any of the lumps cannot be read
@@ -365,6 +459,7 @@ std::vector<WAD::Color> WAD::readPalette(std::streamoff offset,
  *       to the console.
  */
 void WAD::processWAD() {
+  TRACE_ZONE("WAD::processWAD");
   uint32_t                 offset, size;
   std::vector<TextureDef>  allTextures;
   std::vector<PatchData>   allPatches;
@@ -374,7 +469,7 @@ void WAD::processWAD() {
   // First load PLAYPAL (needed for texture conversion)
   if (findLump("PLAYPAL", offset, size, 0)) {
     palette = readPalette(offset, size);
-    std::cout << "WAD :: Loaded PLAYPAL (palette data)\n";
+    LOG_INFO("WAD :: Loaded PLAYPAL (palette data)");
   }
 
   // Then load TEXTURE1/TEXTURE2 to know which patches we actually need
@@ -391,8 +486,7 @@ void WAD::processWAD() {
   // Load PNAMES (needed to map patch numbers to names)
   if (findLump("PNAMES", offset, size, 0)) {
     patchNames = readPatchNames(offset, size);
-    std::cout << "WAD :: Found " << patchNames.size()
-              << " patch names in PNAMES\n";
+    LOG_INFO("WAD :: Found " << patchNames.size() << " patch names in PNAMES");
 
     // Create a set of required patch indices from textures
     std::vector<bool> requiredPatches(patchNames.size(), false);
@@ -403,9 +497,9 @@ void WAD::processWAD() {
         if (patchNum < patchNames.size()) {
           requiredPatches[patchNum] = true;
         } else {
-          std::cout << "WAD :: Warning: Texture '"
-                    << std::string(tex.name, strnlen(tex.name, 8))
-                    << "' references invalid patch number " << patchNum << "\n";
+          LOG_WARNING("WAD :: Texture '" << LumpName(tex.name).str()
+                                         << "' references invalid patch number "
+                                         << patchNum);
         }
       }
     }
@@ -423,23 +517,23 @@ void WAD::processWAD() {
         }
       }
     }
-    std::cout << "WAD :: Need to load " << requiredCount
-              << " patches for textures\n";
-    if (!missingPatches.empty()) {
-      std::cout << "WAD :: Missing patches: ";
+    LOG_INFO("WAD :: Need to load " << requiredCount
+                                    << " patches for textures");
+    if (!missingPatches.empty() && Log::enabled(Log::Level::Warning)) {
+      std::string names;
       for (const std::string &name : missingPatches) {
-        std::cout << name << " ";
+        names += name + " ";
       }
-      std::cout << "\n";
+      LOG_WARNING("WAD :: Missing patches: " << names);
     }
 
     // Struct to track patch marker sections
     struct PatchSection {
-      std::string start;
-      std::string end;
-      bool        found;
-      size_t      startIndex;
-      size_t      endIndex;
+      LumpName start;
+      LumpName end;
+      bool     found;
+      size_t   startIndex;
+      size_t   endIndex;
     };
 
     // Define all possible patch sections
@@ -457,9 +551,7 @@ void WAD::processWAD() {
         sections[s].found = true;
         // Find section indices
         for (size_t i = 0; i < directory_.size(); i++) {
-          std::string name(directory_[i].name, 8);
-          while (!name.empty() && name.back() == ' ')
-            name.pop_back();
+          LumpName name(directory_[i].name);
 
           if (name == sections[s].start)
             sections[s].startIndex = i;
@@ -471,6 +563,15 @@ void WAD::processWAD() {
       }
     }
 
+    // Map each patch name to its index in PNAMES
+    std::unordered_map<LumpName, size_t> patchSlots;
+    for (size_t p = 0; p < patchNames.size(); p++) {
+      patchSlots.insert(std::make_pair(LumpName(patchNames[p]), p));
+    }
+
+    // Patches are stored by PNAMES index, so patch_num can be used directly
+    allPatches.resize(patchNames.size());
+
     // Load required patches from each section
     std::vector<bool> patchLoaded(patchNames.size(), false);
     size_t            totalLoaded = 0;
@@ -482,28 +583,31 @@ void WAD::processWAD() {
       size_t sectionLoaded = 0;
       for (size_t i = sections[s].startIndex + 1; i < sections[s].endIndex;
            i++) {
-        std::string patchName(directory_[i].name, 8);
-        while (!patchName.empty() && patchName.back() == ' ')
-          patchName.pop_back();
-
         // Find this patch's index in PNAMES
-        for (size_t p = 0; p < patchNames.size(); p++) {
-          if (!patchLoaded[p] && requiredPatches[p] &&
-              patchNames[p] == patchName) {
-            // Load the patch
-            PatchData patch =
-                readPatch(directory_[i].filepos, directory_[i].size, patchName);
-            allPatches.push_back(patch);
-            patchLoaded[p] = true;
+        std::unordered_map<LumpName, size_t>::const_iterator slot =
+            patchSlots.find(LumpName(directory_[i].name));
+        if (slot == patchSlots.end()) {
+          continue;
+        }
+
+        size_t p = slot->second;
+        if (!patchLoaded[p] && requiredPatches[p]) {
+          // Load the patch, a corrupt patch is left empty and skipped when
+          // compositing textures
+          patchLoaded[p] = true;
+          try {
+            allPatches[p] = readPatch(directory_[i].filepos,
+                                      directory_[i].size, patchNames[p]);
             sectionLoaded++;
             totalLoaded++;
-            break;
+          } catch (const std::runtime_error &e) {
+            LOG_WARNING("WAD :: Skipping patch: " << e.what());
           }
         }
       }
 
-      std::cout << "WAD :: Loaded " << sectionLoaded << " patches from "
-                << sections[s].start << " section\n";
+      LOG_INFO("WAD :: Loaded " << sectionLoaded << " patches from "
+                                << sections[s].start.str() << " section");
     }
 
     // If we still have missing patches, try loading directly by name
@@ -512,90 +616,69 @@ void WAD::processWAD() {
       for (size_t p = 0; p < patchNames.size(); p++) {
         if (!patchLoaded[p] && requiredPatches[p]) {
           if (findLump(patchNames[p], offset, size, 0)) {
-            PatchData patch = readPatch(offset, size, patchNames[p]);
-            allPatches.push_back(patch);
             patchLoaded[p] = true;
-            directLoaded++;
-            totalLoaded++;
+            try {
+              allPatches[p] = readPatch(offset, size, patchNames[p]);
+              directLoaded++;
+              totalLoaded++;
+            } catch (const std::runtime_error &e) {
+              LOG_WARNING("WAD :: Skipping patch: " << e.what());
+            }
           }
         }
       }
       if (directLoaded > 0) {
-        std::cout << "WAD :: Loaded " << directLoaded
-                  << " patches directly by name\n";
+        LOG_INFO("WAD :: Loaded " << directLoaded
+                                  << " patches directly by name");
       }
     }
 
-    std::cout << "WAD :: Successfully loaded " << totalLoaded << " of "
-              << requiredCount << " required patches\n";
+    LOG_INFO("WAD :: Successfully loaded " << totalLoaded << " of "
+                                           << requiredCount
+                                           << " required patches");
   }
 
   // Now process levels (using the loaded textures/patches)
   for (size_t i = 0; i < directory_.size(); i++) {
-    std::string lumpName = OkStrings::trimFixedString(directory_[i].name, 8);
+    LumpName lumpName(directory_[i].name);
 
     if (isLevelMarker(lumpName)) {
+      LOG_DEBUG("WAD :: Found level in WAD file: " << lumpName.str());
       Level level;
-      std::strncpy(level.name, lumpName.c_str(), 8);
+      lumpName.copyTo(level.name);
       level.texture_defs = allTextures;
       level.patches      = allPatches;
       level.patch_names  = patchNames;
       level.palette      = palette;
 
       // Load level data (VERTEXES, LINEDEFS, etc.)
-      uint32_t vOffset, vSize;
-      if (findLump("VERTEXES", vOffset, vSize, i + 1)) {
-        level.vertices = readVertices(vOffset, vSize);
-      }
-      if (findLump("LINEDEFS", vOffset, vSize, i + 1)) {
-        level.linedefs = readLinedefs(vOffset, vSize);
-      }
-      if (findLump("SIDEDEFS", vOffset, vSize, i + 1)) {
-        level.sidedefs = readSidedefs(vOffset, vSize);
-      }
-      if (findLump("SECTORS", vOffset, vSize, i + 1)) {
-        level.sectors = readSectors(vOffset, vSize);
-      }
-      if (findLump("THINGS", vOffset, vSize, i + 1)) {
-        level.things = readThings(vOffset, vSize);
-      }
-
-      // Load player start position (Thing type 1)
-      for (size_t j = 0; j < level.things.size(); j++) {
-        if (level.things[j].type == 1) {
-          level.has_player_start = true;
-          level.player_start     = level.things[j];
-          break;
-        }
-      }
+      readLevelGeometry(i, level);
 
       // Load all unique flat textures referenced by sectors
-      std::set<std::string> uniqueFlats;
+      std::set<LumpName> uniqueFlats;
       for (size_t j = 0; j < level.sectors.size(); j++) {
-        std::string floorTex =
-            OkStrings::trimFixedString(level.sectors[j].floor_texture, 8);
-        std::string ceilTex =
-            OkStrings::trimFixedString(level.sectors[j].ceiling_texture, 8);
+        LumpName floorTex(level.sectors[j].floor_texture);
+        LumpName ceilTex(level.sectors[j].ceiling_texture);
 
-        if (!floorTex.empty() && floorTex != "-") {
+        if (!floorTex.isNoTexture()) {
           uniqueFlats.insert(floorTex);
         }
-        if (!ceilTex.empty() && ceilTex != "-") {
+        if (!ceilTex.isNoTexture()) {
           uniqueFlats.insert(ceilTex);
         }
       }
 
       // Load each unique flat texture
-      for (std::set<std::string>::iterator it = uniqueFlats.begin();
+      for (std::set<LumpName>::iterator it = uniqueFlats.begin();
            it != uniqueFlats.end(); ++it) {
         uint32_t offset, size;
         if (findLump(*it, offset, size, 0)) {
           std::vector<uint8_t> flatData = readLump(offset, size);
           if (flatData.size() == 64 * 64) {  // DOOM flats are always 64x64
             FlatData flat;
-            std::strncpy(flat.name, it->c_str(), 8);
-            flat.data = flatData;
-            level.flats.push_back(flat);
+            it->copyTo(flat.name);
+            flat.data = std::move(flatData);
+            level.flats.push_back(std::move(flat));
           }
         }
       }
@@ -603,6 +686,8 @@ void WAD::processWAD() {
       levels_.push_back(level);
     }
   }
+
+  LOG_INFO("WAD :: Found " << levels_.size() << " levels");
 }
 
 /**
@@ -883,12 +968,10 @@ std::string WAD::toJSON() const {
  * @throws std::runtime_error if the level is not found
  */
 WAD::Level WAD::getLevel(std::string name) const {
-  std::cout << "WAD :: Looking for level: '" << name << "'...";
-
   // Compare the first 8 characters of the name
   for (size_t i = 0; i < levels_.size(); i++) {
     if (strncmp(levels_[i].name, name.c_str(), 8) == 0) {
-      std::cout << " found!\n";
+      LOG_INFO("WAD :: Found level '" << name << "'");
       return levels_[i];
     }
   }
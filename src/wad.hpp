@@ -1,8 +1,14 @@
 #ifndef WAD_VIEWER_WAD_HPP
 #define WAD_VIEWER_WAD_HPP
 
+#include "./little-endian.hpp"
+#include "./lump-name.hpp"
+#include "./lump-view.hpp"
+#include "./mapped-file.hpp"
 #include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -17,6 +23,20 @@ public:
     char     identification[4];  // IWAD or PWAD
     uint32_t numlumps;           // Number of lumps
     uint32_t infotableofs;       // Offset to directory
+
+    static const std::size_t RECORD_SIZE = 12;
+    static Header            decode(const uint8_t *p) {
+      Header h;
+      std::memcpy(h.identification, p, 4);
+      h.numlumps     = LittleEndian::loadU32(p + 4);
+      h.infotableofs = LittleEndian::loadU32(p + 8);
+      return h;
+    }
+    void encode(uint8_t *p) const {
+      std::memcpy(p, identification, 4);
+      LittleEndian::storeU32(p + 4, numlumps);
+      LittleEndian::storeU32(p + 8, infotableofs);
+    }
   };
 
   // Directory entry structure
@@ -24,12 +44,41 @@ public:
     uint32_t filepos;  // Offset to start of lump
     uint32_t size;     // Size of lump
     char     name[8];  // Lump name (zero-terminated)
+
+    static const std::size_t RECORD_SIZE = 16;
+    static Directory         decode(const uint8_t *p) {
+      Directory d;
+      d.filepos = LittleEndian::loadU32(p);
+      d.size    = LittleEndian::loadU32(p + 4);
+      std::memcpy(d.name, p + 8, 8);
+      return d;
+    }
+    void encode(uint8_t *p) const {
+      LittleEndian::storeU32(p, filepos);
+      LittleEndian::storeU32(p + 4, size);
+      std::memcpy(p + 8, name, 8);
+    }
   };
 
   // Structure definitions
+  // Level records are read through LumpView, which uses RECORD_SIZE and
+  // decode() to read the little-endian on-disk layout in place. encode()
+  // writes the same layout, for WADWriter
   struct Vertex {
     int16_t x;
     int16_t y;
+
+    static const std::size_t RECORD_SIZE = 4;
+    static Vertex            decode(const uint8_t *p) {
+      Vertex v;
+      v.x = LittleEndian::loadS16(p);
+      v.y = LittleEndian::loadS16(p + 2);
+      return v;
+    }
+    void encode(uint8_t *p) const {
+      LittleEndian::storeS16(p, x);
+      LittleEndian::storeS16(p + 2, y);
+    }
   };
 
   struct Linedef {
@@ -40,6 +89,28 @@ public:
     uint16_t sector_tag;
     uint16_t right_sidedef;
     uint16_t left_sidedef;
+
+    static const std::size_t RECORD_SIZE = 14;
+    static Linedef           decode(const uint8_t *p) {
+      Linedef l;
+      l.start_vertex  = LittleEndian::loadU16(p);
+      l.end_vertex    = LittleEndian::loadU16(p + 2);
+      l.flags         = LittleEndian::loadU16(p + 4);
+      l.line_type     = LittleEndian::loadU16(p + 6);
+      l.sector_tag    = LittleEndian::loadU16(p + 8);
+      l.right_sidedef = LittleEndian::loadU16(p + 10);
+      l.left_sidedef  = LittleEndian::loadU16(p + 12);
+      return l;
+    }
+    void encode(uint8_t *p) const {
+      LittleEndian::storeU16(p, start_vertex);
+      LittleEndian::storeU16(p + 2, end_vertex);
+      LittleEndian::storeU16(p + 4, flags);
+      LittleEndian::storeU16(p + 6, line_type);
+      LittleEndian::storeU16(p + 8, sector_tag);
+      LittleEndian::storeU16(p + 10, right_sidedef);
+      LittleEndian::storeU16(p + 12, left_sidedef);
+    }
   };
 
   struct Sidedef {
@@ -49,6 +120,26 @@ public:
     char     lower_texture[8];
     char     middle_texture[8];
     uint16_t sector;
+
+    static const std::size_t RECORD_SIZE = 30;
+    static Sidedef           decode(const uint8_t *p) {
+      Sidedef s;
+      s.x_offset = LittleEndian::loadS16(p);
+      s.y_offset = LittleEndian::loadS16(p + 2);
+      std::memcpy(s.upper_texture, p + 4, 8);
+      std::memcpy(s.lower_texture, p + 12, 8);
+      std::memcpy(s.middle_texture, p + 20, 8);
+      s.sector = LittleEndian::loadU16(p + 28);
+      return s;
+    }
+    void encode(uint8_t *p) const {
+      LittleEndian::storeS16(p, x_offset);
+      LittleEndian::storeS16(p + 2, y_offset);
+      std::memcpy(p + 4, upper_texture, 8);
+      std::memcpy(p + 12, lower_texture, 8);
+      std::memcpy(p + 20, middle_texture, 8);
+      LittleEndian::storeU16(p + 28, sector);
+    }
   };
 
   struct Sector {
@@ -59,6 +150,28 @@ public:
     uint16_t light_level;
     uint16_t type;
     uint16_t tag;
+
+    static const std::size_t RECORD_SIZE = 26;
+    static Sector            decode(const uint8_t *p) {
+      Sector s;
+      s.floor_height   = LittleEndian::loadS16(p);
+      s.ceiling_height = LittleEndian::loadS16(p + 2);
+      std::memcpy(s.floor_texture, p + 4, 8);
+      std::memcpy(s.ceiling_texture, p + 12, 8);
+      s.light_level = LittleEndian::loadU16(p + 20);
+      s.type        = LittleEndian::loadU16(p + 22);
+      s.tag         = LittleEndian::loadU16(p + 24);
+      return s;
+    }
+    void encode(uint8_t *p) const {
+      LittleEndian::storeS16(p, floor_height);
+      LittleEndian::storeS16(p + 2, ceiling_height);
+      std::memcpy(p + 4, floor_texture, 8);
+      std::memcpy(p + 12, ceiling_texture, 8);
+      LittleEndian::storeU16(p + 20, light_level);
+      LittleEndian::storeU16(p + 22, type);
+      LittleEndian::storeU16(p + 24, tag);
+    }
   };
 
   struct Thing {
@@ -67,8 +180,117 @@ public:
     uint16_t angle;
     uint16_t type;
     uint16_t flags;
+
+    static const std::size_t RECORD_SIZE = 10;
+    static Thing             decode(const uint8_t *p) {
+      Thing t;
+      t.x     = LittleEndian::loadS16(p);
+      t.y     = LittleEndian::loadS16(p + 2);
+      t.angle = LittleEndian::loadU16(p + 4);
+      t.type  = LittleEndian::loadU16(p + 6);
+      t.flags = LittleEndian::loadU16(p + 8);
+      return t;
+    }
+    void encode(uint8_t *p) const {
+      LittleEndian::storeS16(p, x);
+      LittleEndian::storeS16(p + 2, y);
+      LittleEndian::storeU16(p + 4, angle);
+      LittleEndian::storeU16(p + 6, type);
+      LittleEndian::storeU16(p + 8, flags);
+    }
   };
 
+  // Piece of a linedef bounding a subsector, made by the node builder
+  struct Seg {
+    uint16_t start_vertex;
+    uint16_t end_vertex;
+    int16_t  angle;      // Binary angle, 0x4000 is 90 degrees
+    uint16_t linedef;    // Linedef the seg is part of
+    uint16_t direction;  // 0 on the right side of the linedef, 1 on the left
+    int16_t  offset;     // Distance along the linedef to the seg start
+
+    static const std::size_t RECORD_SIZE = 12;
+    static Seg               decode(const uint8_t *p) {
+      Seg s;
+      s.start_vertex = LittleEndian::loadU16(p);
+      s.end_vertex   = LittleEndian::loadU16(p + 2);
+      s.angle        = LittleEndian::loadS16(p + 4);
+      s.linedef      = LittleEndian::loadU16(p + 6);
+      s.direction    = LittleEndian::loadU16(p + 8);
+      s.offset       = LittleEndian::loadS16(p + 10);
+      return s;
+    }
+    void encode(uint8_t *p) const {
+      LittleEndian::storeU16(p, start_vertex);
+      LittleEndian::storeU16(p + 2, end_vertex);
+      LittleEndian::storeS16(p + 4, angle);
+      LittleEndian::storeU16(p + 6, linedef);
+      LittleEndian::storeU16(p + 8, direction);
+      LittleEndian::storeS16(p + 10, offset);
+    }
+  };
+
+  // Convex leaf of the BSP tree, a range of segs
+  struct Subsector {
+    uint16_t seg_count;
+    uint16_t first_seg;
+
+    static const std::size_t RECORD_SIZE = 4;
+    static Subsector         decode(const uint8_t *p) {
+      Subsector s;
+      s.seg_count = LittleEndian::loadU16(p);
+      s.first_seg = LittleEndian::loadU16(p + 2);
+      return s;
+    }
+    void encode(uint8_t *p) const {
+      LittleEndian::storeU16(p, seg_count);
+      LittleEndian::storeU16(p + 2, first_seg);
+    }
+  };
+
+  // BSP node: a partition line and the two halves of the space it splits
+  struct Node {
+    static const uint16_t SUBSECTOR_BIT = 0x8000;  // Child is a subsector
+
+    int16_t  x;            // Partition line start
+    int16_t  y;
+    int16_t  dx;           // Partition line direction
+    int16_t  dy;
+    int16_t  bbox[2][4];   // Bounds of each child: top, bottom, left, right
+    uint16_t children[2];  // Right (front) and left (back) child
+
+    static const std::size_t RECORD_SIZE = 28;
+    static Node              decode(const uint8_t *p) {
+      Node n;
+      n.x  = LittleEndian::loadS16(p);
+      n.y  = LittleEndian::loadS16(p + 2);
+      n.dx = LittleEndian::loadS16(p + 4);
+      n.dy = LittleEndian::loadS16(p + 6);
+      for (int c = 0; c < 2; c++) {
+        for (int b = 0; b < 4; b++) {
+          n.bbox[c][b] = LittleEndian::loadS16(p + 8 + c * 8 + b * 2);
+        }
+      }
+      n.children[0] = LittleEndian::loadU16(p + 24);
+      n.children[1] = LittleEndian::loadU16(p + 26);
+      return n;
+    }
+    void encode(uint8_t *p) const {
+      LittleEndian::storeS16(p, x);
+      LittleEndian::storeS16(p + 2, y);
+      LittleEndian::storeS16(p + 4, dx);
+      LittleEndian::storeS16(p + 6, dy);
+      for (int c = 0; c < 2; c++) {
+        for (int b = 0; b < 4; b++) {
+          LittleEndian::storeS16(p + 8 + c * 8 + b * 2, bbox[c][b]);
+        }
+      }
+      LittleEndian::storeU16(p + 24, children[0]);
+      LittleEndian::storeU16(p + 26, children[1]);
+    }
+  };
+
+  // On-disk patch layout, decoded field by field by readPatch
   struct PatchHeader {
     int16_t  width;             // Width of patch
     int16_t  height;            // Height of patch
@@ -88,7 +310,8 @@ public:
     char                 name[8];  // name from PNAMES
     uint16_t             width;    // Width of the patch
     uint16_t             height;   // Height of the patch
-    std::vector<uint8_t> pixels;   // Pixel data (width * height)
+    std::vector<uint8_t> pixels;   // Palette indices, width * height
+    std::vector<uint8_t> opaque;   // 1 where a column post covers the pixel
   };
 
   // Patch definition in a texture
@@ -120,17 +343,23 @@ public:
     std::vector<uint8_t> data;  // Raw flat data (64x64 pixels)
   };
 
+  // Level geometry is viewed in place in the WAD file data, so a Level must
+  // not outlive the WAD (or WADStack) it was loaded from
   struct Level {
     char name[8];
     // Initial player position and angle
     Thing player_start;  // Player 1 start position (Thing type 1)
     bool  has_player_start;
     // Level geometry
-    std::vector<Vertex>  vertices;
-    std::vector<Linedef> linedefs;
-    std::vector<Sidedef> sidedefs;
-    std::vector<Sector>  sectors;
-    std::vector<Thing>   things;
+    LumpView<Vertex>  vertices;
+    LumpView<Linedef> linedefs;
+    LumpView<Sidedef> sidedefs;
+    LumpView<Sector>  sectors;
+    LumpView<Thing>   things;
+    // BSP tree built by the node builder, empty if the lumps are missing
+    LumpView<Seg>       segs;
+    LumpView<Subsector> subsectors;
+    LumpView<Node>      nodes;
     // Textures and visuals
     std::vector<PatchData>   patches;
     std::vector<std::string> patch_names;   // PNAMES
@@ -151,10 +380,29 @@ public:
   Level       getLevel(std::string name) const;
   std::string getLevelNameByIndex(size_t index) const;
 
+  // Raw directory access, used by WADStack to build its combined lump index
+  const std::vector<Directory> &getDirectory() const;
+  std::vector<uint8_t>          readLump(size_t index);
+  bool                          isLevelMarker(LumpName name) const;
+
+  // Read the geometry lumps (VERTEXES, LINEDEFS, ...) that follow the level
+  // marker at the given directory index
+  void readLevelGeometry(size_t markerIndex, Level &level);
+
+  // Methods to decode resource lumps, shared with WADStack
+  std::vector<std::string> readPatchNames(std::streamoff offset,
+                                          std::size_t    size);
+  std::vector<TextureDef>  readTextureDefs(std::streamoff offset,
+                                           std::size_t    size);
+  PatchData                readPatch(std::streamoff offset, std::size_t size,
+                                     const std::string &name);
+  std::vector<Color>       readPalette(std::streamoff offset, std::size_t size);
+
 private:
-  bool                   verbose_;
-  std::string            filepath_;
-  Header                 header_;
+  bool                        verbose_;
+  std::string                 filepath_;
+  std::unique_ptr<MappedFile> file_;
+  Header                      header_;
   std::vector<Directory> directory_;
   std::vector<PatchData> patches_;
 
@@ -163,29 +411,24 @@ private:
 
   // Method to read the WAD directory
   void readDirectory();
-  bool isLevelMarker(const std::string &name) const;
 
   // Method to find a lump by name
-  bool findLump(const std::string &name, uint32_t &offset, uint32_t &size,
+  bool findLump(LumpName name, uint32_t &offset, uint32_t &size,
                 size_t startIndex) const;
   // Method to read a lump from the WAD file
   std::vector<uint8_t> readLump(std::streamoff offset, std::size_t size);
 
   // Methods to read lumps by type
-  // These methods will read the lump data and return a vector of the
-  // appropriate type
-  std::vector<Vertex>  readVertices(std::streamoff offset, std::size_t size);
-  std::vector<Linedef> readLinedefs(std::streamoff offset, std::size_t size);
-  std::vector<Sidedef> readSidedefs(std::streamoff offset, std::size_t size);
-  std::vector<Sector>  readSectors(std::streamoff offset, std::size_t size);
-  std::vector<Thing>   readThings(std::streamoff offset, std::size_t size);
-  std::vector<std::string> readPatchNames(std::streamoff offset,
-                                          std::size_t    size);
-  std::vector<TextureDef>  readTextureDefs(std::streamoff offset,
-                                           std::size_t    size);
-  PatchData                readPatch(std::streamoff offset, std::size_t size,
-                                     const std::string &name);
-  std::vector<Color>       readPalette(std::streamoff offset, std::size_t size);
+  // These methods return a view of the appropriate type over the lump data,
+  // without copying it
+  LumpView<Vertex>    readVertices(std::streamoff offset, std::size_t size);
+  LumpView<Linedef>   readLinedefs(std::streamoff offset, std::size_t size);
+  LumpView<Sidedef>   readSidedefs(std::streamoff offset, std::size_t size);
+  LumpView<Sector>    readSectors(std::streamoff offset, std::size_t size);
+  LumpView<Thing>     readThings(std::streamoff offset, std::size_t size);
+  LumpView<Seg>       readSegs(std::streamoff offset, std::size_t size);
+  LumpView<Subsector> readSubsectors(std::streamoff offset, std::size_t size);
+  LumpView<Node>      readNodes(std::streamoff offset, std::size_t size);
 };
 
 #endif  // WAD_VIEWER_WAD_HPP
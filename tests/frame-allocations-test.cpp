@@ -0,0 +1,110 @@
+// Steady-state frames must not allocate: the step of the viewer loop and the
+// frames of the software renderer, serially and on a thread pool. The suite
+// is built with WAD_VIEWER_ALLOC_TRACKING, so every allocation is counted
+
+#include "../okinawa.cpp/src/core/camera.hpp"
+#include "../okinawa.cpp/src/input/input.hpp"
+#include "../src/allocation-tracker.hpp"
+#include "../src/draw-order.hpp"
+#include "../src/headless-modes.hpp"
+#include "../src/level-mesh.hpp"
+#include "../src/software-renderer.hpp"
+#include "../src/thread-pool.hpp"
+#include "../src/viewer-controls.hpp"
+#include "../src/wad-converter.hpp"
+#include "./test-wad.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <vector>
+
+TEST_CASE("Steady-state viewer steps do not allocate", "[allocations]") {
+  if (!AllocationTracker::enabled()) {
+    SKIP("Allocations are not counted in this build");
+  }
+
+  const int FRAMES = 600;  // Ten seconds at 60 frames per second
+
+  // Every combination of the movement keys, one per frame, a few times over
+  std::vector<OkInputState> states(16);
+  for (int s = 0; s < 16; s++) {
+    states[s].forward     = s & 1;
+    states[s].backward    = s & 2;
+    states[s].strafeLeft  = s & 4;
+    states[s].strafeRight = s & 8;
+  }
+
+  OkCamera       camera(320, 200);
+  ViewerControls controls;
+  auto           run = [&]() {
+    for (int f = 0; f < FRAMES; f++) {
+      controls.step(camera, states[f % states.size()]);
+      AllocationTracker::markFrame();
+    }
+  };
+
+  run();
+  AllocationTracker::resetFrames();
+  run();
+  AllocationTracker::FrameStats stats = AllocationTracker::frames();
+
+  INFO(stats.allocatingFrames << " of " << stats.frames
+                               << " frames allocate");
+  CHECK(stats.frames == FRAMES);
+  CHECK(stats.allocations == 0);
+}
+
+TEST_CASE("Steady-state software rendered frames do not allocate",
+          "[allocations][renderer]") {
+  if (!AllocationTracker::enabled()) {
+    SKIP("Allocations are not counted in this build");
+  }
+
+  const int   WIDTH   = 320;
+  const int   HEIGHT  = 200;
+  const int   FRAMES  = 360;  // One degree per frame
+  const float FOV_X   = 1.5707963f;
+  const int   THREADS = 4;
+
+  ConversionOptions options;
+  options.sectorGroups = true;
+
+  WAD::Level level = testStack().getLevel("E1M1");
+  LevelMesh  mesh  = WADConverter::buildLevelMesh(level, nullptr, options);
+  DrawOrder  drawOrder(level, mesh);
+  ViewPose   start = playerStartPose(level, mesh, drawOrder);
+
+  SoftwareRenderer renderer(WIDTH, HEIGHT);
+  renderer.loadTextures(level, mesh);
+
+  // The warm-up turn grows the reused buffers to the largest frame
+  auto turn = [&](ThreadPool *pool) {
+    ViewPose view = start;
+    for (int f = 0; f < FRAMES; f++) {
+      view.angle                      = start.angle + f;
+      SoftwareRenderer::Camera camera = cameraForPose(view, mesh, FOV_X);
+      renderer.setCamera(camera);
+      renderer.render(mesh,
+                      &drawOrder.frontToBack(
+                          view.x, view.y, camera.yaw,
+                          SoftwareRenderer::mapHalfFov(camera, WIDTH, HEIGHT)),
+                      pool);
+      AllocationTracker::markFrame();
+    }
+  };
+
+  turn(nullptr);
+  AllocationTracker::resetFrames();
+  turn(nullptr);
+  AllocationTracker::FrameStats serial = AllocationTracker::frames();
+  INFO("Serial, " << serial.allocatingFrames << " allocating frames");
+  CHECK(serial.allocations == 0);
+
+  ThreadPool pool(THREADS);
+  turn(&pool);
+  AllocationTracker::resetFrames();
+  turn(&pool);
+  AllocationTracker::FrameStats pooled = AllocationTracker::frames();
+  INFO("On " << pool.size() << " threads, " << pooled.allocatingFrames
+              << " allocating frames");
+  CHECK(pooled.allocations == 0);
+}
@@ -0,0 +1,60 @@
+// Conversions on a thread pool must give the same meshes as the serial
+// conversion, whatever the number of levels or chunks running at once
+
+#include "../src/level-mesh.hpp"
+#include "../src/lump-name.hpp"
+#include "../src/thread-pool.hpp"
+#include "../src/wad-converter.hpp"
+#include "./test-wad.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+// More workers than levels of a chunk or than the cores of a CI machine
+const std::size_t TEST_THREADS = 8;
+
+std::vector<LevelMesh> serialMeshes(const std::vector<WAD::Level> &levels) {
+  std::vector<LevelMesh> meshes;
+  for (std::size_t i = 0; i < levels.size(); i++) {
+    meshes.push_back(WADConverter::buildLevelMesh(levels[i]));
+  }
+  return meshes;
+}
+
+}  // namespace
+
+TEST_CASE("Levels converted in parallel match the serial conversion",
+          "[converter]") {
+  std::vector<WAD::Level> levels = testLevels();
+  REQUIRE(!levels.empty());
+
+  std::vector<LevelMesh> serial = serialMeshes(levels);
+  ThreadPool             pool(TEST_THREADS);
+  std::vector<LevelMesh> parallel =
+      WADConverter::buildLevelMeshes(levels, pool);
+
+  REQUIRE(parallel.size() == levels.size());
+  for (std::size_t i = 0; i < levels.size(); i++) {
+    INFO("Level " << LumpName(levels[i].name).str());
+    CHECK(parallel[i] == serial[i]);
+  }
+}
+
+TEST_CASE("Levels split in small chunks match the serial conversion",
+          "[converter]") {
+  std::vector<WAD::Level> levels = testLevels();
+  std::vector<LevelMesh>  serial = serialMeshes(levels);
+
+  // Small chunks, so even the smallest level is split between the workers
+  ConversionOptions smallChunks;
+  smallChunks.minChunkSize = 64;
+
+  ThreadPool pool(TEST_THREADS);
+  for (std::size_t i = 0; i < levels.size(); i++) {
+    INFO("Level " << LumpName(levels[i].name).str());
+    CHECK(WADConverter::buildLevelMesh(levels[i], &pool, smallChunks) ==
+          serial[i]);
+  }
+}
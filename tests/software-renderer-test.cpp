@@ -0,0 +1,154 @@
+// The sectors that DrawOrder culls must not change what the software
+// renderer draws, whatever the direction and the pitch of the camera. Seen
+// from inside a sector, its floor and ceiling must face the camera
+
+#include "../src/draw-order.hpp"
+#include "../src/headless-modes.hpp"
+#include "../src/level-mesh.hpp"
+#include "../src/lump-name.hpp"
+#include "../src/software-renderer.hpp"
+#include "../src/wad-converter.hpp"
+#include "./test-wad.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+TEST_CASE("Culled frames match frames drawing every sector",
+          "[renderer][draw-order]") {
+  const int   WIDTH     = 320;
+  const int   HEIGHT    = 200;
+  const float FOV_X     = 1.5707963f;
+  const float NO_CULL   = 1.5707963f;  // Half field of view that keeps all
+  const float PITCHES[] = {-60.0f, -30.0f, 0.0f, 30.0f, 60.0f};
+
+  ConversionOptions options;
+  options.sectorGroups = true;
+
+  WAD::Level level = testStack().getLevel("E1M1");
+  LevelMesh  mesh  = WADConverter::buildLevelMesh(level, nullptr, options);
+  DrawOrder  drawOrder(level, mesh);
+  ViewPose   start = playerStartPose(level, mesh, drawOrder);
+
+  SoftwareRenderer renderer(WIDTH, HEIGHT);
+  renderer.loadTextures(level, mesh);
+
+  for (int turn = 0; turn < 360; turn += 5) {
+    for (float pitch : PITCHES) {
+      ViewPose view = start;
+      view.angle += turn;
+      view.pitch = pitch;
+      SoftwareRenderer::Camera camera = cameraForPose(view, mesh, FOV_X);
+      renderer.setCamera(camera);
+
+      // frontToBack() reuses its buffer, so the culled order is copied
+      std::vector<uint32_t> culled = drawOrder.frontToBack(
+          view.x, view.y, camera.yaw,
+          SoftwareRenderer::mapHalfFov(camera, WIDTH, HEIGHT));
+      renderer.render(mesh, &culled);
+      std::vector<unsigned char> culledImage = renderer.color();
+
+      renderer.render(mesh, &drawOrder.frontToBack(view.x, view.y,
+                                                   camera.yaw, NO_CULL));
+
+      INFO("Angle " << view.angle << ", pitch " << pitch);
+      CHECK(renderer.color() == culledImage);
+    }
+  }
+}
+
+TEST_CASE("Floors and ceilings face the inside of their sector",
+          "[renderer][winding]") {
+  const int   WIDTH  = 160;
+  const int   HEIGHT = 100;
+
+  // Sky ceilings are kept, so every sector has both flats
+  ConversionOptions options;
+  options.sectorGroups = true;
+  options.skipSky      = false;
+
+  for (const WAD::Level &level : testLevels()) {
+    std::string name = LumpName(level.name).str();
+    LevelMesh   mesh = WADConverter::buildLevelMesh(level, nullptr, options);
+
+    SoftwareRenderer renderer(WIDTH, HEIGHT);
+    renderer.loadTextures(level, mesh);
+
+    for (std::size_t s = 0; s < level.sectors.size(); s++) {
+      WAD::Sector sector = level.sectors[s];
+      if (sector.ceiling_height <= sector.floor_height) {
+        continue;  // Closed, there is no inside to look from
+      }
+
+      // The horizontal triangles of the sector, its floor and ceiling
+      LevelMesh flats;
+      flats.centerX = mesh.centerX;
+      flats.centerY = mesh.centerY;
+      flats.scale   = mesh.scale;
+      for (const LevelMesh::Group &group : mesh.groups) {
+        if (group.sector != s) {
+          continue;
+        }
+        LevelMesh::Group flat;
+        flat.texture  = group.texture;
+        flat.vertices = group.vertices;
+        for (std::size_t i = 0; i + 2 < group.indices.size(); i += 3) {
+          const unsigned int *triangle = &group.indices[i];
+          float               y = group.vertices[triangle[0]].pos[1];
+          if (group.vertices[triangle[1]].pos[1] == y &&
+              group.vertices[triangle[2]].pos[1] == y) {
+            flat.indices.insert(flat.indices.end(), triangle, triangle + 3);
+          }
+        }
+        flats.groups.push_back(flat);
+      }
+
+      // Halfway up, over the middle of the largest triangle, as the fans
+      // have degenerate ones
+      float middle[3] = {0.0f, 0.0f, 0.0f};
+      float largest   = 0.0f;
+      for (const LevelMesh::Group &flat : flats.groups) {
+        for (std::size_t i = 0; i + 2 < flat.indices.size(); i += 3) {
+          const float *a = flat.vertices[flat.indices[i]].pos;
+          const float *b = flat.vertices[flat.indices[i + 1]].pos;
+          const float *c = flat.vertices[flat.indices[i + 2]].pos;
+          float        area = std::fabs((b[0] - a[0]) * (c[2] - a[2]) -
+                                        (b[2] - a[2]) * (c[0] - a[0]));
+          if (area > largest) {
+            largest = area;
+            for (int axis = 0; axis < 3; axis++) {
+              middle[axis] = (a[axis] + b[axis] + c[axis]) / 3.0f;
+            }
+          }
+        }
+      }
+      if (largest == 0.0f) {
+        continue;  // No polygon to look at
+      }
+
+      // Looking down at the floor, then up at the ceiling, in radians
+      for (float pitch : {-1.4f, 1.4f}) {
+        SoftwareRenderer::Camera camera;
+        camera.position[0] = middle[0];
+        camera.position[1] =
+            (sector.floor_height + sector.ceiling_height) / 2.0f * mesh.scale;
+        camera.position[2] = middle[2];
+        camera.pitch       = pitch;
+        renderer.setCamera(camera);
+
+        renderer.setCullBackFaces(false);
+        renderer.render(flats, nullptr);
+        std::vector<unsigned char> image = renderer.color();
+
+        renderer.setCullBackFaces(true);
+        renderer.render(flats, nullptr);
+
+        INFO(name << ", sector " << s << ", pitch " << pitch);
+        CHECK(renderer.stats().coveredPixels > 0);
+        CHECK(renderer.color() == image);
+      }
+    }
+  }
+}
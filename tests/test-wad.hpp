@@ -0,0 +1,47 @@
+#ifndef WAD_VIEWER_TESTS_TEST_WAD_HPP
+#define WAD_VIEWER_TESTS_TEST_WAD_HPP
+
+#include "../src/log.hpp"
+#include "../src/wad-stack.hpp"
+#include "../src/wad.hpp"
+#include <cstddef>
+#include <vector>
+
+// IWAD read by the tests, relative to the repository root where make test
+// runs the suite
+const char *const TEST_WAD = "wads/doom1.wad";
+
+/**
+ * @brief The test WAD, loaded on first use and shared by the test cases.
+ * @return The processed stack.
+ * @throws std::runtime_error if the WAD cannot be loaded.
+ */
+inline const WADStack &testStack() {
+  struct LoadedStack {
+    WADStack stack;
+
+    LoadedStack() {
+      Log::setLevel(Log::Level::Warning);  // Keep the load lines out
+      stack.addWAD(TEST_WAD);
+      stack.processStack();
+    }
+  };
+
+  static LoadedStack loaded;
+  return loaded.stack;
+}
+
+/**
+ * @brief Every level of the test WAD, in directory order.
+ * @return Copies of the levels.
+ */
+inline std::vector<WAD::Level> testLevels() {
+  const WADStack         &stack = testStack();
+  std::vector<WAD::Level> levels;
+  for (std::size_t i = 0; i < stack.getLevelCount(); i++) {
+    levels.push_back(stack.getLevel(stack.getLevelNameByIndex(i)));
+  }
+  return levels;
+}
+
+#endif  // WAD_VIEWER_TESTS_TEST_WAD_HPP
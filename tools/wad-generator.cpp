@@ -0,0 +1,632 @@
+// Synthetic level generator
+//
+// Writes a PWAD of levels built as grids of square rooms, to measure how the
+// reader and the converter scale with map size. Every room is a sector with
+// its own floor and ceiling heights, so the lines between rooms get upper
+// and lower walls. Room sides can be split into several linedefs to raise
+// the linedef count without adding sectors. The PWAD also holds its own
+// patches, textures (PNAMES, TEXTURE1) and flats, and optionally a BSP
+// (SEGS, SSECTORS and NODES) that splits the grid between rooms.
+//
+// The palette and the sky come from the IWAD the PWAD is layered over.
+// Counts are limited by the 16-bit indices of the DOOM format: 65535
+// vertices, sidedefs and linedefs, and 32767 rooms with --nodes.
+//
+// The rooms fill a whole grid, so --sectors is rounded up to the rows times
+// the columns of the smallest square-ish grid that holds them (8000 gives
+// 90 x 89 = 8010 rooms), and --linedefs to the nearest whole number of
+// linedefs per room side (20000 gives 19008 on a 32 x 32 grid). The counts
+// asked are printed next to the ones generated when they differ.
+//
+// Build with: make wad-generator
+// Example, four levels of 8000 rooms and 50000 things, then their load
+// times over the IWAD:
+//   ./wad-generator big.wad --levels 4 --sectors 8000 --things 50000 --nodes
+//   ./load-bench --pwad big.wad
+
+#include "../src/lump-name.hpp"
+#include "../src/wad-writer.hpp"
+#include "../src/wad.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+  std::string output;
+  int         levels   = 1;
+  int         sectors  = 1024;
+  int         linedefs = 0;  // 0 for one linedef per room side
+  int         things   = 1000;
+  int         textures = 64;
+  int         patches  = 32;
+  int         flats    = 16;
+  bool        nodes    = false;
+  uint32_t    seed     = 1;
+};
+
+// Records of one level, in the order they are written
+struct Level {
+  std::vector<WAD::Thing>     things;
+  std::vector<WAD::Linedef>   linedefs;
+  std::vector<WAD::Sidedef>   sidedefs;
+  std::vector<WAD::Vertex>    vertices;
+  std::vector<WAD::Seg>       segs;
+  std::vector<WAD::Subsector> subsectors;
+  std::vector<WAD::Node>      nodes;
+  std::vector<WAD::Sector>    sectors;
+};
+
+const uint16_t NO_SIDEDEF       = 0xFFFF;
+const uint16_t LINE_IMPASSABLE  = 0x0001;
+const uint16_t LINE_TWO_SIDED   = 0x0004;
+const int      PATCH_WIDTH      = 64;
+const int      PATCH_HEIGHT     = 128;
+const int      MAX_ROOM_SIZE    = 256;
+const int      MAP_EXTENT       = 60000;  // Fits in int16 coordinates
+const uint16_t THING_TYPES[]    = {3004, 9, 3001, 2011, 2012, 2035, 2014, 48};
+const int      THING_TYPE_COUNT = sizeof(THING_TYPES) / sizeof(THING_TYPES[0]);
+
+// Name with a 4-character prefix and a 4-digit number, such as GTEX0012
+std::string numberedName(const char *prefix, int number) {
+  std::string digits = std::to_string(number % 10000);
+  return prefix + std::string(4 - digits.size(), '0') + digits;
+}
+
+void setName(char *field, const std::string &name) {
+  LumpName(name).copyTo(field);
+}
+
+/**
+ * @brief Grid of rooms, with the linedefs of each room side in order
+ *
+ * Side linedefs are oriented so that the room on their right is the one
+ * east of a vertical side or south of a horizontal side, when it exists.
+ * Walking around a room clockwise, its own sides are then followed forwards
+ * and the sides it shares with the rooms east and south of it backwards.
+ */
+class GridBuilder {
+public:
+  GridBuilder(const Options &options, std::mt19937 &random, Level &level)
+      : options_(options), random_(random), level_(level) {
+    columns_ = static_cast<int>(std::ceil(std::sqrt(options.sectors)));
+    rows_    = (options.sectors + columns_ - 1) / columns_;
+
+    int sides = rows_ * (columns_ + 1) + columns_ * (rows_ + 1);
+    split_    = options.linedefs > sides
+                    ? static_cast<int>(std::lround(
+                          static_cast<double>(options.linedefs) / sides))
+                    : 1;
+
+    roomSize_ = MAP_EXTENT / std::max(rows_, columns_);
+    roomSize_ = std::min(MAX_ROOM_SIZE, roomSize_ - roomSize_ % split_);
+    if (roomSize_ < 8 * split_) {
+      throw std::runtime_error("Too many sectors or linedefs for the map size");
+    }
+    originX_ = -(columns_ * roomSize_) / 2;
+    originY_ = -(rows_ * roomSize_) / 2;
+  }
+
+  void build() {
+    int rooms = rows_ * columns_;
+    int sides = rows_ * (columns_ + 1) + columns_ * (rows_ + 1);
+    checkLimit("vertices", static_cast<long>(rows_ + 1) * (columns_ + 1) +
+                               static_cast<long>(sides) * (split_ - 1));
+    checkLimit("linedefs", static_cast<long>(sides) * split_);
+    checkLimit("sidedefs", (2L * sides - 2 * rows_ - 2 * columns_) * split_);
+    if (options_.nodes) {
+      checkLimit("segs", (2L * sides - 2 * rows_ - 2 * columns_) * split_);
+      if (rooms > 0x7FFF) {
+        throw std::runtime_error("Too many sectors for NODES (at most 32767)");
+      }
+    }
+
+    addSectors();
+    addCorners();
+    for (int row = 0; row < rows_; row++) {
+      for (int column = 0; column <= columns_; column++) {
+        addVerticalSide(column, row);
+      }
+    }
+    for (int row = 0; row <= rows_; row++) {
+      for (int column = 0; column < columns_; column++) {
+        addHorizontalSide(column, row);
+      }
+    }
+    addThings();
+    if (options_.nodes) {
+      addSubsectors();
+      addNode(0, columns_, 0, rows_);
+    }
+  }
+
+private:
+  const Options &options_;
+  std::mt19937  &random_;
+  Level         &level_;
+  int            rows_;
+  int            columns_;
+  int            split_;     // Linedefs per room side
+  int            roomSize_;  // Map units
+  int            originX_;
+  int            originY_;
+
+  // First linedef of each side, row by row: columns_ + 1 vertical sides per
+  // row of rooms, columns_ horizontal sides per row of corners
+  std::vector<uint16_t> verticalSides_;
+  std::vector<uint16_t> horizontalSides_;
+
+  static void checkLimit(const char *what, long count) {
+    if (count > 0xFFFF) {
+      throw std::runtime_error(std::string("Too many ") + what + " (" +
+                               std::to_string(count) +
+                               "), the WAD format allows 65535");
+    }
+  }
+
+  int x(int column) const { return originX_ + column * roomSize_; }
+  int y(int row) const { return originY_ + row * roomSize_; }
+  int room(int column, int row) const { return row * columns_ + column; }
+
+  uint16_t corner(int column, int row) const {
+    return static_cast<uint16_t>(row * (columns_ + 1) + column);
+  }
+
+  int randomInt(int count) { return static_cast<int>(random_() % count); }
+
+  std::string randomName(const char *prefix, int count) {
+    return numberedName(prefix, randomInt(count));
+  }
+
+  void addSectors() {
+    for (int row = 0; row < rows_; row++) {
+      for (int column = 0; column < columns_; column++) {
+        int floor   = (column * 7 + row * 13) % 5 * 8;
+        int ceiling = floor + 128 + (column + row) % 3 * 16;
+        int light   = 128 + (column * row) % 8 * 16;
+
+        WAD::Sector sector    = {};
+        sector.floor_height   = static_cast<int16_t>(floor);
+        sector.ceiling_height = static_cast<int16_t>(ceiling);
+        sector.light_level    = static_cast<uint16_t>(light);
+        setName(sector.floor_texture, randomName("GFLT", options_.flats));
+        setName(sector.ceiling_texture,
+                room(column, row) % 11 == 5
+                    ? std::string("F_SKY1")
+                    : randomName("GFLT", options_.flats));
+        level_.sectors.push_back(sector);
+      }
+    }
+  }
+
+  void addCorners() {
+    for (int row = 0; row <= rows_; row++) {
+      for (int column = 0; column <= columns_; column++) {
+        WAD::Vertex vertex;
+        vertex.x = static_cast<int16_t>(x(column));
+        vertex.y = static_cast<int16_t>(y(row));
+        level_.vertices.push_back(vertex);
+      }
+    }
+  }
+
+  uint16_t addSidedef(int sector, const std::string &texture,
+                      bool twoSided) {
+    WAD::Sidedef side = {};
+    setName(side.upper_texture, twoSided ? texture : "-");
+    setName(side.lower_texture, twoSided ? texture : "-");
+    setName(side.middle_texture, twoSided ? "-" : texture);
+    side.sector = static_cast<uint16_t>(sector);
+    level_.sidedefs.push_back(side);
+    return static_cast<uint16_t>(level_.sidedefs.size() - 1);
+  }
+
+  /**
+   * @brief Add the linedefs of a room side, from a to b
+   * @param a Start corner
+   * @param b End corner
+   * @param right Room on the right of a -> b
+   * @param left Room on the left, -1 for none
+   * @return Index of the first linedef, the others follow it
+   */
+  uint16_t addSide(uint16_t a, uint16_t b, int right, int left) {
+    uint16_t    first   = static_cast<uint16_t>(level_.linedefs.size());
+    std::string texture = randomName("GTEX", options_.textures);
+    WAD::Vertex start   = level_.vertices[a];
+    WAD::Vertex end     = level_.vertices[b];
+
+    uint16_t previous = a;
+    for (int piece = 1; piece <= split_; piece++) {
+      uint16_t next = b;
+      if (piece < split_) {
+        WAD::Vertex vertex;
+        vertex.x = static_cast<int16_t>(start.x +
+                                        (end.x - start.x) * piece / split_);
+        vertex.y = static_cast<int16_t>(start.y +
+                                        (end.y - start.y) * piece / split_);
+        level_.vertices.push_back(vertex);
+        next = static_cast<uint16_t>(level_.vertices.size() - 1);
+      }
+
+      bool         twoSided = left >= 0;
+      WAD::Linedef line     = {};
+      line.start_vertex     = previous;
+      line.end_vertex       = next;
+      line.flags         = twoSided ? LINE_TWO_SIDED : LINE_IMPASSABLE;
+      line.right_sidedef = addSidedef(right, texture, twoSided);
+      line.left_sidedef =
+          twoSided ? addSidedef(left, texture, twoSided) : NO_SIDEDEF;
+      level_.linedefs.push_back(line);
+      previous = next;
+    }
+    return first;
+  }
+
+  // Side at x = column, between the rows row and row + 1
+  void addVerticalSide(int column, int row) {
+    uint16_t south = corner(column, row);
+    uint16_t north = corner(column, row + 1);
+    uint16_t first =
+        column < columns_
+            ? addSide(south, north, room(column, row),
+                      column > 0 ? room(column - 1, row) : -1)
+            : addSide(north, south, room(column - 1, row), -1);
+    verticalSides_.push_back(first);
+  }
+
+  // Side at y = row, between the columns column and column + 1
+  void addHorizontalSide(int column, int row) {
+    uint16_t west  = corner(column, row);
+    uint16_t east  = corner(column + 1, row);
+    uint16_t first = row > 0 ? addSide(west, east, room(column, row - 1),
+                                       row < rows_ ? room(column, row) : -1)
+                             : addSide(east, west, room(column, row), -1);
+    horizontalSides_.push_back(first);
+  }
+
+  void addThings() {
+    // The player start is in the middle of the first room, facing north
+    WAD::Thing start;
+    start.x     = static_cast<int16_t>(x(0) + roomSize_ / 2);
+    start.y     = static_cast<int16_t>(y(0) + roomSize_ / 2);
+    start.angle = 90;
+    start.type  = 1;
+    start.flags = 7;  // On every skill level
+    level_.things.push_back(start);
+
+    int jitter = roomSize_ / 4;
+    for (int t = 1; t < options_.things; t++) {
+      int column  = randomInt(columns_);
+      int row     = randomInt(rows_);
+      int offsetX = randomInt(2 * jitter + 1) - jitter;
+      int offsetY = randomInt(2 * jitter + 1) - jitter;
+
+      WAD::Thing thing;
+      thing.x     = static_cast<int16_t>(x(column) + roomSize_ / 2 + offsetX);
+      thing.y     = static_cast<int16_t>(y(row) + roomSize_ / 2 + offsetY);
+      thing.angle = static_cast<uint16_t>(randomInt(8) * 45);
+      thing.type  = THING_TYPES[randomInt(THING_TYPE_COUNT)];
+      thing.flags = 7;
+      level_.things.push_back(thing);
+    }
+  }
+
+  // Segs of the linedefs of a room side, walking it forwards or backwards
+  void addSideSegs(uint16_t first, bool forwards, int16_t angle) {
+    for (int piece = 0; piece < split_; piece++) {
+      uint16_t index = static_cast<uint16_t>(
+          first + (forwards ? piece : split_ - 1 - piece));
+      const WAD::Linedef &line = level_.linedefs[index];
+
+      WAD::Seg seg;
+      seg.start_vertex = forwards ? line.start_vertex : line.end_vertex;
+      seg.end_vertex   = forwards ? line.end_vertex : line.start_vertex;
+      seg.angle        = angle;
+      seg.linedef      = index;
+      seg.direction    = forwards ? 0 : 1;
+      seg.offset       = 0;
+      level_.segs.push_back(seg);
+    }
+  }
+
+  // One subsector per room, its sides walked clockwise
+  void addSubsectors() {
+    const int16_t EAST  = 0;
+    const int16_t NORTH = 0x4000;
+    const int16_t WEST  = -0x8000;
+    const int16_t SOUTH = -0x4000;
+
+    for (int row = 0; row < rows_; row++) {
+      for (int column = 0; column < columns_; column++) {
+        WAD::Subsector subsector;
+        subsector.first_seg = static_cast<uint16_t>(level_.segs.size());
+
+        int west  = row * (columns_ + 1) + column;
+        int south = row * columns_ + column;
+        int north = (row + 1) * columns_ + column;
+        addSideSegs(verticalSides_[west], true, NORTH);
+        addSideSegs(horizontalSides_[north], true, EAST);
+        addSideSegs(verticalSides_[west + 1], column + 1 == columns_, SOUTH);
+        addSideSegs(horizontalSides_[south], row == 0, WEST);
+
+        subsector.seg_count = static_cast<uint16_t>(level_.segs.size() -
+                                                    subsector.first_seg);
+        level_.subsectors.push_back(subsector);
+      }
+    }
+  }
+
+  void setBounds(int16_t *bbox, int column0, int column1, int row0,
+                 int row1) const {
+    bbox[0] = static_cast<int16_t>(y(row1));
+    bbox[1] = static_cast<int16_t>(y(row0));
+    bbox[2] = static_cast<int16_t>(x(column0));
+    bbox[3] = static_cast<int16_t>(x(column1));
+  }
+
+  /**
+   * @brief Build the BSP of a block of rooms, halving its longer dimension
+   * @return Node index, or subsector index with SUBSECTOR_BIT for one room
+   * @note Children are added before their parent, so the root comes last.
+   * The front (right) child is the east half of a vertical split and the
+   * south half of a horizontal one, as R_PointOnSide sees them.
+   */
+  uint16_t addNode(int column0, int column1, int row0, int row1) {
+    if (column1 - column0 == 1 && row1 - row0 == 1) {
+      return static_cast<uint16_t>(room(column0, row0) |
+                                   WAD::Node::SUBSECTOR_BIT);
+    }
+
+    WAD::Node node;
+    if (column1 - column0 >= row1 - row0) {
+      int middle       = (column0 + column1) / 2;
+      node.x           = static_cast<int16_t>(x(middle));
+      node.y           = static_cast<int16_t>(y(row0));
+      node.dx          = 0;
+      node.dy          = static_cast<int16_t>(y(row1) - y(row0));
+      node.children[0] = addNode(middle, column1, row0, row1);
+      node.children[1] = addNode(column0, middle, row0, row1);
+      setBounds(node.bbox[0], middle, column1, row0, row1);
+      setBounds(node.bbox[1], column0, middle, row0, row1);
+    } else {
+      int middle       = (row0 + row1) / 2;
+      node.x           = static_cast<int16_t>(x(column0));
+      node.y           = static_cast<int16_t>(y(middle));
+      node.dx          = static_cast<int16_t>(x(column1) - x(column0));
+      node.dy          = 0;
+      node.children[0] = addNode(column0, column1, row0, middle);
+      node.children[1] = addNode(column0, column1, middle, row1);
+      setBounds(node.bbox[0], column0, column1, row0, middle);
+      setBounds(node.bbox[1], column0, column1, middle, row1);
+    }
+
+    level_.nodes.push_back(node);
+    return static_cast<uint16_t>(level_.nodes.size() - 1);
+  }
+};
+
+// Column-major patch, with a hole in the lower half of some columns so the
+// textures built from it have transparent parts
+std::vector<uint8_t> makePatch(int number) {
+  bool                 holes = number % 4 == 3;
+  int                  ramp  = number % 16 * 16;  // 16 shades of one color
+  std::vector<uint8_t> lump(8 + PATCH_WIDTH * 4);
+  LittleEndian::storeS16(&lump[0], PATCH_WIDTH);
+  LittleEndian::storeS16(&lump[2], PATCH_HEIGHT);
+  LittleEndian::storeS16(&lump[4], 0);
+  LittleEndian::storeS16(&lump[6], 0);
+
+  for (int x = 0; x < PATCH_WIDTH; x++) {
+    uint32_t column = static_cast<uint32_t>(lump.size());
+    LittleEndian::storeU32(&lump[8 + x * 4], column);
+
+    // Posts as (top, length) pairs
+    int posts[2][2] = {{0, PATCH_HEIGHT}, {0, 0}};
+    if (holes && x % 8 >= 6) {
+      posts[0][1] = PATCH_HEIGHT / 2;
+      posts[1][0] = PATCH_HEIGHT * 3 / 4;
+      posts[1][1] = PATCH_HEIGHT / 4;
+    }
+    for (int p = 0; p < 2 && posts[p][1] > 0; p++) {
+      lump.push_back(static_cast<uint8_t>(posts[p][0]));
+      lump.push_back(static_cast<uint8_t>(posts[p][1]));
+      lump.push_back(0);
+      for (int y = posts[p][0]; y < posts[p][0] + posts[p][1]; y++) {
+        lump.push_back(static_cast<uint8_t>(ramp + (x / 4 + y / 8) % 16));
+      }
+      lump.push_back(0);
+    }
+    lump.push_back(0xFF);
+  }
+  return lump;
+}
+
+// PNAMES, a count followed by 8-character names
+std::vector<uint8_t> makePatchNames(int count) {
+  std::vector<uint8_t> lump(4 + count * 8);
+  LittleEndian::storeU32(&lump[0], static_cast<uint32_t>(count));
+  for (int p = 0; p < count; p++) {
+    LumpName(numberedName("GPAT", p)).copyTo(
+        reinterpret_cast<char *>(&lump[4 + p * 8]));
+  }
+  return lump;
+}
+
+// TEXTURE1 with textures of 1 to 4 patches side by side
+std::vector<uint8_t> makeTextures(int count, int patches,
+                                  std::mt19937 &random) {
+  std::vector<uint8_t> lump(4 + count * 4);
+  LittleEndian::storeU32(&lump[0], static_cast<uint32_t>(count));
+
+  for (int t = 0; t < count; t++) {
+    int      columns = 1 << (t % 3);  // 64, 128 or 256 wide
+    uint32_t offset  = static_cast<uint32_t>(lump.size());
+    LittleEndian::storeU32(&lump[4 + t * 4], offset);
+
+    std::size_t header = lump.size();
+    lump.resize(header + 22 + columns * 10);
+    LumpName(numberedName("GTEX", t))
+        .copyTo(reinterpret_cast<char *>(&lump[header]));
+    LittleEndian::storeU32(&lump[header + 8], 0);
+    LittleEndian::storeU16(&lump[header + 12],
+                           static_cast<uint16_t>(columns * PATCH_WIDTH));
+    LittleEndian::storeU16(&lump[header + 14], PATCH_HEIGHT);
+    LittleEndian::storeU32(&lump[header + 16], 0);
+    LittleEndian::storeU16(&lump[header + 20], static_cast<uint16_t>(columns));
+
+    for (int c = 0; c < columns; c++) {
+      uint8_t *patch = &lump[header + 22 + c * 10];
+      LittleEndian::storeS16(patch, static_cast<int16_t>(c * PATCH_WIDTH));
+      LittleEndian::storeS16(patch + 2, 0);
+      LittleEndian::storeU16(patch + 4,
+                             static_cast<uint16_t>(random() % patches));
+      LittleEndian::storeU16(patch + 6, 1);
+      LittleEndian::storeU16(patch + 8, 0);
+    }
+  }
+  return lump;
+}
+
+std::vector<uint8_t> makeFlat(int number) {
+  std::vector<uint8_t> flat(64 * 64);
+  for (int y = 0; y < 64; y++) {
+    for (int x = 0; x < 64; x++) {
+      flat[y * 64 + x] = static_cast<uint8_t>(
+          ((x / 8 + y / 8) % 2 ? 96 : 104) + (x ^ y ^ number) % 8);
+    }
+  }
+  return flat;
+}
+
+/**
+ * @brief Write the PWAD
+ * @param options What to generate
+ * @throws std::runtime_error if the counts do not fit the WAD format or the
+ * file cannot be written
+ */
+void generate(const Options &options) {
+  std::mt19937 random(options.seed);
+  WADWriter    wad("PWAD");
+
+  for (int l = 0; l < options.levels; l++) {
+    Level       level;
+    GridBuilder grid(options, random, level);
+    grid.build();
+
+    std::string number = std::to_string(l + 1);
+    wad.addMarker(LumpName("MAP" + std::string(l < 9 ? "0" : "") + number));
+    wad.addRecords("THINGS", level.things);
+    wad.addRecords("LINEDEFS", level.linedefs);
+    wad.addRecords("SIDEDEFS", level.sidedefs);
+    wad.addRecords("VERTEXES", level.vertices);
+    if (options.nodes) {
+      wad.addRecords("SEGS", level.segs);
+      wad.addRecords("SSECTORS", level.subsectors);
+      wad.addRecords("NODES", level.nodes);
+    }
+    wad.addRecords("SECTORS", level.sectors);
+
+    std::cout << "MAP" << (l < 9 ? "0" : "") << number << ": "
+              << level.sectors.size() << " sectors";
+    if (level.sectors.size() != static_cast<std::size_t>(options.sectors)) {
+      std::cout << " (" << options.sectors << " asked)";
+    }
+    std::cout << ", " << level.linedefs.size() << " linedefs";
+    if (options.linedefs > 0 &&
+        level.linedefs.size() != static_cast<std::size_t>(options.linedefs)) {
+      std::cout << " (" << options.linedefs << " asked)";
+    }
+    std::cout << ", " << level.sidedefs.size() << " sidedefs, "
+              << level.vertices.size() << " vertices, " << level.things.size()
+              << " things";
+    if (options.nodes) {
+      std::cout << ", " << level.nodes.size() << " nodes";
+    }
+    std::cout << "\n";
+  }
+
+  wad.addLump("PNAMES", makePatchNames(options.patches));
+  wad.addLump("TEXTURE1", makeTextures(options.textures, options.patches,
+                                       random));
+  wad.addMarker("P_START");
+  for (int p = 0; p < options.patches; p++) {
+    wad.addLump(LumpName(numberedName("GPAT", p)), makePatch(p));
+  }
+  wad.addMarker("P_END");
+  wad.addMarker("F_START");
+  for (int f = 0; f < options.flats; f++) {
+    wad.addLump(LumpName(numberedName("GFLT", f)), makeFlat(f));
+  }
+  wad.addMarker("F_END");
+
+  wad.write(options.output);
+  std::cout << "Wrote " << options.output << ": " << wad.lumpCount()
+            << " lumps, " << wad.size() << " bytes\n";
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  bool    valid = argc > 1;
+  if (valid) {
+    options.output = argv[1];
+  }
+
+  for (int i = 2; i < argc && valid; i++) {
+    std::string arg     = argv[i];
+    bool        hasNext = i + 1 < argc;
+    if (arg == "--nodes") {
+      options.nodes = true;
+    } else if (!hasNext) {
+      valid = false;
+    } else if (arg == "--levels") {
+      options.levels = std::atoi(argv[++i]);
+    } else if (arg == "--sectors") {
+      options.sectors = std::atoi(argv[++i]);
+    } else if (arg == "--linedefs") {
+      options.linedefs = std::atoi(argv[++i]);
+    } else if (arg == "--things") {
+      options.things = std::atoi(argv[++i]);
+    } else if (arg == "--textures") {
+      options.textures = std::atoi(argv[++i]);
+    } else if (arg == "--patches") {
+      options.patches = std::atoi(argv[++i]);
+    } else if (arg == "--flats") {
+      options.flats = std::atoi(argv[++i]);
+    } else if (arg == "--seed") {
+      options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], 0, 10));
+    } else {
+      valid = false;
+    }
+  }
+
+  valid = valid && options.levels >= 1 && options.levels <= 99 &&
+          options.sectors >= 1 && options.things >= 1 &&
+          options.textures >= 1 && options.textures <= 10000 &&
+          options.patches >= 1 && options.patches <= 10000 &&
+          options.flats >= 1 && options.flats <= 10000;
+  if (!valid) {
+    // clang-format off
+    std::cerr << "Usage: wad-generator output.wad [--levels n] [--sectors n] [--linedefs n] [--things n]\n"
+              << "                     [--textures n] [--patches n] [--flats n] [--nodes] [--seed n]\n"
+              << "Sectors are rounded up to fill a grid of rooms, linedefs to whole linedefs per room side\n";
+    // clang-format on
+    return 2;
+  }
+
+  try {
+    generate(options);
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}